@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <cmath>
 #include <stdexcept>
+#include <string>
 
 #include "Parser.h"
 
@@ -26,6 +27,9 @@ void ParserLog::printTo(std::ostream &os) const {
   }
   os << '{' << std::endl;
   os << "  table = " << table_ << std::endl;
+  for (const auto &join : joins_) {
+    os << "  join = " << join.table_ << " on " << join.on_->toString() << std::endl;
+  }
 
   /** Update column */
   os << "  update = " << update_column_ << std::endl;
@@ -98,12 +102,50 @@ void ParserLog::printTo(std::ostream &os) const {
     os << '}' << std::endl;
   }
 
+  /** Subqueries */
+  for (size_t i = 0; i < subqueries_.size(); ++i) {
+    os << "  subquery $" << i << " = ";
+    subqueries_[i]->printTo(os);
+  }
+
   /** End */
   os << '}' << std::endl;
 }
 
-auto Parser::Parse(const Command &cmd) -> ParserLog {
+/**
+ * @brief take subqueries (select ...) out of a command, and parse them.
+ * @return the command with each subquery replaced by $i, i is its index in subqueries.
+ */
+static auto extractSubqueries(const Command &cmd, std::vector<ParserLogRef> &subqueries) -> Command {
+  Command res;
+  for (size_t i = 0; i < cmd.words_.size(); ++i) {
+    if (!(cmd.words_[i] == "(" && i + 1 < cmd.words_.size() && cmd.words_[i + 1] == "select")) {
+      res.words_.push_back(cmd.words_[i]);
+      continue;
+    }
+    // find the matching ')', subqueries inside are parsed recursively.
+    size_t depth = 1;
+    size_t end = i + 1;
+    for (; end < cmd.words_.size() && depth > 0; ++end) {
+      if (cmd.words_[end] == "(") { ++depth; }
+      if (cmd.words_[end] == ")") { --depth; }
+    }
+    cqlAssert(depth == 0, "subquery without ')'");
+    Command sub;
+    sub.words_.assign(cmd.words_.begin() + i + 1, cmd.words_.begin() + end - 1);
+    ParserLogRef log = std::make_shared<ParserLog>(Parser::Parse(sub));
+    cqlAssert(log->columns_.size() == 1, "subquery must select exactly one column");
+    cqlAssert(log->destination_.empty(), "subquery cannot have dest");
+    res.words_.push_back("$" + std::to_string(subqueries.size()));
+    subqueries.push_back(log);
+    i = end - 1;
+  }
+  return res;
+}
+
+auto Parser::Parse(const Command &input) -> ParserLog {
   ParserLog res;
+  const Command cmd = extractSubqueries(input, res.subqueries_);
   if (cmd.words_[0] == "select") {
     // correct syntax:
     // select {<expr1>, <expr2>, ...} (from <table>)
@@ -131,10 +173,22 @@ auto Parser::Parse(const Command &cmd) -> ParserLog {
     // TODO(Fudanyrd): deal with table.
     res.table_ = cmd.words_[keyPos[1] + 1];
 
+    // joins: from <table> join <table> on <predicate> join <table> on <predicate> ...
+    size_t pos = 2;
+    while (pos < keyPos.size() && cmd.words_[keyPos[pos]] == "join") {
+      cqlAssert(pos + 1 < keyPos.size() && cmd.words_[keyPos[pos + 1]] == "on", "join without on predicate");
+      cqlAssert(keyPos[pos] + 2 == keyPos[pos + 1], "join more than one table at a time");
+      JoinClause join;
+      join.table_ = cmd.words_[keyPos[pos] + 1];
+      join.on_ = (pos + 2 < keyPos.size()) ? toExprRef(cmd.words_, keyPos[pos + 1] + 1, keyPos[pos + 2])
+                                           : toExprRef(cmd.words_, keyPos[pos + 1] + 1, cmd.words_.size());
+      res.joins_.push_back(join);
+      pos += 2;
+    }
+
     // TODO(Fudanyrd): deal with where clause.
-    size_t pos = 2;  // same position as that in keywords table(defined in Parser.h, line 24)
     if (pos >= keyPos.size()) { return res; }  // caution: index out of bounds.
-    if (cmd.words_[keyPos[pos]] == keywords[pos]) {
+    if (cmd.words_[keyPos[pos]] == "where") {
       // OK, has a where predicate.
       // select ... from ... where predicate <keyword>
       //                     ^^^pos           ^^^ pos+1
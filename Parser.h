@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 
 #include "expr_util.h"
 #include "Partitioner.h"
@@ -30,9 +31,20 @@ const std::vector<std::string> keywords = {
   "offset",    // optional
   "group by",  // optional
   "having",    // optional
-  "dest"       // optional
+  "dest",      // optional
+  "join",      // optional, from <table> join <table> on <predicate> ...
+  "on"
 };
 
+// a table joined to the tables before it.
+struct JoinClause {
+  std::string table_;                                 // table joined.
+  AbstractExprRef on_{nullptr};                       // join predicate.
+};
+
+struct ParserLog;
+using ParserLogRef = std::shared_ptr<ParserLog>;
+
 // work log generated by the parser.
 struct ParserLog {
   ParserLog() = default;
@@ -44,6 +56,7 @@ struct ParserLog {
 
   ExecutionType exec_type_{ExecutionType::Invalid};
   std::string table_;                                 // which table to select from.
+  std::vector<JoinClause> joins_;                     // tables joined to table_, in order.
   std::string update_column_;                         // column to be updated.
   std::vector<AbstractExprRef> columns_;              // column exprs.
   AbstractExprRef where_{nullptr};                    // where predicate.
@@ -54,6 +67,7 @@ struct ParserLog {
   std::vector<AbstractExprRef> group_by_;
   AbstractExprRef having_{nullptr};
   std::vector<std::string> destination_;               // load the query result to variable.
+  std::vector<ParserLogRef> subqueries_;               // (select ...) in exprs, written as $i.
 };
 
 class Parser {
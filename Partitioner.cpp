@@ -39,7 +39,9 @@ auto Partitioner::partition(const std::string &commands) -> std::vector<Command>
   while (iter < command_size) {
     if (is_identifier) {
       std::string identifier;
-      while (iter < command_size && isIdentifier(commands[iter])) {
+      // a column may be qualified by its table, eg. #table.col
+      while (iter < command_size && (isIdentifier(commands[iter]) 
+             || (commands[iter] == '.' && iter + 1 < command_size && isIdentifier(commands[iter + 1])))) {
         identifier.push_back(commands[iter++]);
       }
       cmd.words_.push_back(identifier);
@@ -75,7 +77,8 @@ auto Partitioner::partition(const std::string &commands) -> std::vector<Command>
       // if current is in a word:
       if (isAlphabet(current)) {
         // read a full word, and clear the string.
-        while (iter < command_size && isAlphabet(commands[iter])) {
+        // a word may contain '_' after its first letter, eg. approx_quantile.
+        while (iter < command_size && (isAlphabet(commands[iter]) || commands[iter] == '_')) {
           word.push_back(tolwr(commands[iter++]));
         } 
         // register at cmd.
@@ -172,6 +175,12 @@ auto Partitioner::deepPartition(Command &cmd) -> bool {
       throw std::domain_error("group doesn't follow a keyword by!\n"
       "NOTE: group is a reserved keyword in cql");
     }
+    if (cmd.words_[i] == "not" && i + 1 < numWords && cmd.words_[i + 1] == "in") {
+      // a not in b <=> not (a in b)
+      new_words.push_back("not in");
+      i += 2;
+      continue;
+    }
     if (cmd.words_[i] == "<") {
       // maybe it's <= or >=
       if (i + 1 < numWords && cmd.words_[i + 1] == "=") {
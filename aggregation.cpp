@@ -0,0 +1,374 @@
+#include <cmath>
+#include <utility>
+
+#include "aggregation.h"
+#include "expr_util.h"
+
+namespace cql {
+
+/************************************************
+ *              Aggregate Kernels
+ ************************************************/
+static void initValue(AggregateState *state, const DataBox &val, double param) {
+  state->value_ = val;
+  state->count_ = 1.0;
+}
+
+static void updateAgg(AggregateState *state, const DataBox &val) {
+  state->value_ = val;
+  state->count_ += 1.0;
+}
+
+static void initCount(AggregateState *state, const DataBox &val, double param) {
+  state->count_ = val.getType() == TypeId::INVALID ? 0.0 : 1.0;
+}
+
+static void updateCount(AggregateState *state, const DataBox &val) {
+  if (val.getType() != TypeId::INVALID) { state->count_ += 1.0; }
+}
+
+static void updateMax(AggregateState *state, const DataBox &val) {
+  if (DataBox::LessThan(state->value_, val).getBoolValue()) {
+    state->value_ = val;
+  }
+  state->count_ += 1.0;
+}
+
+static void updateMin(AggregateState *state, const DataBox &val) {
+  if (DataBox::GreaterThan(state->value_, val).getBoolValue()) {
+    state->value_ = val;
+  }
+  state->count_ += 1.0;
+}
+
+static void updateSum(AggregateState *state, const DataBox &val) {
+  DataBox &data = state->value_;
+  switch(data.getType()) {
+    case TypeId::Float:
+      data = DataBox(data.getFloatValue() + DataBox::toFloat(val).getFloatValue());
+      break;
+    case TypeId::Bool:
+      // (bool) a + (bool) b = a | b.
+      data = DataBox(data.getBoolValue() || DataBox::toBool(val).getBoolValue());
+      break;
+    case TypeId::Char:
+      data = DataBox(TypeId::Char, data.getStrValue() + DataBox::toString(val));
+      break;
+    default:
+      break;
+  }
+  state->count_ += 1.0;
+}
+
+static void mergeAgg(AggregateState *state, const AggregateState &partial) {
+  state->value_ = partial.value_;
+  state->count_ += partial.count_;
+}
+
+static void mergeCount(AggregateState *state, const AggregateState &partial) {
+  state->count_ += partial.count_;
+}
+
+static void mergeMax(AggregateState *state, const AggregateState &partial) {
+  updateMax(state, partial.value_);
+  state->count_ += partial.count_ - 1.0;
+}
+
+static void mergeMin(AggregateState *state, const AggregateState &partial) {
+  updateMin(state, partial.value_);
+  state->count_ += partial.count_ - 1.0;
+}
+
+static void mergeSum(AggregateState *state, const AggregateState &partial) {
+  updateSum(state, partial.value_);
+  state->count_ += partial.count_ - 1.0;
+}
+
+/**
+ * Welford's algorithm: numerically stable single pass mean and variance.
+ */
+static void updateMoments(AggregateState *state, const DataBox &val) {
+  if (val.getType() == TypeId::INVALID) { return; }
+  const double x = DataBox::toFloat(val).getFloatValue();
+  state->count_ += 1.0;
+  const double delta = x - state->mean_;
+  state->mean_ += delta / state->count_;
+  state->m2_ += delta * (x - state->mean_);
+}
+
+static void initMoments(AggregateState *state, const DataBox &val, double param) {
+  *state = AggregateState();
+  updateMoments(state, val);
+}
+
+/**
+ * Chan et al.'s formula for combining the moments of two partitions.
+ */
+static void mergeMoments(AggregateState *state, const AggregateState &partial) {
+  if (partial.count_ == 0.0) { return; }
+  if (state->count_ == 0.0) {
+    *state = partial;
+    return;
+  }
+  const double count = state->count_ + partial.count_;
+  const double delta = partial.mean_ - state->mean_;
+  state->mean_ += delta * partial.count_ / count;
+  state->m2_ += partial.m2_ + delta * delta * state->count_ * partial.count_ / count;
+  state->count_ = count;
+}
+
+static auto finalizeAvg(const AggregateState &state) -> DataBox {
+  return state.count_ == 0.0 ? DataBox(TypeId::INVALID, "") : DataBox(state.mean_);
+}
+
+static auto finalizeVar(const AggregateState &state) -> DataBox {
+  return state.count_ < 2.0 ? DataBox(TypeId::INVALID, "") : DataBox(state.m2_ / (state.count_ - 1.0));
+}
+
+static auto finalizeStddev(const AggregateState &state) -> DataBox {
+  return state.count_ < 2.0 ? DataBox(TypeId::INVALID, "") : DataBox(sqrt(state.m2_ / (state.count_ - 1.0)));
+}
+
+static void initDistinct(AggregateState *state, const DataBox &val, double param) {
+  state->sketch_ = std::make_shared<HyperLogLog>();
+  state->sketch_->Update(val);
+}
+
+static void initQuantile(AggregateState *state, const DataBox &val, double param) {
+  state->sketch_ = std::make_shared<KllSketch>(param);
+  state->sketch_->Update(val);
+}
+
+static void initExactQuantile(AggregateState *state, const DataBox &val, double param) {
+  state->sketch_ = std::make_shared<ExactQuantile>(param);
+  state->sketch_->Update(val);
+}
+
+static void initTopK(AggregateState *state, const DataBox &val, double param) {
+  state->sketch_ = std::make_shared<SpaceSaving>(static_cast<size_t>(param));
+  state->sketch_->Update(val);
+}
+
+static void updateSketch(AggregateState *state, const DataBox &val) {
+  state->sketch_->Update(val);
+}
+
+static void mergeSketch(AggregateState *state, const AggregateState &partial) {
+  if (!static_cast<bool>(partial.sketch_)) { return; }
+  if (!static_cast<bool>(state->sketch_)) {
+    state->sketch_ = partial.sketch_;
+    return;
+  }
+  state->sketch_->Merge(*partial.sketch_);
+}
+
+// a state without sketch has seen no values(global aggregation of an empty input).
+static auto finalizeDistinct(const AggregateState &state) -> DataBox {
+  return static_cast<bool>(state.sketch_) ? state.sketch_->Result() : DataBox(0.0);
+}
+
+static auto finalizeQuantile(const AggregateState &state) -> DataBox {
+  return static_cast<bool>(state.sketch_) ? state.sketch_->Result() : DataBox(TypeId::INVALID, "");
+}
+
+static auto finalizeTopK(const AggregateState &state) -> DataBox {
+  return static_cast<bool>(state.sketch_) ? state.sketch_->Result() : DataBox(TypeId::Char, "");
+}
+
+static auto finalizeValue(const AggregateState &state) -> DataBox { return state.value_; }
+
+static auto finalizeCount(const AggregateState &state) -> DataBox { return DataBox(state.count_); }
+
+auto AggregateFunction::Make(const AbstractExprRef &expr) -> AggregateFunction {
+  AggregateFunction func;
+  func.input_ = expr;
+  func.init_ = initValue;
+  func.update_ = updateAgg;
+  func.merge_ = mergeAgg;
+  func.finalize_ = finalizeValue;
+
+  auto agg_ptr = dynamic_cast<const AggregateExpr *>(expr.get());
+  if (!static_cast<bool>(agg_ptr)) { return func; }
+  func.input_ = agg_ptr->child_;
+  func.param_ = agg_ptr->param_;
+  switch(agg_ptr->agg_type_) {
+    case AggregateType::Agg:
+      break;
+    case AggregateType::Count:
+      func.init_ = initCount;
+      func.update_ = updateCount;
+      func.merge_ = mergeCount;
+      func.finalize_ = finalizeCount;
+      break;
+    case AggregateType::Max:
+      func.update_ = updateMax;
+      func.merge_ = mergeMax;
+      break;
+    case AggregateType::Min:
+      func.update_ = updateMin;
+      func.merge_ = mergeMin;
+      break;
+    case AggregateType::Sum:
+      func.update_ = updateSum;
+      func.merge_ = mergeSum;
+      break;
+    case AggregateType::Avg: case AggregateType::Var: case AggregateType::Stddev:
+      func.init_ = initMoments;
+      func.update_ = updateMoments;
+      func.merge_ = mergeMoments;
+      func.finalize_ = agg_ptr->agg_type_ == AggregateType::Avg ? finalizeAvg 
+                     : (agg_ptr->agg_type_ == AggregateType::Var ? finalizeVar : finalizeStddev);
+      break;
+    case AggregateType::ApproxCountDistinct:
+      func.init_ = initDistinct;
+      func.update_ = updateSketch;
+      func.merge_ = mergeSketch;
+      func.finalize_ = finalizeDistinct;
+      break;
+    case AggregateType::ApproxQuantile:
+      cqlAssert(func.param_ >= 0.0 && func.param_ <= 1.0, "quantile of approx_quantile is not in [0, 1]");
+      func.init_ = initQuantile;
+      func.update_ = updateSketch;
+      func.merge_ = mergeSketch;
+      func.finalize_ = finalizeQuantile;
+      break;
+    case AggregateType::Median: case AggregateType::Percentile:
+      if (agg_ptr->agg_type_ == AggregateType::Median) { func.param_ = 0.5; }
+      cqlAssert(func.param_ >= 0.0 && func.param_ <= 1.0, "quantile of percentile is not in [0, 1]");
+      func.init_ = initExactQuantile;
+      func.update_ = updateSketch;
+      func.merge_ = mergeSketch;
+      func.finalize_ = finalizeQuantile;
+      break;
+    case AggregateType::TopK:
+      cqlAssert(func.param_ >= 1.0 && func.param_ == floor(func.param_), "k of topk is not a positive integer");
+      func.init_ = initTopK;
+      func.update_ = updateSketch;
+      func.merge_ = mergeSketch;
+      func.finalize_ = finalizeTopK;
+      break;
+  }
+  return func;
+}
+
+auto collectAggExprs(const std::vector<AbstractExprRef> &columns, const std::vector<AbstractExprRef> &order_by,
+                     const AbstractExprRef &having) -> std::vector<AbstractExprRef> {
+  std::unordered_map<std::string, AbstractExprRef> agg_exprs; 
+  for (const auto &ref : columns) {
+    findAggExprs(ref, agg_exprs);
+  }
+  for (const auto &ref : order_by) {
+    findAggExprs(ref, agg_exprs);
+  }
+  if (static_cast<bool>(having)) {
+    findAggExprs(having, agg_exprs);
+  }
+
+  std::vector<AbstractExprRef> res;
+  res.reserve(agg_exprs.size());
+  for (const auto &pair : agg_exprs) {
+    res.push_back(pair.second);
+  }
+  return res;
+}
+
+auto makeAggSchema(const std::vector<AbstractExprRef> &group_by, const std::vector<AbstractExprRef> &aggs)
+  -> Schema {
+  Schema schema;
+  // group_by : key
+  for (const auto &expr : group_by) {
+    // how to set the type of columns??? a potential deficiency...
+    schema.AppendCol(TypeId::INVALID, expr->toString());
+  }
+  // aggs: value
+  for (const auto &expr : aggs) {
+    schema.AppendCol(TypeId::INVALID, expr->toString());
+  }
+  return schema;
+}
+
+/************************************************
+ *            AggregationHashTable
+ ************************************************/
+AggregationHashTable::AggregationHashTable(size_t num_keys, size_t num_aggs, size_t capacity)
+  : num_keys_(num_keys), num_aggs_(num_aggs) {
+  size_t size = 16;
+  while (size < capacity) { size <<= 1; }
+  slots_.assign(size, Slot{0, EMPTY});
+}
+
+auto AggregationHashTable::HashKeys(const DataBox *keys, size_t num_keys) -> uint64_t {
+  uint64_t hash = 0x9e3779b97f4a7c15ULL;
+  for (size_t i = 0; i < num_keys; ++i) {
+    // combine in order, so that (a, b) and (b, a) differ.
+    hash = (hash ^ DataBox::Hash(keys[i])) * 0x100000001b3ULL;
+    hash ^= hash >> 29;
+  }
+  return hash;
+}
+
+auto AggregationHashTable::FindOrInsert(const DataBox *keys, uint64_t hash, bool *inserted) 
+  -> AggregateState * {
+  const size_t mask = slots_.size() - 1;
+  size_t pos = hash & mask;
+  while (slots_[pos].group_ != EMPTY) {
+    if (slots_[pos].hash_ == hash) {
+      const DataBox *group_keys = getKeys(slots_[pos].group_);
+      size_t i = 0;
+      while (i < num_keys_ && DataBox::Identical(group_keys[i], keys[i])) { ++i; }
+      if (i == num_keys_) {
+        *inserted = false;
+        return getStates(slots_[pos].group_);
+      }
+    }
+    pos = (pos + 1) & mask;
+  }
+
+  // not found, create a group in the empty slot.
+  size_t group = num_groups_++;
+  slots_[pos] = Slot{hash, group};
+  keys_.insert(keys_.end(), keys, keys + num_keys_);
+  states_.resize(states_.size() + num_aggs_);
+  hashes_.push_back(hash);
+  *inserted = true;
+
+  // keep load factor below 1/2.
+  if (num_groups_ * 2 > slots_.size()) { Grow(); }
+  return getStates(group);
+}
+
+void AggregationHashTable::Merge(AggregationHashTable &that, const std::vector<AggregateFunction> &funcs) {
+  for (size_t group = 0; group < that.getNumGroups(); ++group) {
+    bool inserted;
+    AggregateState *states = FindOrInsert(that.getKeys(group), that.getHash(group), &inserted);
+    AggregateState *partial = that.getStates(group);
+    for (size_t i = 0; i < num_aggs_; ++i) {
+      if (inserted) {
+        states[i] = std::move(partial[i]);
+      } else {
+        funcs[i].merge_(&states[i], partial[i]);
+      }
+    }
+  }
+}
+
+void AggregationHashTable::Grow() {
+  std::vector<Slot> old_slots(slots_.size() * 2, Slot{0, EMPTY});
+  old_slots.swap(slots_);
+  const size_t mask = slots_.size() - 1;
+  for (const auto &slot : old_slots) {
+    if (slot.group_ == EMPTY) { continue; }
+    size_t pos = slot.hash_ & mask;
+    while (slots_[pos].group_ != EMPTY) { pos = (pos + 1) & mask; }
+    slots_[pos] = slot;
+  }
+}
+
+auto AggregationHashTable::getMemorySize() const -> size_t {
+  size_t size = slots_.capacity() * sizeof(Slot) + hashes_.capacity() * sizeof(uint64_t)
+              + states_.capacity() * sizeof(AggregateState);
+  for (const auto &key : keys_) { size += key.getMemorySize(); }
+  return size;
+}
+
+}  // namespace cql
@@ -0,0 +1,150 @@
+/*****************************************************
+ * File: aggregation.h
+ * Author: Fudanyrd (email: yangrundong7@gmail.com)
+ *
+ * Building blocks of aggregate executors:
+ * (1) aggregate states and the kernels updating them;
+ * (2) a hash table mapping typed group keys to the
+ *     aggregate states of the group.
+ *****************************************************/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "expr.h"
+#include "schema.h"
+#include "sketch.h"
+#include "type.h"
+
+namespace cql {
+
+/** Running state of one aggregate in one group. */
+struct AggregateState {
+  DataBox value_;          // result of agg/max/min/sum so far.
+  double count_{0.0};      // number of values folded in.
+  double mean_{0.0};       // running mean(avg/var/stddev).
+  double m2_{0.0};         // sum of squared differences from the mean(var/stddev).
+  AggregateSketchRef sketch_{nullptr};  // summary of the values(approximate aggregates).
+};
+
+/**
+ * An aggregate expression compiled into kernels, so that
+ * updating a group doesn't have to look at the aggregate type.
+ */
+struct AggregateFunction {
+  /** expression evaluated on every input tuple. */
+  AbstractExprRef input_{nullptr};
+  /** constant parameter of the aggregate, eg. the quantile of approx_quantile. */
+  double param_{0.0};
+  /** fold the first value into an empty state. */
+  void (*init_)(AggregateState *state, const DataBox &val, double param){nullptr};
+  /** fold one more value into the state. */
+  void (*update_)(AggregateState *state, const DataBox &val){nullptr};
+  /** fold a partial state(of the same aggregate) into the state. */
+  void (*merge_)(AggregateState *state, const AggregateState &partial){nullptr};
+  /** @return the output value of a state. */
+  DataBox (*finalize_)(const AggregateState &state){nullptr};
+
+  /**
+   * @brief compile an aggregate expression.
+   * Any other expression is treated as agg(expr).
+   */
+  static auto Make(const AbstractExprRef &expr) -> AggregateFunction;
+};
+
+/**
+ * @brief find all aggregation expressions of a query(in its columns, order bys and having).
+ * @param having: may be nullptr.
+ */
+auto collectAggExprs(const std::vector<AbstractExprRef> &columns, const std::vector<AbstractExprRef> &order_by,
+                     const AbstractExprRef &having) -> std::vector<AbstractExprRef>;
+
+/**
+ * @brief make the output schema of an aggregation: the group by keys, then the aggregates.
+ */
+auto makeAggSchema(const std::vector<AbstractExprRef> &group_by, const std::vector<AbstractExprRef> &aggs)
+  -> Schema;
+
+/**
+ * Open-addressing(linear probing) hash table from group keys to
+ * aggregate states. Keys and states of a group are stored in
+ * fixed-width rows of two flat arrays; a slot only records the
+ * hash and the row of its group.
+ */
+class AggregationHashTable {
+ private:
+  struct Slot {
+    uint64_t hash_;      // hash of the group keys.
+    size_t group_;       // row of the group, EMPTY if unused.
+  };
+  static const size_t EMPTY = static_cast<size_t>(-1);
+
+  /** number of group by keys. */
+  size_t num_keys_;
+  /** number of aggregates in a group. */
+  size_t num_aggs_;
+  /** number of slots is a power of 2. */
+  std::vector<Slot> slots_;
+  /** keys of group g are at [g * num_keys_, (g + 1) * num_keys_). */
+  std::vector<DataBox> keys_;
+  /** states of group g are at [g * num_aggs_, (g + 1) * num_aggs_). */
+  std::vector<AggregateState> states_;
+  /** hash of the keys of each group. */
+  std::vector<uint64_t> hashes_;
+  /** number of groups. */
+  size_t num_groups_{0U};
+
+  /** double the number of slots and re-insert all groups. */
+  void Grow();
+
+ public:
+  AggregationHashTable(size_t num_keys, size_t num_aggs, size_t capacity = 1024);
+
+  /**
+   * @return hash value of a list of keys.
+   */
+  static auto HashKeys(const DataBox *keys, size_t num_keys) -> uint64_t;
+
+  /**
+   * @brief find the group of keys, create one if not exists.
+   * @param hash: must be HashKeys(keys, num_keys).
+   * @param inserted[out] set to true if the group is newly created.
+   * @return the states of the group.
+   */
+  auto FindOrInsert(const DataBox *keys, uint64_t hash, bool *inserted) -> AggregateState *;
+
+  /**
+   * @brief fold all groups of another table(with the same layout) into this one.
+   * @param funcs: aggregates of the states, used to merge partial states.
+   */
+  void Merge(AggregationHashTable &that, const std::vector<AggregateFunction> &funcs);
+
+  /**
+   * @return number of groups.
+   */
+  auto getNumGroups() const -> size_t { return num_groups_; }
+
+  /**
+   * @return hash of the keys of a group.
+   */
+  auto getHash(size_t group) const -> uint64_t { return hashes_[group]; }
+
+  /**
+   * @return the keys of a group.
+   */
+  auto getKeys(size_t group) const -> const DataBox * { return keys_.data() + group * num_keys_; }
+  auto getKeys(size_t group) -> DataBox * { return keys_.data() + group * num_keys_; }
+
+  /**
+   * @return the states of a group.
+   */
+  auto getStates(size_t group) -> AggregateState * { return states_.data() + group * num_aggs_; }
+
+  /**
+   * @return number of bytes of the slots, keys and states(not counting sketches).
+   */
+  auto getMemorySize() const -> size_t;
+};
+
+}  // namespace cql
@@ -0,0 +1,35 @@
+#include <iostream>
+#include "aggregation.h"
+
+using namespace std;  using namespace cql;
+
+auto main(int argc, char **argv) -> int {
+  // group by two string columns; ('a','bc') and ('ab','c') are different groups.
+  AggregationHashTable table(2, 1, 4);
+  vector<vector<DataBox>> rows = {
+    {DataBox(TypeId::Char, "a"), DataBox(TypeId::Char, "bc")},
+    {DataBox(TypeId::Char, "ab"), DataBox(TypeId::Char, "c")},
+    {DataBox(TypeId::Char, "a"), DataBox(TypeId::Char, "bc")},
+  };
+  // insert enough groups to make the table grow.
+  for (int i = 0; i < 100; ++i) {
+    rows.push_back({DataBox(static_cast<double>(i % 50)), DataBox(true)});
+  }
+
+  for (const auto &row : rows) {
+    bool inserted;
+    AggregateState *states = table.FindOrInsert(row.data(), AggregationHashTable::HashKeys(row.data(), 2), 
+                                                &inserted);
+    states[0].count_ += 1.0;
+  }
+
+  cout << table.getNumGroups() << " group(s)" << endl;   // expect 52.
+  for (size_t g = 0; g < table.getNumGroups(); ++g) {
+    const DataBox *keys = table.getKeys(g);
+    keys[0].printTo(cout);
+    cout << ',';
+    keys[1].printTo(cout);
+    cout << " -> " << table.getStates(g)[0].count_ << endl;
+  }
+  return 0;
+}
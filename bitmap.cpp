@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <iterator>
+
+#include "bitmap.h"
+
+namespace cql {
+
+const size_t RoaringBitmap::CHUNK_ROWS;
+const size_t RoaringBitmap::CHUNK_WORDS;
+
+/** @return number of set bits. */
+static auto popcount(uint64_t word) -> size_t {
+  return static_cast<size_t>(__builtin_popcountll(word));
+}
+
+auto RoaringBitmap::Container::Contains(uint16_t low) const -> bool {
+  if (isBitset()) { return (bits_[low / 64] >> (low % 64)) & 1; }
+  return std::binary_search(array_.begin(), array_.end(), low);
+}
+
+void RoaringBitmap::Container::Normalize() {
+  if (isBitset() && card_ <= BITMAP_ARRAY_MAX) {
+    array_.clear();
+    array_.reserve(card_);
+    for (size_t i = 0; i < CHUNK_WORDS; ++i) {
+      for (uint64_t word = bits_[i]; word != 0; word &= word - 1) {
+        array_.push_back(static_cast<uint16_t>(i * 64 + __builtin_ctzll(word)));
+      }
+    }
+    std::vector<uint64_t>().swap(bits_);
+  } else if (!isBitset() && card_ > BITMAP_ARRAY_MAX) {
+    bits_.assign(CHUNK_WORDS, 0);
+    for (uint16_t low : array_) { bits_[low / 64] |= static_cast<uint64_t>(1) << (low % 64); }
+    std::vector<uint16_t>().swap(array_);
+  }
+}
+
+auto RoaringBitmap::Find(size_t key) const -> size_t {
+  size_t lo = 0, hi = containers_.size();
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (containers_[mid].key_ < key) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+void RoaringBitmap::Add(size_t row) {
+  const size_t key = row >> BITMAP_CHUNK_BITS;
+  const uint16_t low = static_cast<uint16_t>(row & (CHUNK_ROWS - 1));
+  size_t i = Find(key);
+  if (i == containers_.size() || containers_[i].key_ != key) {
+    containers_.insert(containers_.begin() + i, Container());
+    containers_[i].key_ = key;
+  }
+  Container &container = containers_[i];
+  if (container.isBitset()) {
+    uint64_t &word = container.bits_[low / 64];
+    const uint64_t bit = static_cast<uint64_t>(1) << (low % 64);
+    if ((word & bit) == 0) {
+      word |= bit;
+      ++container.card_;
+    }
+    return;
+  }
+  auto pos = std::lower_bound(container.array_.begin(), container.array_.end(), low);
+  if (pos != container.array_.end() && *pos == low) { return; }
+  container.array_.insert(pos, low);
+  ++container.card_;
+  container.Normalize();
+}
+
+void RoaringBitmap::Remove(size_t row) {
+  const size_t key = row >> BITMAP_CHUNK_BITS;
+  const uint16_t low = static_cast<uint16_t>(row & (CHUNK_ROWS - 1));
+  size_t i = Find(key);
+  if (i == containers_.size() || containers_[i].key_ != key) { return; }
+  Container &container = containers_[i];
+  if (container.isBitset()) {
+    uint64_t &word = container.bits_[low / 64];
+    const uint64_t bit = static_cast<uint64_t>(1) << (low % 64);
+    if ((word & bit) == 0) { return; }
+    word &= ~bit;
+  } else {
+    auto pos = std::lower_bound(container.array_.begin(), container.array_.end(), low);
+    if (pos == container.array_.end() || *pos != low) { return; }
+    container.array_.erase(pos);
+  }
+  if (--container.card_ == 0) {
+    containers_.erase(containers_.begin() + i);
+  } else {
+    container.Normalize();
+  }
+}
+
+auto RoaringBitmap::Contains(size_t row) const -> bool {
+  const size_t key = row >> BITMAP_CHUNK_BITS;
+  size_t i = Find(key);
+  return i < containers_.size() && containers_[i].key_ == key
+      && containers_[i].Contains(static_cast<uint16_t>(row & (CHUNK_ROWS - 1)));
+}
+
+auto RoaringBitmap::getCardinality() const -> size_t {
+  size_t res = 0;
+  for (const auto &container : containers_) { res += container.card_; }
+  return res;
+}
+
+auto RoaringBitmap::And(const Container &c1, const Container &c2) -> Container {
+  Container res;
+  res.key_ = c1.key_;
+  if (c1.isBitset() && c2.isBitset()) {
+    res.bits_.resize(CHUNK_WORDS);
+    for (size_t i = 0; i < CHUNK_WORDS; ++i) {
+      res.bits_[i] = c1.bits_[i] & c2.bits_[i];
+      res.card_ += popcount(res.bits_[i]);
+    }
+  } else if (c1.isBitset() || c2.isBitset()) {
+    const Container &array = c1.isBitset() ? c2 : c1;
+    const Container &bitset = c1.isBitset() ? c1 : c2;
+    for (uint16_t low : array.array_) {
+      if (bitset.Contains(low)) { res.array_.push_back(low); }
+    }
+    res.card_ = res.array_.size();
+  } else {
+    std::set_intersection(c1.array_.begin(), c1.array_.end(), c2.array_.begin(), c2.array_.end(),
+                          std::back_inserter(res.array_));
+    res.card_ = res.array_.size();
+  }
+  res.Normalize();
+  return res;
+}
+
+auto RoaringBitmap::Or(const Container &c1, const Container &c2) -> Container {
+  Container res;
+  res.key_ = c1.key_;
+  if (c1.isBitset() || c2.isBitset()) {
+    res.bits_ = c1.isBitset() ? c1.bits_ : c2.bits_;
+    const Container &other = c1.isBitset() ? c2 : c1;
+    if (other.isBitset()) {
+      for (size_t i = 0; i < CHUNK_WORDS; ++i) { res.bits_[i] |= other.bits_[i]; }
+    } else {
+      for (uint16_t low : other.array_) { res.bits_[low / 64] |= static_cast<uint64_t>(1) << (low % 64); }
+    }
+    for (uint64_t word : res.bits_) { res.card_ += popcount(word); }
+  } else {
+    std::set_union(c1.array_.begin(), c1.array_.end(), c2.array_.begin(), c2.array_.end(),
+                   std::back_inserter(res.array_));
+    res.card_ = res.array_.size();
+  }
+  res.Normalize();
+  return res;
+}
+
+auto RoaringBitmap::AndNot(const Container &c1, const Container &c2) -> Container {
+  Container res;
+  res.key_ = c1.key_;
+  if (c1.isBitset()) {
+    res.bits_ = c1.bits_;
+    if (c2.isBitset()) {
+      for (size_t i = 0; i < CHUNK_WORDS; ++i) { res.bits_[i] &= ~c2.bits_[i]; }
+    } else {
+      for (uint16_t low : c2.array_) { res.bits_[low / 64] &= ~(static_cast<uint64_t>(1) << (low % 64)); }
+    }
+    for (uint64_t word : res.bits_) { res.card_ += popcount(word); }
+  } else if (c2.isBitset()) {
+    for (uint16_t low : c1.array_) {
+      if (!c2.Contains(low)) { res.array_.push_back(low); }
+    }
+    res.card_ = res.array_.size();
+  } else {
+    std::set_difference(c1.array_.begin(), c1.array_.end(), c2.array_.begin(), c2.array_.end(),
+                        std::back_inserter(res.array_));
+    res.card_ = res.array_.size();
+  }
+  res.Normalize();
+  return res;
+}
+
+auto RoaringBitmap::And(const RoaringBitmap &b1, const RoaringBitmap &b2) -> RoaringBitmap {
+  RoaringBitmap res;
+  size_t i = 0, j = 0;
+  while (i < b1.containers_.size() && j < b2.containers_.size()) {
+    const Container &c1 = b1.containers_[i], &c2 = b2.containers_[j];
+    if (c1.key_ < c2.key_) {
+      ++i;
+    } else if (c2.key_ < c1.key_) {
+      ++j;
+    } else {
+      Container container = And(c1, c2);
+      if (container.card_ != 0) { res.containers_.push_back(std::move(container)); }
+      ++i;
+      ++j;
+    }
+  }
+  return res;
+}
+
+auto RoaringBitmap::Or(const RoaringBitmap &b1, const RoaringBitmap &b2) -> RoaringBitmap {
+  RoaringBitmap res;
+  size_t i = 0, j = 0;
+  const size_t n1 = b1.containers_.size(), n2 = b2.containers_.size();
+  while (i < n1 || j < n2) {
+    if (j == n2 || (i < n1 && b1.containers_[i].key_ < b2.containers_[j].key_)) {
+      res.containers_.push_back(b1.containers_[i++]);
+    } else if (i == n1 || b2.containers_[j].key_ < b1.containers_[i].key_) {
+      res.containers_.push_back(b2.containers_[j++]);
+    } else {
+      res.containers_.push_back(Or(b1.containers_[i++], b2.containers_[j++]));
+    }
+  }
+  return res;
+}
+
+auto RoaringBitmap::AndNot(const RoaringBitmap &b1, const RoaringBitmap &b2) -> RoaringBitmap {
+  RoaringBitmap res;
+  size_t j = 0;
+  for (const auto &c1 : b1.containers_) {
+    while (j < b2.containers_.size() && b2.containers_[j].key_ < c1.key_) { ++j; }
+    if (j == b2.containers_.size() || b2.containers_[j].key_ != c1.key_) {
+      res.containers_.push_back(c1);
+      continue;
+    }
+    Container container = AndNot(c1, b2.containers_[j]);
+    if (container.card_ != 0) { res.containers_.push_back(std::move(container)); }
+  }
+  return res;
+}
+
+void RoaringBitmap::getRows(std::vector<size_t> *rows) const {
+  for (const auto &container : containers_) {
+    const size_t base = container.key_ << BITMAP_CHUNK_BITS;
+    if (!container.isBitset()) {
+      for (uint16_t low : container.array_) { rows->push_back(base + low); }
+      continue;
+    }
+    for (size_t i = 0; i < CHUNK_WORDS; ++i) {
+      for (uint64_t word = container.bits_[i]; word != 0; word &= word - 1) {
+        rows->push_back(base + i * 64 + __builtin_ctzll(word));
+      }
+    }
+  }
+}
+
+}  // namespace cql
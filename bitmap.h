@@ -0,0 +1,74 @@
+/*****************************************************
+ * File: bitmap.h
+ * Author: Fudanyrd (email: yangrundong7@gmail.com)
+ *
+ * A compressed set of row ids in the manner of roaring
+ * bitmaps: rows are grouped by their high bits into
+ * chunks of 65536, each held in a sorted array if sparse
+ * or in a bitset(1024 words) if dense, so that and/or/
+ * and-not work a word at a time on dense chunks.
+ *****************************************************/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace cql {
+
+/** rows of a chunk: the low bits of a row id. */
+const size_t BITMAP_CHUNK_BITS = 16;
+/** a chunk with more rows than this is a bitset, else an array. */
+const size_t BITMAP_ARRAY_MAX = 4096;
+
+class RoaringBitmap {
+ private:
+  static const size_t CHUNK_ROWS = static_cast<size_t>(1) << BITMAP_CHUNK_BITS;
+  static const size_t CHUNK_WORDS = CHUNK_ROWS / 64;
+
+  struct Container {
+    /** high bits of the rows. */
+    size_t key_{0U};
+    /** number of rows. */
+    size_t card_{0U};
+    /** low bits, sorted; if an array. */
+    std::vector<uint16_t> array_;
+    /** CHUNK_WORDS words; if a bitset. */
+    std::vector<uint64_t> bits_;
+
+    auto isBitset() const -> bool { return !bits_.empty(); }
+    auto Contains(uint16_t low) const -> bool;
+    /** @brief switch to the representation fit for card_. */
+    void Normalize();
+  };
+
+  /** ascending keys. */
+  std::vector<Container> containers_;
+
+  /** @return index of the container of key, or where it would be inserted. */
+  auto Find(size_t key) const -> size_t;
+
+  static auto And(const Container &c1, const Container &c2) -> Container;
+  static auto Or(const Container &c1, const Container &c2) -> Container;
+  static auto AndNot(const Container &c1, const Container &c2) -> Container;
+
+ public:
+  void Add(size_t row);
+  void Remove(size_t row);
+  auto Contains(size_t row) const -> bool;
+  auto getCardinality() const -> size_t;
+  auto isEmpty() const -> bool { return containers_.empty(); }
+
+  /** @return rows in both. */
+  static auto And(const RoaringBitmap &b1, const RoaringBitmap &b2) -> RoaringBitmap;
+  /** @return rows in either. */
+  static auto Or(const RoaringBitmap &b1, const RoaringBitmap &b2) -> RoaringBitmap;
+  /** @return rows of b1 not in b2. */
+  static auto AndNot(const RoaringBitmap &b1, const RoaringBitmap &b2) -> RoaringBitmap;
+
+  /**
+   * @brief append the rows, ascending.
+   */
+  void getRows(std::vector<size_t> *rows) const;
+};
+
+}  // namespace cql
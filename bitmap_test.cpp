@@ -0,0 +1,50 @@
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include "bitmap.h"
+
+using namespace std;  using namespace cql;
+
+/** @return true if the bitmap holds exactly the rows of the set. */
+static auto same(const RoaringBitmap &bitmap, const set<size_t> &rows) -> bool {
+  vector<size_t> res;
+  bitmap.getRows(&res);
+  return bitmap.getCardinality() == rows.size() && vector<size_t>(rows.begin(), rows.end()) == res;
+}
+
+auto main(int argc, char **argv) -> int {
+  // b1 dense in the first chunk(a bitset), b2 sparse(arrays); both span 4 chunks.
+  RoaringBitmap b1, b2;
+  set<size_t> s1, s2;
+  srand(42);
+  for (size_t i = 0; i < 100000; ++i) {
+    size_t row = i < 50000 ? rand() % 65536 : rand() % (4 * 65536);
+    b1.Add(row);
+    s1.insert(row);
+  }
+  for (size_t i = 0; i < 3000; ++i) {
+    size_t row = rand() % (4 * 65536);
+    b2.Add(row);
+    s2.insert(row);
+  }
+  cout << "add: " << same(b1, s1) << same(b2, s2) << endl;  // expect 11.
+
+  set<size_t> both, either, only;
+  for (size_t row : s1) {
+    if (s2.count(row) != 0) { both.insert(row); } else { only.insert(row); }
+  }
+  either = s1;
+  either.insert(s2.begin(), s2.end());
+  cout << "and: " << same(RoaringBitmap::And(b1, b2), both) << same(RoaringBitmap::And(b2, b1), both) << endl;
+  cout << "or: " << same(RoaringBitmap::Or(b1, b2), either) << same(RoaringBitmap::Or(b2, b1), either) << endl;
+  cout << "and not: " << same(RoaringBitmap::AndNot(b1, b2), only) << endl;  // expect 1.
+
+  // removing most rows of a bitset chunk turns it back into an array.
+  for (size_t row = 0; row < 65000; ++row) {
+    b1.Remove(row);
+    s1.erase(row);
+  }
+  cout << "remove: " << same(b1, s1) << b1.Contains(65535) << (s1.count(65535) != 0) << endl;
+  cout << "and after remove: " << same(RoaringBitmap::And(b1, b1), s1) << endl;  // expect 1.
+  return 0;
+}
@@ -0,0 +1,72 @@
+/*****************************************************
+ * File: blocking_queue.h
+ * Author: Fudanyrd (email: yangrundong7@gmail.com)
+ *
+ * A bounded multi-producer multi-consumer queue for
+ * passing work between threads of an executor.
+ *****************************************************/
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace cql {
+
+template <typename T>
+class BlockingQueue {
+ private:
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<T> items_;
+  /** maximum number of items in the queue. */
+  size_t capacity_;
+  /** no more items can be pushed once closed. */
+  bool closed_{false};
+
+ public:
+  explicit BlockingQueue(size_t capacity): capacity_(capacity) {}
+  // disallow copy.
+  BlockingQueue(const BlockingQueue &that) = delete;
+
+  /**
+   * @brief push an item, wait if the queue is full.
+   * @return false if the queue is closed(the item is dropped).
+   */
+  auto Push(T item) -> bool {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+    if (closed_) { return false; }
+    items_.push_back(std::move(item));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief pop an item, wait if the queue is empty.
+   * @return false if the queue is closed and drained.
+   */
+  auto Pop(T *item) -> bool {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) { return false; }
+    *item = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief no more pushes; consumers drain what is left.
+   */
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+};
+
+}  // namespace cql
@@ -0,0 +1,216 @@
+#include <algorithm>
+
+#include "btree.h"
+
+namespace cql {
+
+auto BPlusTree::Less(const DataBox &k1, size_t r1, const DataBox &k2, size_t r2) -> bool {
+  if (DataBox::LessThan(k1, k2).getBoolValue()) { return true; }
+  if (DataBox::LessThan(k2, k1).getBoolValue()) { return false; }
+  return r1 < r2;
+}
+
+auto BPlusTree::ChildOf(const Node *node, const DataBox &key, size_t row) -> size_t {
+  // number of separators not after (key, row).
+  size_t lo = 0, hi = node->keys_.size();
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (Less(key, row, node->keys_[mid], node->rows_[mid])) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+auto BPlusTree::LeafOf(const DataBox &key, size_t row) const -> Node * {
+  Node *node = root_.get();
+  while (!node->leaf_) { node = node->children_[ChildOf(node, key, row)].get(); }
+  return node;
+}
+
+BPlusTree::BPlusTree(): root_(new Node()) {
+  first_ = last_ = root_.get();
+}
+
+void BPlusTree::Build(const std::vector<std::pair<DataBox, size_t>> &entries) {
+  size_ = entries.size();
+  // the leaves, full.
+  std::vector<std::unique_ptr<Node>> level;
+  for (size_t i = 0; i < entries.size(); i += BTREE_FANOUT) {
+    std::unique_ptr<Node> leaf(new Node());
+    const size_t end = std::min(i + BTREE_FANOUT, entries.size());
+    leaf->keys_.reserve(end - i);
+    leaf->rows_.reserve(end - i);
+    for (size_t j = i; j < end; ++j) {
+      leaf->keys_.push_back(entries[j].first);
+      leaf->rows_.push_back(entries[j].second);
+    }
+    if (!level.empty()) {
+      level.back()->next_ = leaf.get();
+      leaf->prev_ = level.back().get();
+    }
+    level.push_back(std::move(leaf));
+  }
+  if (level.empty()) { level.push_back(std::unique_ptr<Node>(new Node())); }
+  first_ = level.front().get();
+  last_ = level.back().get();
+
+  // inner levels: the separator before a child is its first entry.
+  // first entries of subtrees, kept along with the level.
+  std::vector<std::pair<DataBox, size_t>> firsts;
+  for (const auto &node : level) {
+    firsts.push_back(node->keys_.empty() ? std::pair<DataBox, size_t>()
+                                         : std::make_pair(node->keys_[0], node->rows_[0]));
+  }
+  while (level.size() > 1) {
+    std::vector<std::unique_ptr<Node>> upper;
+    std::vector<std::pair<DataBox, size_t>> upper_firsts;
+    for (size_t i = 0; i < level.size(); i += BTREE_FANOUT) {
+      std::unique_ptr<Node> inner(new Node());
+      inner->leaf_ = false;
+      const size_t end = std::min(i + BTREE_FANOUT, level.size());
+      for (size_t j = i; j < end; ++j) {
+        if (j > i) {
+          inner->keys_.push_back(firsts[j].first);
+          inner->rows_.push_back(firsts[j].second);
+        }
+        inner->children_.push_back(std::move(level[j]));
+      }
+      upper_firsts.push_back(firsts[i]);
+      upper.push_back(std::move(inner));
+    }
+    level.swap(upper);
+    firsts.swap(upper_firsts);
+  }
+  root_ = std::move(level[0]);
+}
+
+auto BPlusTree::InsertInto(Node *node, const DataBox &key, size_t row, DataBox *sep_key, size_t *sep_row) 
+  -> std::unique_ptr<Node> {
+  if (node->leaf_) {
+    size_t pos = 0;
+    while (pos < node->keys_.size() && Less(node->keys_[pos], node->rows_[pos], key, row)) { ++pos; }
+    node->keys_.insert(node->keys_.begin() + pos, key);
+    node->rows_.insert(node->rows_.begin() + pos, row);
+    if (node->keys_.size() <= BTREE_FANOUT) { return nullptr; }
+
+    // split in half, link the new leaf after node.
+    std::unique_ptr<Node> right(new Node());
+    const size_t half = node->keys_.size() / 2;
+    right->keys_.assign(node->keys_.begin() + half, node->keys_.end());
+    right->rows_.assign(node->rows_.begin() + half, node->rows_.end());
+    node->keys_.resize(half);
+    node->rows_.resize(half);
+    *sep_key = right->keys_[0];
+    *sep_row = right->rows_[0];
+    right->next_ = node->next_;
+    right->prev_ = node;
+    if (static_cast<bool>(node->next_)) { node->next_->prev_ = right.get(); } else { last_ = right.get(); }
+    node->next_ = right.get();
+    return right;
+  }
+
+  const size_t idx = ChildOf(node, key, row);
+  DataBox child_key;
+  size_t child_row = 0;
+  std::unique_ptr<Node> child = InsertInto(node->children_[idx].get(), key, row, &child_key, &child_row);
+  if (!static_cast<bool>(child)) { return nullptr; }
+  node->keys_.insert(node->keys_.begin() + idx, child_key);
+  node->rows_.insert(node->rows_.begin() + idx, child_row);
+  node->children_.insert(node->children_.begin() + idx + 1, std::move(child));
+  if (node->children_.size() <= BTREE_FANOUT) { return nullptr; }
+
+  // split: separator half - 1 moves up.
+  std::unique_ptr<Node> right(new Node());
+  right->leaf_ = false;
+  const size_t half = node->children_.size() / 2;
+  *sep_key = node->keys_[half - 1];
+  *sep_row = node->rows_[half - 1];
+  right->keys_.assign(node->keys_.begin() + half, node->keys_.end());
+  right->rows_.assign(node->rows_.begin() + half, node->rows_.end());
+  for (size_t i = half; i < node->children_.size(); ++i) {
+    right->children_.push_back(std::move(node->children_[i]));
+  }
+  node->children_.resize(half);
+  node->keys_.resize(half - 1);
+  node->rows_.resize(half - 1);
+  return right;
+}
+
+void BPlusTree::Insert(const DataBox &key, size_t row) {
+  ++size_;
+  DataBox sep_key;
+  size_t sep_row = 0;
+  std::unique_ptr<Node> right = InsertInto(root_.get(), key, row, &sep_key, &sep_row);
+  if (!static_cast<bool>(right)) { return; }
+  std::unique_ptr<Node> root(new Node());
+  root->leaf_ = false;
+  root->keys_.push_back(sep_key);
+  root->rows_.push_back(sep_row);
+  root->children_.push_back(std::move(root_));
+  root->children_.push_back(std::move(right));
+  root_ = std::move(root);
+}
+
+auto BPlusTree::Erase(const DataBox &key, size_t row) -> bool {
+  Node *leaf = LeafOf(key, row);
+  for (size_t pos = 0; pos < leaf->keys_.size(); ++pos) {
+    if (leaf->rows_[pos] == row && DataBox::EqualTo(leaf->keys_[pos], key).getBoolValue()) {
+      leaf->keys_.erase(leaf->keys_.begin() + pos);
+      leaf->rows_.erase(leaf->rows_.begin() + pos);
+      --size_;
+      return true;
+    }
+  }
+  return false;
+}
+
+auto BPlusTree::Begin() const -> Iterator {
+  Iterator iter(this, first_, 0);
+  iter.Settle();
+  return iter;
+}
+
+auto BPlusTree::Seek(const DataBox &key, bool after) const -> Iterator {
+  // (key, 0) is before all entries of key, (key, -1) after them.
+  const size_t row = after ? static_cast<size_t>(-1) : 0;
+  const Node *leaf = LeafOf(key, row);
+  size_t pos = 0;
+  while (pos < leaf->keys_.size() && Less(leaf->keys_[pos], leaf->rows_[pos], key, row)) { ++pos; }
+  Iterator iter(this, leaf, pos);
+  iter.Settle();
+  return iter;
+}
+
+void BPlusTree::Iterator::Settle() {
+  while (leaf_ != nullptr && pos_ >= leaf_->keys_.size()) {
+    leaf_ = leaf_->next_;
+    pos_ = 0;
+  }
+}
+
+void BPlusTree::Iterator::Next() {
+  ++pos_;
+  Settle();
+}
+
+auto BPlusTree::Iterator::Prev() -> bool {
+  const Node *leaf = leaf_;
+  size_t pos = pos_;
+  if (leaf == nullptr) {
+    leaf = tree_->last_;
+    pos = leaf->keys_.size();
+  }
+  while (pos == 0) {
+    leaf = leaf->prev_;
+    if (leaf == nullptr) { return false; }
+    pos = leaf->keys_.size();
+  }
+  leaf_ = leaf;
+  pos_ = pos - 1;
+  return true;
+}
+
+}  // namespace cql
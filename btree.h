@@ -0,0 +1,122 @@
+/*****************************************************
+ * File: btree.h
+ * Author: Fudanyrd (email: yangrundong7@gmail.com)
+ *
+ * An in-memory B+tree over (key, row id) entries.
+ * Keys must be of one type(no NULLs); entries with
+ * equal keys are ordered by row id. Leaves are linked
+ * both ways, so ranges can be read in either order.
+ *****************************************************/
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "type.h"
+
+namespace cql {
+
+/** maximum number of entries in a leaf, and of children of an inner node. */
+const size_t BTREE_FANOUT = 64;
+
+class BPlusTree {
+ private:
+  struct Node {
+    bool leaf_{true};
+    /** leaf: entries; inner: separators, the first entry of children_[i + 1] when it was split. */
+    std::vector<DataBox> keys_;
+    std::vector<size_t> rows_;
+    /** inner node only. */
+    std::vector<std::unique_ptr<Node>> children_;
+    /** leaf chain. */
+    Node *prev_{nullptr};
+    Node *next_{nullptr};
+  };
+
+  std::unique_ptr<Node> root_;
+  /** first and last leaf of the chain. */
+  Node *first_{nullptr};
+  Node *last_{nullptr};
+  /** number of entries. */
+  size_t size_{0U};
+
+  /** @return true if (k1, r1) is before (k2, r2). */
+  static auto Less(const DataBox &k1, size_t r1, const DataBox &k2, size_t r2) -> bool;
+  /** @return index of the child of an inner node that may hold (key, row). */
+  static auto ChildOf(const Node *node, const DataBox &key, size_t row) -> size_t;
+  /** @return the leaf that may hold (key, row). */
+  auto LeafOf(const DataBox &key, size_t row) const -> Node *;
+
+  /**
+   * @brief insert into the subtree of node.
+   * @param sep_key[out], sep_row[out] the separator before the new sibling, if split.
+   * @return the new right sibling if node is split.
+   */
+  auto InsertInto(Node *node, const DataBox &key, size_t row, DataBox *sep_key, size_t *sep_row) 
+    -> std::unique_ptr<Node>;
+
+ public:
+  /** Position of an entry; past the last entry if leaf_ is nullptr. */
+  class Iterator {
+    friend class BPlusTree;
+   private:
+    const BPlusTree *tree_{nullptr};
+    const Node *leaf_{nullptr};
+    size_t pos_{0U};
+
+    Iterator(const BPlusTree *tree, const Node *leaf, size_t pos): tree_(tree), leaf_(leaf), pos_(pos) {}
+    /** move forward to an entry, if leaf_ ran out(leaves may be empty after erasing). */
+    void Settle();
+
+   public:
+    Iterator() = default;
+
+    auto isEnd() const -> bool { return leaf_ == nullptr; }
+    auto getKey() const -> const DataBox & { return leaf_->keys_[pos_]; }
+    auto getRow() const -> size_t { return leaf_->rows_[pos_]; }
+
+    /** @brief move to the next entry. */
+    void Next();
+
+    /**
+     * @brief move to the previous entry, from the end to the last one.
+     * @return false if there is no previous entry(the iterator is unchanged).
+     */
+    auto Prev() -> bool;
+  };
+
+  BPlusTree();
+  BPlusTree(BPlusTree &&that) = default;
+  auto operator=(BPlusTree &&that) -> BPlusTree & = default;
+
+  /**
+   * @brief replace all entries, built bottom-up.
+   * @param entries: sorted by (key, row).
+   */
+  void Build(const std::vector<std::pair<DataBox, size_t>> &entries);
+
+  void Insert(const DataBox &key, size_t row);
+
+  /**
+   * @brief erase an entry. Nodes are not merged, an underfull leaf stays in the chain.
+   * @return false if not found.
+   */
+  auto Erase(const DataBox &key, size_t row) -> bool;
+
+  /** @return number of entries. */
+  auto getSize() const -> size_t { return size_; }
+
+  /** @return the first entry. */
+  auto Begin() const -> Iterator;
+
+  /** @return past the last entry. */
+  auto End() const -> Iterator { return Iterator(this, nullptr, 0); }
+
+  /**
+   * @return the first entry whose key is not less than key(after: greater than key).
+   */
+  auto Seek(const DataBox &key, bool after) const -> Iterator;
+};
+
+}  // namespace cql
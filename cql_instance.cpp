@@ -113,6 +113,53 @@ void cqlInstance::execute(const Command &complete) {
     return;
   }
 
+  // adaptive indexing: range predicates on float columns crack copies of them.
+  // syntax: cracking on|off; turning it off drops the crackers.
+  if (complete.words_[0] == "cracking") {
+    cqlAssert(complete.words_.size() == 2 && (complete.words_[1] == "on" || complete.words_[1] == "off"),
+              "invalid syntax, use cracking on|off");
+    cracking_ = complete.words_[1] == "on";
+    if (!cracking_) {
+      for (auto &entry : table_mgn_) { entry.second.table_ptr_->dropIndexes(IndexType::Cracker); }
+    }
+    std::cout << "OK" << std::endl;
+    return;
+  }
+
+  // show how a select is executed.
+  // syntax: explain (analyze) select...; analyze runs it, and shows rows, time and memory of each executor.
+  if (complete.words_[0] == "explain") {
+    const bool analyze = complete.words_.size() > 1 && complete.words_[1] == "analyze";
+    Command select(complete);
+    select.words_.erase(select.words_.begin(), select.words_.begin() + (analyze ? 2 : 1));
+    cqlAssert(!select.words_.empty(), "nothing to explain");
+    auto log = Parser::Parse(select);
+    cqlAssert(log.exec_type_ == ExecutionType::Select, "only select can be explained");
+    PerformExplain(log, analyze);
+    std::cout << "OK." << std::endl;
+    return;
+  }
+
+  // collect statistics of tables for the planner.
+  // syntax: analyze table_name...
+  if (complete.words_[0] == "analyze") {
+    for (size_t i = 1; i < complete.words_.size(); ++i) {
+      auto iter = table_mgn_.find(complete.words_[i]);
+      if (iter == table_mgn_.end()) {
+        std::cout << "NOTE: maybe you've forgot to load the table " << complete.words_[i] << '.' << std::endl;
+        throw std::domain_error("trying to analyze a non-existing table?? Impossible!");
+      }
+      Table *table = iter->second.table_ptr_;
+      table->Materialize();
+      auto stats = TableStats::Analyze(*table);
+      table->setStats(stats);
+      std::cout << "table " << complete.words_[i] << ": ";
+      stats->printTo(std::cout);
+    }
+    std::cout << "OK" << std::endl;
+    return;
+  }
+
   // add variable.
   // support both 'var' and 'set' to declare variables.
   if (complete.words_[0] == "set" || complete.words_[0] == "var") {
@@ -176,12 +223,18 @@ void cqlInstance::execute(const Command &complete) {
   }
 
   // load some tables into memory.
+  // syntax: load (lazy) table_name...; a lazy table parses a column when a query first reads it.
   if (complete.words_[0] == "load") {
-    size_t i = 1;
+    const bool lazy = complete.words_.size() > 2 && complete.words_[1] == "lazy";
+    size_t i = lazy ? 2 : 1;
     for(; i < complete.words_.size(); ++i) {
       auto ptr = new Table();
       try {
-        ptr->load(complete.words_[i] + ".csv");
+        if (lazy) {
+          ptr->loadLazy(complete.words_[i] + ".csv");
+        } else {
+          ptr->load(complete.words_[i] + ".csv");
+        }
       } catch (std::domain_error &e) {
         std::cout << "cannot load table " << complete.words_[i] << std::endl;
         continue;
@@ -195,6 +248,10 @@ void cqlInstance::execute(const Command &complete) {
 
   // cql doesn't support drop.
   // syntax: create table (if not exists) table_name(header).
+  if (complete.words_[0] == "create" && complete.words_.size() > 1 && complete.words_[1] != "table") {
+    CreateIndex(complete);
+    return;
+  }
   if (complete.words_[0] == "create") {
     std::string header;
     std::string name;
@@ -289,6 +346,8 @@ auto cqlInstance::PerformInsert(const ParserLog &log) -> size_t {
     throw std::domain_error("trying to insert into a non-existing table?? Impossible!");
   }
   TableInfo &table_info = table_mgn_[log.table_];
+  // a modified table is dumped with all its columns.
+  table_info.table_ptr_->Materialize();
   const Schema *schema_ptr = table_info.table_ptr_->getSchema();
   size_t cols = schema_ptr->getNumCols();
   size_t rows = log.columns_.size();   
@@ -333,6 +392,39 @@ auto cqlInstance::PerformInsert(const ParserLog &log) -> size_t {
   table_info.is_dirty_ = true;
   return count;
 }
+void cqlInstance::CreateIndex(const Command &complete) {
+  const std::vector<std::string> &words = complete.words_;
+  size_t i = 1;
+  const bool unique = i < words.size() && words[i] == "unique";
+  if (unique) { ++i; }
+  IndexType type = IndexType::BTree;
+  if (i < words.size() && words[i] == "hash") {
+    type = IndexType::Hash;
+    ++i;
+  } else if (i < words.size() && words[i] == "bitmap") {
+    type = IndexType::Bitmap;
+    ++i;
+  } else if (i < words.size() && words[i] == "trigram") {
+    type = IndexType::Trigram;
+    ++i;
+  }
+  // index index_name on table_name ( #column )
+  cqlAssert(words.size() == i + 7 && words[i] == "index" && words[i + 2] == "on" && words[i + 4] == "(" 
+            && words[i + 5][0] == '#' && words[i + 6] == ")",
+            "invalid syntax, use create [unique] [hash|bitmap|trigram] index index_name on table_name(#column)");
+  const std::string &table_name = words[i + 3];
+  auto iter = table_mgn_.find(table_name);
+  if (iter == table_mgn_.end()) {
+    std::cout << "NOTE: maybe you've forgot to load the table " << table_name << '.' << std::endl;
+    throw std::domain_error("trying to index a non-existing table?? Impossible!");
+  }
+  Table *table = iter->second.table_ptr_;
+  const size_t col = table->getSchema()->getColumnIdx(words[i + 5].substr(1));
+  cqlAssert(col != static_cast<size_t>(-1), "unable to recognize column name");
+  table->createIndex(words[i + 1], col, type, unique);
+  std::cout << "OK" << std::endl;
+}
+
 /**
  * @return number of tuples deleted.
  */
@@ -341,12 +433,19 @@ auto cqlInstance::PerformDelete(const ParserLog &log) -> size_t {
     std::cout << "NOTE: maybe you've forgot to load the table " << log.table_ << '.' << std::endl;
     throw std::domain_error("trying to delete from a non-existing table?? Impossible!");
   }
-  size_t row = 0;    // current row number;
   size_t count = 0;   // number of tuples deleted.
+  Planner planner(&table_mgn_, &var_mgn_, cracking_);
+  planner.PlanSubqueries(log);
   TableInfo &table_info = table_mgn_[log.table_];
+  table_info.table_ptr_->Materialize();
   const std::vector<Tuple> &tuples = table_info.table_ptr_->getTuples();
+  // with an index, only rows it finds are checked.
+  std::vector<size_t> candidates;
+  const bool indexed = planner.IndexedRows(log, &candidates);
+  const size_t num_rows = indexed ? candidates.size() : tuples.size();
 
-  for (; row < tuples.size(); ++row) {
+  for (size_t i = 0; i < num_rows; ++i) {
+    const size_t row = indexed ? candidates[i] : i;    // current row number;
     if (static_cast<bool>(log.where_)) {
       DataBox evaluation = log.where_->Evaluate(&(tuples[row]), &var_mgn_, 0);
       if (evaluation.getBoolValue()) {
@@ -366,9 +465,11 @@ auto cqlInstance::PerformUpdate(const ParserLog &log) -> size_t {
     std::cout << "NOTE: maybe you've forgot to load the table " << log.table_ << '.' << std::endl;
     throw std::domain_error("trying to update from a non-existing table?? Impossible!");
   }
-  size_t row = 0;
   size_t count = 0;
+  Planner planner(&table_mgn_, &var_mgn_, cracking_);
+  planner.PlanSubqueries(log);
   TableInfo &table_info = table_mgn_[log.table_];
+  table_info.table_ptr_->Materialize();
   auto schema_ptr = table_info.table_ptr_->getSchema();
   const std::vector<Tuple> &tuples = table_info.table_ptr_->getTuples();
   // find the column to update.
@@ -381,7 +482,12 @@ auto cqlInstance::PerformUpdate(const ParserLog &log) -> size_t {
     if (col_name == schema_ptr->getColumn(col).second) { break; }
   }
   cqlAssert(col != schema_ptr->getNumCols(), "unable to recognize column name");
-  for (; row < tuples.size(); ++row) {
+  // with an index, only rows it finds are checked.
+  std::vector<size_t> candidates;
+  const bool indexed = planner.IndexedRows(log, &candidates);
+  const size_t num_rows = indexed ? candidates.size() : tuples.size();
+  for (size_t i = 0; i < num_rows; ++i) {
+    const size_t row = indexed ? candidates[i] : i;
     DataBox box = log.columns_[0]->Evaluate(&(tuples[row]), &var_mgn_, 0);
     if (static_cast<bool>(log.where_)) {
       DataBox pred = log.where_->Evaluate(&(tuples[row]), &var_mgn_, 0);
@@ -404,20 +510,37 @@ void cqlInstance::PerformSelect(const ParserLog &log) {
   fout << std::endl;
   fout.close();
 
-  Planner planner(&table_mgn_, &var_mgn_);
+  Planner planner(&table_mgn_, &var_mgn_, cracking_);
   AbstractExecutorRef exec = planner.GetExecutors(log);
   if (!static_cast<bool>(exec)) { return; }
   exec->Init();
-  Tuple temp;
-  while (exec->Next(&temp)) {
+  const Tuple *temp;
+  while (exec->NextRef(&temp)) {
     size_t i = 0;
-    temp.getColumnData(i).printTo(std::cout);
-    for (i = 1; i < temp.getSize(); ++i) {
+    temp->getColumnData(i).printTo(std::cout);
+    for (i = 1; i < temp->getSize(); ++i) {
       std::cout << ',';
-      temp.getColumnData(i).printTo(std::cout);
+      temp->getColumnData(i).printTo(std::cout);
     }
     std::cout << std::endl;
   }
 }
 
+void cqlInstance::PerformExplain(const ParserLog &log, bool analyze) {
+  // a plan only adds cracker indexes when it runs: explain shows the plan with the indexes there are.
+  // (parsing the columns of lazily loaded tables is kept, plans look at their data.)
+  Planner planner(&table_mgn_, &var_mgn_, cracking_ && analyze);
+  AbstractExecutorRef exec = planner.GetExecutors(log);
+  if (!static_cast<bool>(exec)) { return; }
+  if (analyze) {
+    // run the query, but leave the variables it would set alone.
+    if (exec->GetType() == ExecutorType::Dest) { exec = *exec->GetChildren()[0]; }
+    profileExecutors(&exec);
+    exec->Init();
+    const Tuple *temp;
+    while (exec->NextRef(&temp)) {}
+  }
+  explainTo(std::cout, exec);
+}
+
 }  // namespace cql
@@ -24,12 +24,20 @@ class cqlInstance {
  private:
   VariableManager var_mgn_;                               // manage the variable defined by users.
   std::unordered_map<std::string, TableInfo> table_mgn_;  // table manager.
+  bool cracking_{false};                                  // adaptive indexing of range predicates.
 
   void execute(const Command &complete);
+  /** syntax: create [unique] [hash|bitmap|trigram] index index_name on table_name(#column). */
+  void CreateIndex(const Command &complete);
   auto PerformInsert(const ParserLog &log) -> size_t;
   auto PerformDelete(const ParserLog &log) -> size_t;
   auto PerformUpdate(const ParserLog &log) -> size_t;
   void PerformSelect(const ParserLog &log);
+  /**
+   * print the executors of a select; if analyze, run it(without setting its dest variables)
+   * and print statistics of them too.
+   */
+  void PerformExplain(const ParserLog &log, bool analyze);
  public:
   cqlInstance() = default;
   // disallow copy.
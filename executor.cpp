@@ -1,6 +1,13 @@
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <iomanip>
+#include <sstream>
+#include <thread>
 #include <unordered_map>
 
+#include "blocking_queue.h"
 #include "executor.h"
 
 namespace cql {
@@ -8,13 +15,115 @@ namespace cql {
 /************************************************
  *              SeqScanExecutor
  ************************************************/
-auto SeqScanExecutor::Next(Tuple *tuple) -> bool {
+void SeqScanExecutor::PushPredicate(const AbstractExprRef &predicate, VariableManager *var_mgn) {
+  cqlAssert(static_cast<bool>(predicate), "pushing a null predicate into a scan");
+  var_mgn_ = var_mgn;
+  predicate_ = conjoinFilter(predicate_, predicate);
+  findColumnRanges(predicate, table_ptr_->getSchema(), &ranges_);
+}
+
+void SeqScanExecutor::PushColumns(const std::vector<size_t> &cols) {
+  cqlAssert(!cols.empty(), "a scan must materialize some columns");
+  const Schema *schema = qualified_ ? &qualified_schema_ : output_schema_;
+  columns_ = cols;
+  pruned_schema_ = Schema();
+  for (size_t col : columns_) {
+    cqlAssert(col < schema->getNumCols(), "column to materialize out of range");
+    pruned_schema_.AppendCol(schema->getColumn(col).first, schema->getColumn(col).second);
+  }
+}
+
+auto SeqScanExecutor::NextRef(const Tuple **tuple) -> bool {
+  const std::vector<Tuple> &tuples = table_ptr_->getTuples();
+  const size_t end = std::min(end_, tuples.size());
+  const ZoneMap &zones = table_ptr_->getZoneMap();
+  while (emitted_ < end) {
+    if (emitted_ / ZONE_ROWS != block_) {
+      block_ = emitted_ / ZONE_ROWS;
+      if (!zones.MayMatch(block_, ranges_)) {
+        emitted_ = (block_ + 1) * ZONE_ROWS;
+        continue;
+      }
+    }
+    const Tuple &row = tuples[emitted_++];
+    if (row.isDeleted()) { continue; }
+    if (static_cast<bool>(predicate_) && !predicate_->Evaluate(&row, var_mgn_, 0).getBoolValue()) { continue; }
+
+    if (!columns_.empty()) {
+      std::vector<DataBox> data;
+      data.reserve(columns_.size());
+      for (size_t col : columns_) { data.push_back(row.getColumnData(col)); }
+      buffer_ = Tuple(&pruned_schema_, std::move(data));
+      *tuple = &buffer_;
+    } else if (qualified_) {
+      buffer_ = Tuple(&qualified_schema_, row.getData());
+      *tuple = &buffer_;
+    } else {
+      *tuple = &row;
+    }
+    return true;
+  }
+  // no more tuples can be emitted.
+  return false;
+}
+
+/************************************************
+ *              IndexScanExecutor
+ ************************************************/
+IndexScanExecutor::IndexScanExecutor(const std::string &name, std::unordered_map<std::string, TableInfo> *tb_mgn,
+                                     const BTreeIndex *index, const ColumnRange &range, bool descending)
+  : table_name_(name), ordered_(true), index_(index), range_(range), descending_(descending) {
+  this->exec_type_ = ExecutorType::IndexScan;
+  auto iter = tb_mgn->find(name);
+  cqlAssert(iter != tb_mgn->end(), "cannot find table in checklist");
+  table_ptr_ = iter->second.table_ptr_;
+  this->output_schema_ = table_ptr_->getSchema();
+}
+
+IndexScanExecutor::IndexScanExecutor(const std::string &name, std::unordered_map<std::string, TableInfo> *tb_mgn,
+                                     const RowFinder &finder, const std::string &how)
+  : table_name_(name), ordered_(false), finder_(finder), how_(how) {
+  this->exec_type_ = ExecutorType::IndexScan;
+  auto iter = tb_mgn->find(name);
+  cqlAssert(iter != tb_mgn->end(), "cannot find table in checklist");
+  table_ptr_ = iter->second.table_ptr_;
+  this->output_schema_ = table_ptr_->getSchema();
+}
+
+void IndexScanExecutor::Init() {
+  if (!ordered_) {
+    rows_.clear();
+    finder_(&rows_);
+    pos_ = 0;
+  } else if (descending_) {
+    iter_ = index_->UpperBound(range_, &valid_);
+  } else {
+    iter_ = index_->LowerBound(range_);
+    valid_ = !iter_.isEnd();
+  }
+}
+
+auto IndexScanExecutor::NextRef(const Tuple **tuple) -> bool {
   const std::vector<Tuple> &tuples = table_ptr_->getTuples();
-  if (emitted_ >= tuples.size()) { 
-    // no more tuples can be emitted.
+  if (!ordered_) {
+    if (pos_ >= rows_.size()) { return false; }
+    *tuple = &tuples[rows_[pos_++]];
+    return true;
+  }
+
+  if (!valid_) { return false; }
+  const DataBox &key = iter_.getKey();
+  if (descending_ ? !BTreeIndex::AboveLow(key, range_) : !BTreeIndex::BelowHigh(key, range_)) {
+    valid_ = false;
     return false;
   }
-  *tuple = tuples[emitted_++];
+  *tuple = &tuples[iter_.getRow()];
+  if (descending_) {
+    valid_ = iter_.Prev();
+  } else {
+    iter_.Next();
+    valid_ = !iter_.isEnd();
+  }
   return true;
 }
 
@@ -24,8 +133,8 @@ auto SeqScanExecutor::Next(Tuple *tuple) -> bool {
 auto ProjectionExecutor::Next(Tuple *tuple) -> bool {
   if (static_cast<bool>(child_)) {
     // OK, getting values from tables.
-    Tuple tp;
-    if (child_->Next(&tp)) {
+    const Tuple *tp;
+    if (child_->NextRef(&tp)) {
       // std::cout << tp.getSchema() << std::endl;
       // for (const auto &box : tp.getData()) {
       //   box.printTo(std::cout); std::cout << ',';
@@ -33,9 +142,9 @@ auto ProjectionExecutor::Next(Tuple *tuple) -> bool {
       std::vector<DataBox> data;
       for (const auto &expr : columns_) {
         // std::cout << expr->toString() << std::endl;
-        data.push_back(expr->Evaluate(&tp, var_mgn_, 0));
+        data.push_back(expr->Evaluate(tp, var_mgn_, 0));
       }
-      *tuple = Tuple(output_schema_, data);
+      *tuple = Tuple(&schema_, std::move(data));
       return true;
     }
 
@@ -57,7 +166,7 @@ auto ProjectionExecutor::Next(Tuple *tuple) -> bool {
       for (const auto &expr : columns_) {
         data.push_back(expr->Evaluate(nullptr, var_mgn_, 0));
       }
-      *tuple = Tuple(output_schema_, data);
+      *tuple = Tuple(&schema_, std::move(data));
       return true;
     }
     return false;
@@ -74,16 +183,16 @@ auto ProjectionExecutor::Next(Tuple *tuple) -> bool {
   if (!has_next) { return false; }
   // pitfall: forget to update counter.
   ++count_;
-  *tuple = Tuple(output_schema_, data);
+  *tuple = Tuple(&schema_, std::move(data));
   return true;
 }
 
 /************************************************
  *                DestExecutor
  ************************************************/
-auto DestExecutor::Next(Tuple *tuple) -> bool {
-  Tuple tp;
-  bool has_next = child_->Next(&tp);
+auto DestExecutor::NextRef(const Tuple **tuple) -> bool {
+  const Tuple *tp;
+  bool has_next = child_->NextRef(&tp);
   if (!has_next) { return false; }
 
   // append the value to variables.
@@ -94,7 +203,7 @@ auto DestExecutor::Next(Tuple *tuple) -> bool {
     }
     // more variables than columns is allowed!
     // though the value will be INVALID in this case...
-    var_mgn_->Append(destinations_[i], tp.getColumnData(i));
+    var_mgn_->Append(destinations_[i], tp->getColumnData(i));
   }
   *tuple = tp;
 
@@ -104,10 +213,10 @@ auto DestExecutor::Next(Tuple *tuple) -> bool {
 /************************************************
  *               FilterExecutor 
  ************************************************/
-auto FilterExecutor::Next(Tuple *tuple) -> bool {
-  Tuple tp;
-  while (child_->Next(&tp)) {
-    DataBox evaluation = predicate_->Evaluate(&tp, var_mgn_, 0);
+auto FilterExecutor::NextRef(const Tuple **tuple) -> bool {
+  const Tuple *tp;
+  while (child_->NextRef(&tp)) {
+    DataBox evaluation = predicate_->Evaluate(tp, var_mgn_, 0);
     if (evaluation.getBoolValue()) {
       *tuple = tp;
       return true;
@@ -119,15 +228,15 @@ auto FilterExecutor::Next(Tuple *tuple) -> bool {
 /************************************************
  *                LimitExecutor 
  ************************************************/
-auto LimitExecutor::Next(Tuple *tuple) -> bool {
+auto LimitExecutor::NextRef(const Tuple **tuple) -> bool {
   // Tuple tp;
   for (; count_ < offset_; ++count_) {
-    if (!child_->Next(tuple)) { return false; }
+    if (!child_->NextRef(tuple)) { return false; }
   }
   size_t end = limit_ == static_cast<size_t>(-1) ? limit_ : (limit_ + offset_);
   if (count_ >= end) { return false; }
 
-  if (!child_->Next(tuple)) {
+  if (!child_->NextRef(tuple)) {
     return false;
   }
   ++count_;
@@ -148,7 +257,8 @@ auto TupleComparator::compare(const Tuple &t1, const Tuple &t2) const -> bool {
     return order_by_type_[i] == OrderByType::ASC ? less.getBoolValue() : (!less.getBoolValue());
   }
 
-  return true;
+  // equal tuples: a strict weak ordering is required by std::sort and the merge heap.
+  return false;
 }
 
 /************************************************
@@ -156,19 +266,108 @@ auto TupleComparator::compare(const Tuple &t1, const Tuple &t2) const -> bool {
  ************************************************/
 void SortExecutor::Init() {
   count_ = 0;
+  helpers_.clear();
+  runs_.clear();
+  heap_.clear();
+  tuple_schema_ = nullptr;
+  peak_memory_ = 0;
   child_->Init();
-  SortHelper helper(&comparator_, Tuple());
 
-  while (child_->Next(&(helper.tuple_))) {
-    helpers_.push_back(helper);
+  size_t memory_used = 0;
+  const Tuple *tuple;
+  while (child_->NextRef(&tuple)) {
+    if (!static_cast<bool>(tuple_schema_)) { tuple_schema_ = tuple->getSchema(); }
+    memory_used += tuple->getMemorySize() + sizeof(SortHelper);
+    helpers_.push_back(SortHelper(&comparator_, *tuple));
+    peak_memory_ = std::max(peak_memory_, memory_used);
+    if (memory_used > memory_budget_) {
+      SpillRun();
+      memory_used = 0;
+    }
   }
 
   std::sort(helpers_.begin(), helpers_.end(), SortHelper::compare);
+  if (runs_.empty()) {
+    // everything fits in memory, no need to merge.
+    return;
+  }
+
+  // k-way merge of the runs on disk and the run in memory.
+  for (const auto &run : runs_) { run->Rewind(); }
+  for (size_t i = 0; i <= runs_.size(); ++i) { PushRun(i); }
 }
 
-auto SortExecutor::Next(Tuple *tuple) -> bool {
-  if (count_ >= helpers_.size()) { return false; }
-  *tuple = helpers_[count_++].tuple_;
+void TopNExecutor::Init() {
+  count_ = 0;
+  entries_.clear();
+  peak_memory_ = 0;
+  child_->Init();
+  if (n_ == 0) { return; }
+
+  const EntryComparator cmp{&comparator_};
+  const Tuple *tuple;
+  size_t seq = 0;
+  for (; child_->NextRef(&tuple); ++seq) {
+    if (entries_.size() < n_) {
+      entries_.push_back({*tuple, seq});
+      std::push_heap(entries_.begin(), entries_.end(), cmp);
+      continue;
+    }
+    // ties come later than the last kept, so only a tuple strictly before it is kept.
+    if (!comparator_.compare(*tuple, entries_.front().tuple_)) { continue; }
+    std::pop_heap(entries_.begin(), entries_.end(), cmp);
+    entries_.back().tuple_ = *tuple;
+    entries_.back().seq_ = seq;
+    std::push_heap(entries_.begin(), entries_.end(), cmp);
+  }
+  std::sort_heap(entries_.begin(), entries_.end(), cmp);
+  for (const auto &entry : entries_) { peak_memory_ += entry.tuple_.getMemorySize() + sizeof(Entry); }
+}
+
+auto TopNExecutor::NextRef(const Tuple **tuple) -> bool {
+  if (count_ >= entries_.size()) { return false; }
+  *tuple = &entries_[count_++].tuple_;
+  return true;
+}
+
+void SortExecutor::SpillRun() {
+  std::sort(helpers_.begin(), helpers_.end(), SortHelper::compare);
+  auto run = std::make_shared<SpillFile>();
+  for (const auto &helper : helpers_) {
+    run->Append(helper.tuple_);
+  }
+  runs_.push_back(run);
+  // release the memory rather than just clearing the elements.
+  std::vector<SortHelper>().swap(helpers_);
+}
+
+void SortExecutor::PushRun(size_t run) {
+  MergeEntry entry;
+  entry.run_ = run;
+  if (run < runs_.size()) {
+    if (!runs_[run]->Read(&entry.tuple_, tuple_schema_)) { return; }
+  } else {
+    if (count_ >= helpers_.size()) { return; }
+    entry.tuple_ = std::move(helpers_[count_++].tuple_);
+  }
+  heap_.push_back(std::move(entry));
+  std::push_heap(heap_.begin(), heap_.end(), MergeEntryComparator{&comparator_});
+}
+
+auto SortExecutor::NextRef(const Tuple **tuple) -> bool {
+  if (runs_.empty()) {
+    if (count_ >= helpers_.size()) { return false; }
+    *tuple = &helpers_[count_++].tuple_;
+    return true;
+  }
+
+  if (heap_.empty()) { return false; }
+  std::pop_heap(heap_.begin(), heap_.end(), MergeEntryComparator{&comparator_});
+  buffer_ = std::move(heap_.back().tuple_);
+  *tuple = &buffer_;
+  size_t run = heap_.back().run_;
+  heap_.pop_back();
+  PushRun(run);
   return true;
 }
 
@@ -177,123 +376,917 @@ auto SortExecutor::Next(Tuple *tuple) -> bool {
  ************************************************/
 AggExecutor::AggExecutor(const std::vector<AbstractExprRef> &columns, const std::vector<AbstractExprRef> &group_by, 
                          const std::vector<AbstractExprRef> &order_by, AbstractExprRef having, VariableManager *var_mgn, 
-                         AbstractExecutorRef child) 
-                         : columns_(columns), group_by_(group_by), having_(having), order_by_(order_by) {
+                         AbstractExecutorRef child, size_t num_threads) 
+                         : columns_(columns), group_by_(group_by), having_(having), order_by_(order_by),
+                           num_threads_(num_threads) {
   exec_type_ = ExecutorType::AggExec;
   var_mgn_ = var_mgn;
   this->child_ = child;
 
-  /** find aggregation expressions */
-  std::unordered_map<std::string, AbstractExprRef> agg_exprs; 
-  for (const auto &ref : columns_) {
-    findAggExprs(ref, agg_exprs);
+  /** find aggregation expressions, then create schema */
+  std::vector<AbstractExprRef> agg_vals = collectAggExprs(columns_, order_by_, having_);
+  this->schema_ = makeAggSchema(group_by_, agg_vals);
+
+  /** compile aggregation expressions once rather than per tuple. */
+  funcs_.reserve(agg_vals.size());
+  for (const auto &ref : agg_vals) {
+    funcs_.push_back(AggregateFunction::Make(ref));
+    // partial states must be mergeable to aggregate in parallel.
+    if (!static_cast<bool>(funcs_.back().merge_)) { num_threads_ = 1; }
   }
-  for (const auto &ref : order_by_) {
-    findAggExprs(ref, agg_exprs);
+}
+
+void AggExecutor::Init() {
+  /** get tuples from child. */
+  tables_.clear();
+  tables_ = num_threads_ > 1 ? BuildParallel() : BuildSerial();
+  table_idx_ = 0;
+  group_idx_ = 0;
+  peak_memory_ = 0;
+  for (const auto &table : tables_) { peak_memory_ += table.getMemorySize(); }
+}
+
+auto AggExecutor::Next(Tuple *tuple) -> bool {
+  while (table_idx_ < tables_.size() && group_idx_ >= tables_[table_idx_].getNumGroups()) {
+    // release groups already emitted.
+    tables_[table_idx_] = AggregationHashTable(group_by_.size(), funcs_.size(), 0);
+    ++table_idx_;
+    group_idx_ = 0;
   }
-  if (static_cast<bool>(having_)) {
-    findAggExprs(having_, agg_exprs);
-  }  // OK
+  if (table_idx_ >= tables_.size()) { return false; }
 
-  /** create schema and then tables */
-  Schema table_schema;
-  std::vector<AbstractExprRef> agg_vals;  // used to yield data box from tuples.
-  agg_vals.reserve(agg_exprs.size());
-  // group_by_ : key
-  for (const auto &expr : group_by_) {
-    // how to set the type of columns??? a potential deficiency...
-    table_schema.AppendCol(TypeId::INVALID, expr->toString());
+  AggregationHashTable &table = tables_[table_idx_];
+  DataBox *group_keys = table.getKeys(group_idx_);
+  const AggregateState *states = table.getStates(group_idx_);
+  std::vector<DataBox> data;
+  data.reserve(group_by_.size() + funcs_.size());
+  for (size_t i = 0; i < group_by_.size(); ++i) {
+    data.push_back(std::move(group_keys[i]));
   }
-  // agg_exprs: value
-  for (const auto &pair : agg_exprs) {
-    agg_vals.push_back(pair.second);
-    table_schema.AppendCol(TypeId::INVALID, pair.second->toString());
+  for (size_t i = 0; i < funcs_.size(); ++i) {
+    data.push_back(funcs_[i].finalize_(states[i]));
   }
-  this->schema_ = table_schema;
-  this->table_ = Table(this->schema_); // OK
+  ++group_idx_;
+  *tuple = Tuple(&schema_, std::move(data));
+  return true;
+}
 
-  /** get tuples from child. */
-  std::unordered_map<std::string, std::vector<DataBox>> agg_table;  // table of aggregation values.
-  child_->Init();
-  Tuple tp;
-  while (child_->Next(&tp)) {
-    // evaluate the tuple and generate aggregation key.
-    std::vector<DataBox> boxes;
-    boxes.reserve(group_by_.size() + agg_vals.size());
-    std::string key;  // key used to get aggregate values.
-    for (const auto &ref : group_by_) {
-      DataBox box = ref->Evaluate(&tp, this->var_mgn_, 0);
-      key += DataBox::toString(box);
-      boxes.push_back(box);
+void AggExecutor::Accumulate(AggregationHashTable *table, const std::vector<DataBox> &keys, uint64_t hash,
+                             const Tuple &tuple) const {
+  bool inserted;
+  AggregateState *states = table->FindOrInsert(keys.data(), hash, &inserted);
+  for (size_t i = 0; i < funcs_.size(); ++i) {
+    DataBox val = funcs_[i].input_->Evaluate(&tuple, this->var_mgn_, 0);
+    if (inserted) {
+      funcs_[i].init_(&states[i], val, funcs_[i].param_);
+    } else {
+      funcs_[i].update_(&states[i], val);
     }
-    for (const auto &ref : agg_vals) {
-      auto agg_ptr = dynamic_cast<const AggregateExpr *>(ref.get());
-      boxes.push_back(static_cast<bool>(agg_ptr) 
-                      ? agg_ptr->child_->Evaluate(&tp, this->var_mgn_, 0)
-                      : ref->Evaluate(&tp, this->var_mgn_, 0));
+  }
+}
+
+auto AggExecutor::BuildSerial() -> std::vector<AggregationHashTable> {
+  std::vector<AggregationHashTable> res;
+  res.push_back(AggregationHashTable(group_by_.size(), funcs_.size()));
+  std::vector<DataBox> keys(group_by_.size());
+  child_->Init();
+  const Tuple *tp;
+  while (child_->NextRef(&tp)) {
+    // evaluate the tuple and generate typed aggregation key.
+    for (size_t i = 0; i < group_by_.size(); ++i) {
+      keys[i] = group_by_[i]->Evaluate(tp, this->var_mgn_, 0);
     }
+    Accumulate(&res[0], keys, AggregationHashTable::HashKeys(keys.data(), keys.size()), *tp);
+  }
+  return res;
+}
 
-    // update the value in aggregation table.
-    if (agg_table.find(key) == agg_table.end()) {
-      agg_table[key] = boxes;
-    } else {
-      // update by aggregation type.
-      std::vector<DataBox> &data = agg_table[key];
-      for (size_t i = group_by_.size(); i < boxes.size(); ++i) {
-        AbstractExprRef ref = agg_vals[i - group_by_.size()];
-        auto agg_ptr = dynamic_cast<const AggregateExpr *>(ref.get());
-        cqlAssert(static_cast<bool>(agg_ptr), "pointer to aggregation expr is null");
-
-        switch(agg_ptr->agg_type_) {
-          case AggregateType::Agg: {
-            data[i] = boxes[i];
-            break;
-          }
-          case AggregateType::Count: {
-            data[i] = DataBox(data[i].getFloatValue() + 1.0);
-            break;
-          }
-          case AggregateType::Max: {
-            if (DataBox::LessThan(data[i], boxes[i]).getBoolValue()) {
-              data[i] = boxes[i];
-            }
-            break;
-          }
-          case AggregateType::Min: {
-            if (DataBox::GreaterThan(data[i], boxes[i]).getBoolValue()) {
-              data[i] = boxes[i];
-            }
-            break;
-          }
-          case AggregateType::Sum: {
-            switch(data[i].getType()) {
-              case TypeId::Float:
-                data[i] = DataBox(data[i].getFloatValue() + DataBox::toFloat(boxes[i]).getFloatValue());
-                break;
-              case TypeId::Bool: {
-                // (bool) a + (bool) b = a | b.
-                bool res = data[i].getBoolValue() || DataBox::toBool(boxes[i]).getBoolValue();
-                data[i] = DataBox(res); 
-                break;
-              }
-              case TypeId::Char:
-                data[i] = DataBox(TypeId::Char, data[i].getStrValue() + DataBox::toString(boxes[i]));
-                break;
-              default:
-                break;
-            }
-            break;
+auto AggExecutor::BuildParallel() -> std::vector<AggregationHashTable> {
+  const size_t num_partitions = static_cast<size_t>(1) << AGG_RADIX_BITS;
+  const size_t num_keys = group_by_.size();
+  // thread-local tables, one for each radix partition.
+  std::vector<std::vector<AggregationHashTable>> locals(
+    num_threads_, std::vector<AggregationHashTable>(num_partitions, AggregationHashTable(num_keys, funcs_.size())));
+  std::vector<std::exception_ptr> errors(num_threads_);
+  BlockingQueue<std::vector<Tuple>> queue(num_threads_ * 2);
+  std::atomic<bool> failed(false);
+
+  /** phase 1: pre-aggregate batches into thread-local partitions. */
+  auto pre_aggregate = [&](size_t id) {
+    try {
+      std::vector<DataBox> keys(num_keys);
+      std::vector<Tuple> batch;
+      while (queue.Pop(&batch)) {
+        for (const auto &tp : batch) {
+          for (size_t i = 0; i < num_keys; ++i) {
+            keys[i] = group_by_[i]->Evaluate(&tp, this->var_mgn_, 0);
           }
+          uint64_t hash = AggregationHashTable::HashKeys(keys.data(), num_keys);
+          // high bits pick the partition, low bits pick the slot.
+          Accumulate(&locals[id][hash >> (64 - AGG_RADIX_BITS)], keys, hash, tp);
         }
+      }
+    } catch (...) {
+      errors[id] = std::current_exception();
+      failed = true;
+      queue.Close();
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t id = 0; id < num_threads_; ++id) {
+    workers.push_back(std::thread(pre_aggregate, id));
+  }
+
+  std::exception_ptr error;
+  try {
+    child_->Init();
+    std::vector<Tuple> batch(AGG_BATCH_SIZE);
+    size_t size = 0;
+    while (!failed && child_->Next(&batch[size])) {
+      if (++size == AGG_BATCH_SIZE) {
+        queue.Push(std::move(batch));
+        batch = std::vector<Tuple>(AGG_BATCH_SIZE);
+        size = 0;
+      }
+    }
+    batch.resize(size);
+    if (size > 0) { queue.Push(std::move(batch)); }
+  } catch (...) {
+    error = std::current_exception();
+  }
+  queue.Close();
+  for (auto &worker : workers) { worker.join(); }
+  if (static_cast<bool>(error)) { std::rethrow_exception(error); }
+  for (const auto &err : errors) {
+    if (static_cast<bool>(err)) { std::rethrow_exception(err); }
+  }
+
+  /** phase 2: merge the same partition of all workers. */
+  std::vector<AggregationHashTable> merged;
+  for (size_t p = 0; p < num_partitions; ++p) {
+    merged.push_back(std::move(locals[0][p]));
+  }
+  std::atomic<size_t> next_partition(0);
+  auto merge = [&](size_t id) {
+    try {
+      size_t p;
+      while ((p = next_partition++) < num_partitions) {
+        for (size_t t = 1; t < num_threads_; ++t) {
+          merged[p].Merge(locals[t][p], funcs_);
+        }
+      }
+    } catch (...) {
+      errors[id] = std::current_exception();
+    }
+  };
+  workers.clear();
+  for (size_t id = 0; id < num_threads_; ++id) {
+    workers.push_back(std::thread(merge, id));
+  }
+  for (auto &worker : workers) { worker.join(); }
+  for (const auto &err : errors) {
+    if (static_cast<bool>(err)) { std::rethrow_exception(err); }
+  }
+  return merged;
+}
 
+/************************************************
+ *              StreamAggExecutor 
+ ************************************************/
+StreamAggExecutor::StreamAggExecutor(const std::vector<AbstractExprRef> &columns, 
+                                     const std::vector<AbstractExprRef> &group_by, 
+                                     const std::vector<AbstractExprRef> &order_by, AbstractExprRef having, 
+                                     VariableManager *var_mgn, AbstractExecutorRef child)
+                                     : group_by_(group_by), child_(child), var_mgn_(var_mgn) {
+  exec_type_ = ExecutorType::StreamAgg;
+  cqlAssert(static_cast<bool>(child_), "child of stream agg executor is null");
+  std::vector<AbstractExprRef> agg_vals = collectAggExprs(columns, order_by, having);
+  schema_ = makeAggSchema(group_by_, agg_vals);
+  for (const auto &ref : agg_vals) {
+    funcs_.push_back(AggregateFunction::Make(ref));
+  }
+}
+
+void StreamAggExecutor::ReadAhead() {
+  has_next_ = child_->NextRef(&next_tuple_);
+  if (!has_next_) { return; }
+  next_keys_.resize(group_by_.size());
+  for (size_t i = 0; i < group_by_.size(); ++i) {
+    next_keys_[i] = group_by_[i]->Evaluate(next_tuple_, var_mgn_, 0);
+  }
+}
+
+auto StreamAggExecutor::Next(Tuple *tuple) -> bool {
+  if (!has_next_ && (emitted_ || !group_by_.empty())) { return false; }
+
+  states_.assign(funcs_.size(), AggregateState());
+  if (has_next_) {
+    // the tuple read ahead starts a new group.
+    keys_.swap(next_keys_);
+    for (size_t i = 0; i < funcs_.size(); ++i) {
+      funcs_[i].init_(&states_[i], funcs_[i].input_->Evaluate(next_tuple_, var_mgn_, 0), funcs_[i].param_);
+    }
+
+    for (ReadAhead(); has_next_; ReadAhead()) {
+      size_t i = 0;
+      while (i < keys_.size() && DataBox::Identical(keys_[i], next_keys_[i])) { ++i; }
+      if (i != keys_.size()) {
+        // keys changed, the group is complete.
+        break;
+      }
+      for (i = 0; i < funcs_.size(); ++i) {
+        funcs_[i].update_(&states_[i], funcs_[i].input_->Evaluate(next_tuple_, var_mgn_, 0));
       }
     }
   }
 
-  for (const auto &pair : agg_table) {
-    table_.insertTuple(pair.second);
+  std::vector<DataBox> data(keys_);
+  for (size_t i = 0; i < funcs_.size(); ++i) {
+    data.push_back(funcs_[i].finalize_(states_[i]));
   }
-  // table_.dump(std::cout);
+  emitted_ = true;
+  *tuple = Tuple(&schema_, std::move(data));
+  return true;
+}
+
+/************************************************
+ *                TopKExecutor
+ ************************************************/
+TopKExecutor::TopKExecutor(const AbstractExprRef &topk, VariableManager *var_mgn, AbstractExecutorRef child)
+  : child_(child), var_mgn_(var_mgn) {
+  this->exec_type_ = ExecutorType::TopKExec;
+  auto agg_ptr = dynamic_cast<const AggregateExpr *>(topk.get());
+  cqlAssert(static_cast<bool>(agg_ptr) && agg_ptr->agg_type_ == AggregateType::TopK, "not a topk expression");
+  cqlAssert(agg_ptr->param_ >= 1.0 && agg_ptr->param_ == floor(agg_ptr->param_), 
+            "k of topk is not a positive integer");
+  input_ = agg_ptr->child_;
+  k_ = static_cast<size_t>(agg_ptr->param_);
+  schema_.AppendCol(TypeId::INVALID, input_->toString());
+  schema_.AppendCol(TypeId::Float, "count");
+  schema_.AppendCol(TypeId::Float, "error");
+}
+
+void TopKExecutor::Init() {
+  child_->Init();
+  SpaceSaving sketch(k_);
+  const Tuple *tuple;
+  while (child_->NextRef(&tuple)) {
+    sketch.Update(input_->Evaluate(tuple, var_mgn_, 0));
+  }
+  counters_ = sketch.getTopK();
+  emitted_ = 0;
+}
+
+auto TopKExecutor::Next(Tuple *tuple) -> bool {
+  if (emitted_ >= counters_.size()) { return false; }
+  const SpaceSaving::Counter &counter = counters_[emitted_++];
+  std::vector<DataBox> data = {counter.value_, DataBox(counter.count_), DataBox(counter.error_)};
+  *tuple = Tuple(&schema_, std::move(data));
+  return true;
+}
+
+/************************************************
+ *              HashJoinExecutor
+ ************************************************/
+HashJoinExecutor::HashJoinExecutor(AbstractExecutorRef left, AbstractExecutorRef right, const AbstractExprRef &on,
+                                   VariableManager *var_mgn, bool build_left)
+  : left_(left), right_(right), var_mgn_(var_mgn), build_left_(build_left),
+    schema_(makeJoinSchema(left->GetOutputSchema(), right->GetOutputSchema())),
+    cond_(JoinCondition::Make(on, left->GetOutputSchema(), right->GetOutputSchema())),
+    table_(cond_.left_keys_.size()) {
+  this->exec_type_ = ExecutorType::HashJoin;
+  cqlAssert(!cond_.left_keys_.empty(), "hash join needs an equality between columns of the two tables");
+}
+
+auto HashJoinExecutor::EvaluateKeys(const Tuple &tuple, const std::vector<AbstractExprRef> &exprs, 
+                                    std::vector<DataBox> *keys) const -> bool {
+  keys->resize(exprs.size());
+  for (size_t i = 0; i < exprs.size(); ++i) {
+    (*keys)[i] = exprs[i]->Evaluate(&tuple, var_mgn_, 0);
+    if ((*keys)[i].getType() == TypeId::INVALID) { return false; }
+  }
+  return true;
+}
+
+void HashJoinExecutor::Init() {
+  AbstractExecutorRef build = build_left_ ? left_ : right_;
+  AbstractExecutorRef probe = build_left_ ? right_ : left_;
+  const std::vector<AbstractExprRef> &build_keys = build_left_ ? cond_.left_keys_ : cond_.right_keys_;
+  build->Init();
+  probe->Init();
+
+  table_ = JoinHashTable(build_keys.size());
+  Tuple tuple;
+  std::vector<DataBox> keys;
+  while (build->Next(&tuple)) {
+    if (!EvaluateKeys(tuple, build_keys, &keys)) { continue; }
+    table_.Insert(keys.data(), AggregationHashTable::HashKeys(keys.data(), keys.size()), std::move(tuple));
+  }
+  table_.Build();
+  match_ = static_cast<size_t>(-1);
+}
+
+auto HashJoinExecutor::Next(Tuple *tuple) -> bool {
+  AbstractExecutorRef probe = build_left_ ? right_ : left_;
+  const std::vector<AbstractExprRef> &probe_keys = build_left_ ? cond_.right_keys_ : cond_.left_keys_;
+  while (true) {
+    while (!JoinHashTable::isValid(match_)) {
+      if (!probe->NextRef(&probe_)) { return false; }
+      if (!EvaluateKeys(*probe_, probe_keys, &probe_keys_)) { continue; }
+      probe_hash_ = AggregationHashTable::HashKeys(probe_keys_.data(), probe_keys_.size());
+      match_ = table_.Find(probe_keys_.data(), probe_hash_);
+    }
+
+    const Tuple &row = table_.getRow(match_);
+    match_ = table_.FindNext(match_, probe_keys_.data(), probe_hash_);
+    const Tuple &left = build_left_ ? row : *probe_;
+    const Tuple &right = build_left_ ? *probe_ : row;
+    std::vector<DataBox> data;
+    data.reserve(left.getSize() + right.getSize());
+    data.insert(data.end(), left.getData().begin(), left.getData().end());
+    data.insert(data.end(), right.getData().begin(), right.getData().end());
+    *tuple = Tuple(&schema_, std::move(data));
+    if (!static_cast<bool>(cond_.residual_) || cond_.residual_->Evaluate(tuple, var_mgn_, 0).getBoolValue()) {
+      return true;
+    }
+  }
+}
+
+/************************************************
+ *            SortMergeJoinExecutor
+ ************************************************/
+SortMergeJoinExecutor::SortMergeJoinExecutor(AbstractExecutorRef left, AbstractExecutorRef right, 
+                                             const AbstractExprRef &on, VariableManager *var_mgn, 
+                                             bool left_sorted, bool right_sorted)
+  : left_(left), right_(right), var_mgn_(var_mgn),
+    schema_(makeJoinSchema(left->GetOutputSchema(), right->GetOutputSchema())),
+    cond_(std::make_shared<JoinCondition>(JoinCondition::Make(on, left->GetOutputSchema(), 
+                                                              right->GetOutputSchema()))) {
+  this->exec_type_ = ExecutorType::MergeJoin;
+  cqlAssert(!cond_->left_keys_.empty(), "merge join needs an equality between columns of the two tables");
+  order_ = std::make_shared<std::vector<OrderByType>>(cond_->left_keys_.size(), OrderByType::ASC);
+  if (!left_sorted) {
+    left_ = std::make_shared<SortExecutor>(SortExecutor(cond_->left_keys_, *order_, left_));
+  }
+  if (!right_sorted) {
+    right_ = std::make_shared<SortExecutor>(SortExecutor(cond_->right_keys_, *order_, right_));
+  }
+}
+
+auto SortMergeJoinExecutor::Advance(const AbstractExecutorRef &child, const std::vector<AbstractExprRef> &exprs, 
+                                    Tuple *tuple, std::vector<DataBox> *keys) -> bool {
+  keys->resize(exprs.size());
+  while (child->Next(tuple)) {
+    size_t i = 0;
+    for (; i < exprs.size(); ++i) {
+      (*keys)[i] = exprs[i]->Evaluate(tuple, var_mgn_, 0);
+      if ((*keys)[i].getType() == TypeId::INVALID) { break; }
+    }
+    // NULL keys match nothing.
+    if (i == exprs.size()) { return true; }
+  }
+  return false;
+}
+
+void SortMergeJoinExecutor::Init() {
+  left_->Init();
+  right_->Init();
+  has_left_ = Advance(left_, cond_->left_keys_, &left_tuple_, &left_keys_);
+  has_right_ = Advance(right_, cond_->right_keys_, &right_tuple_, &right_keys_);
+  buffer_.clear();
+  buffer_pos_ = 0;
+}
+
+auto SortMergeJoinExecutor::Next(Tuple *tuple) -> bool {
+  const size_t num_keys = cond_->left_keys_.size();
+  while (true) {
+    if (buffer_pos_ < buffer_.size()) {
+      // join the left tuple with the next buffered right tuple.
+      const Tuple &right = buffer_[buffer_pos_++];
+      std::vector<DataBox> data;
+      data.reserve(left_tuple_.getSize() + right.getSize());
+      data.insert(data.end(), left_tuple_.getData().begin(), left_tuple_.getData().end());
+      data.insert(data.end(), right.getData().begin(), right.getData().end());
+      *tuple = Tuple(&schema_, std::move(data));
+      if (!static_cast<bool>(cond_->residual_) || cond_->residual_->Evaluate(tuple, var_mgn_, 0).getBoolValue()) {
+        return true;
+      }
+      continue;
+    }
+
+    if (!buffer_.empty()) {
+      // the left tuple is joined with the whole buffer, the next one may match the buffer too.
+      has_left_ = Advance(left_, cond_->left_keys_, &left_tuple_, &left_keys_);
+      if (has_left_ && compareJoinKeys(left_keys_.data(), buffer_keys_.data(), num_keys) == 0) {
+        buffer_pos_ = 0;
+        continue;
+      }
+      buffer_.clear();
+      buffer_pos_ = 0;
+    }
+
+    if (!has_left_ || !has_right_) { return false; }
+    int cmp = compareJoinKeys(left_keys_.data(), right_keys_.data(), num_keys);
+    if (cmp < 0) {
+      has_left_ = Advance(left_, cond_->left_keys_, &left_tuple_, &left_keys_);
+    } else if (cmp > 0) {
+      has_right_ = Advance(right_, cond_->right_keys_, &right_tuple_, &right_keys_);
+    } else {
+      // buffer all right tuples of the key.
+      buffer_keys_ = right_keys_;
+      while (has_right_ && compareJoinKeys(right_keys_.data(), buffer_keys_.data(), num_keys) == 0) {
+        buffer_.push_back(std::move(right_tuple_));
+        has_right_ = Advance(right_, cond_->right_keys_, &right_tuple_, &right_keys_);
+      }
+    }
+  }
+}
+
+/************************************************
+ *         IndexNestedLoopJoinExecutor
+ ************************************************/
+IndexNestedLoopJoinExecutor::IndexNestedLoopJoinExecutor(AbstractExecutorRef outer, const std::string &inner, 
+                                                         std::unordered_map<std::string, TableInfo> *tb_mgn, 
+                                                         const AbstractExprRef &on, VariableManager *var_mgn, 
+                                                         bool inner_left)
+  : outer_(outer), inner_name_(inner), inner_left_(inner_left), var_mgn_(var_mgn) {
+  this->exec_type_ = ExecutorType::IndexJoin;
+  auto iter = tb_mgn->find(inner);
+  cqlAssert(iter != tb_mgn->end(), "cannot find table in checklist");
+  inner_ptr_ = iter->second.table_ptr_;
+  for (const auto &col : inner_ptr_->getSchema()->getColumns()) {
+    inner_schema_.AppendCol(col.first, inner + "." + col.second);
+  }
+
+  const Schema *left = inner_left_ ? &inner_schema_ : outer_->GetOutputSchema();
+  const Schema *right = inner_left_ ? outer_->GetOutputSchema() : &inner_schema_;
+  schema_ = makeJoinSchema(left, right);
+  cond_ = JoinCondition::Make(on, left, right);
+  cqlAssert(!cond_.left_keys_.empty(), "index join needs an equality between columns of the two tables");
+
+  // the first key of the inner side must be a column.
+  const AbstractExprRef &key = inner_left_ ? cond_.left_keys_[0] : cond_.right_keys_[0];
+  auto col_ptr = dynamic_cast<const ColumnExpr *>(key.get());
+  cqlAssert(static_cast<bool>(col_ptr), "index join key of the inner table is not a column");
+  inner_col_ = inner_schema_.getColumnIdx(col_ptr->column_name_);
+  cqlAssert(inner_col_ != static_cast<size_t>(-1), "index join key of the inner table is not a column");
+  // a binary search, if the table is sorted on the column.
+  if (!inner_ptr_->isClusteredOn({inner_col_})) { index_ = LookupIndex(inner_ptr_, inner_col_); }
+}
+
+auto IndexNestedLoopJoinExecutor::LookupIndex(const Table *table, size_t col) -> const TableIndex * {
+  for (IndexType type : {IndexType::Hash, IndexType::BTree}) {
+    const TableIndex *index = table->findIndex(col, type);
+    if (static_cast<bool>(index) && !index->hasMismatched()) { return index; }
+  }
+  return nullptr;
+}
+
+void IndexNestedLoopJoinExecutor::Init() {
+  outer_->Init();
+  if (!static_cast<bool>(index_)) {
+    cqlAssert(inner_ptr_->isClusteredOn({inner_col_}), "inner table of index join is neither sorted nor indexed");
+    descending_ = !inner_ptr_->isSortedOn({inner_col_});
+  }
+  pos_ = end_ = 0;
+}
+
+void IndexNestedLoopJoinExecutor::Lookup(const DataBox &key) {
+  if (static_cast<bool>(index_)) {
+    // keys of other types than the column never match; rows in the order of the table.
+    matches_.clear();
+    if (key.getType() == index_->getKeyType()) { index_->Find(key, &matches_); }
+    std::sort(matches_.begin(), matches_.end());
+    pos_ = 0;
+    end_ = matches_.size();
+    return;
+  }
+  const std::vector<Tuple> &rows = inner_ptr_->getTuples();
+  // sign of comparing a row with the key, in the order of the table.
+  auto order = [&](size_t row) -> int {
+    DataBox val = rows[row].getColumnData(inner_col_);
+    int cmp = compareJoinKeys(&val, &key, 1);
+    return descending_ ? -cmp : cmp;
+  };
+
+  // first row not before the key.
+  size_t lo = 0, hi = rows.size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (order(mid) < 0) { lo = mid + 1; } else { hi = mid; }
+  }
+  pos_ = lo;
+  // first row after the key.
+  hi = rows.size();
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (order(mid) <= 0) { lo = mid + 1; } else { hi = mid; }
+  }
+  end_ = lo;
+}
+
+auto IndexNestedLoopJoinExecutor::Next(Tuple *tuple) -> bool {
+  const std::vector<Tuple> &rows = inner_ptr_->getTuples();
+  const AbstractExprRef &outer_key = inner_left_ ? cond_.right_keys_[0] : cond_.left_keys_[0];
+  while (true) {
+    while (pos_ < end_) {
+      const Tuple &row = rows[static_cast<bool>(index_) ? matches_[pos_++] : pos_++];
+      if (row.isDeleted()) { continue; }
+      const Tuple inner(&inner_schema_, row.getData());
+      const Tuple &left = inner_left_ ? inner : *outer_tuple_;
+      const Tuple &right = inner_left_ ? *outer_tuple_ : inner;
+
+      // the other keys are not looked up, check them.
+      size_t i = 1;
+      for (; i < cond_.left_keys_.size(); ++i) {
+        if (!DataBox::Identical(cond_.left_keys_[i]->Evaluate(&left, var_mgn_, 0), 
+                                cond_.right_keys_[i]->Evaluate(&right, var_mgn_, 0))) { break; }
+      }
+      if (i != cond_.left_keys_.size()) { continue; }
+
+      std::vector<DataBox> data;
+      data.reserve(left.getSize() + right.getSize());
+      data.insert(data.end(), left.getData().begin(), left.getData().end());
+      data.insert(data.end(), right.getData().begin(), right.getData().end());
+      *tuple = Tuple(&schema_, std::move(data));
+      if (!static_cast<bool>(cond_.residual_) || cond_.residual_->Evaluate(tuple, var_mgn_, 0).getBoolValue()) {
+        return true;
+      }
+    }
+
+    if (!outer_->NextRef(&outer_tuple_)) { return false; }
+    DataBox key = outer_key->Evaluate(outer_tuple_, var_mgn_, 0);
+    if (key.getType() == TypeId::INVALID) { continue; }
+    Lookup(key);
+  }
+}
+
+/************************************************
+ *               SemiJoinExecutor
+ ************************************************/
+void SemiJoinExecutor::Init() {
+  child_->Init();
+  subquery_->Init();
+  values_.Clear();
+  const Tuple *tuple;
+  while (subquery_->NextRef(&tuple)) {
+    values_.Insert(tuple->getColumnData(0));
+  }
+}
+
+auto SemiJoinExecutor::NextRef(const Tuple **tuple) -> bool {
+  while (child_->NextRef(tuple)) {
+    if (values_.Contains(key_->Evaluate(*tuple, var_mgn_, 0)) != anti_) { return true; }
+  }
+  return false;
+}
+
+/************************************************
+ *                GatherExecutor
+ ************************************************/
+GatherExecutor::GatherExecutor(const std::string &name, std::unordered_map<std::string, TableInfo> *tb_mgn,
+                               size_t num_threads, bool ordered, const PipelineMaker &make_pipeline)
+  : table_name_(name), num_threads_(std::max(num_threads, static_cast<size_t>(1))), ordered_(ordered) {
+  this->exec_type_ = ExecutorType::Gather;
+  auto iter = tb_mgn->find(name);
+  cqlAssert(iter != tb_mgn->end(), "cannot find table in checklist");
+  table_ptr_ = iter->second.table_ptr_;
+  for (size_t id = 0; id < num_threads_; ++id) {
+    scans_.push_back(std::make_shared<SeqScanExecutor>(SeqScanExecutor(name, tb_mgn)));
+    pipelines_.push_back(make_pipeline(scans_.back()));
+  }
+}
+
+void GatherExecutor::Stop() {
+  if (static_cast<bool>(state_)) {
+    std::lock_guard<std::mutex> lock(state_->mutex_);
+    state_->stop_ = true;
+    state_->space_.notify_all();
+  }
+  for (auto &worker : workers_) { worker.join(); }
+  workers_.clear();
+}
+
+void GatherExecutor::Work(size_t id, std::shared_ptr<State> state) {
+  const size_t window = num_threads_ * GATHER_MORSELS_PER_THREAD;
+  try {
+    while (true) {
+      size_t morsel;
+      {
+        std::unique_lock<std::mutex> lock(state->mutex_);
+        // don't run too far ahead of the consumer.
+        state->space_.wait(lock, [&] {
+          return state->stop_ || state->next_morsel_ >= state->num_morsels_ 
+              || state->next_morsel_ < state->emitted_ + window;
+        });
+        if (state->stop_ || state->next_morsel_ >= state->num_morsels_) { return; }
+        morsel = state->next_morsel_++;
+      }
+
+      scans_[id]->SetRange(morsel * MORSEL_ROWS, (morsel + 1) * MORSEL_ROWS);
+      pipelines_[id]->Init();
+      std::vector<Tuple> output;
+      size_t bytes = 0;
+      const Tuple *tuple;
+      while (pipelines_[id]->NextRef(&tuple)) {
+        output.push_back(*tuple);
+        bytes += tuple->getMemorySize();
+      }
+
+      std::lock_guard<std::mutex> lock(state->mutex_);
+      state->queued_bytes_ += bytes;
+      state->peak_bytes_ = std::max(state->peak_bytes_, state->queued_bytes_);
+      state->done_[morsel] = std::move(output);
+      state->ready_.notify_all();
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(state->mutex_);
+    state->error_ = std::current_exception();
+    state->stop_ = true;
+    state->ready_.notify_all();
+    state->space_.notify_all();
+  }
+}
+
+void GatherExecutor::Init() {
+  Stop();
+  state_ = std::make_shared<State>();
+  state_->num_morsels_ = (table_ptr_->getTuples().size() + MORSEL_ROWS - 1) / MORSEL_ROWS;
+  batch_.clear();
+  batch_pos_ = 0;
+  for (size_t id = 0; id < num_threads_; ++id) {
+    workers_.push_back(std::thread(&GatherExecutor::Work, this, id, state_));
+  }
+}
+
+auto GatherExecutor::NextRef(const Tuple **tuple) -> bool {
+  while (batch_pos_ >= batch_.size()) {
+    std::unique_lock<std::mutex> lock(state_->mutex_);
+    if (state_->emitted_ == state_->num_morsels_) { return false; }
+    state_->ready_.wait(lock, [&] {
+      return static_cast<bool>(state_->error_) 
+          || (ordered_ ? state_->done_.count(state_->emitted_) != 0 : !state_->done_.empty());
+    });
+    if (static_cast<bool>(state_->error_)) { std::rethrow_exception(state_->error_); }
+    auto iter = ordered_ ? state_->done_.find(state_->emitted_) : state_->done_.begin();
+    for (const auto &queued : iter->second) { state_->queued_bytes_ -= queued.getMemorySize(); }
+    batch_ = std::move(iter->second);
+    batch_pos_ = 0;
+    state_->done_.erase(iter);
+    ++state_->emitted_;
+    state_->space_.notify_all();
+  }
+  *tuple = &batch_[batch_pos_++];
+  return true;
+}
+
+auto GatherExecutor::GetPeakMemory() const -> size_t {
+  if (!static_cast<bool>(state_)) { return 0; }
+  std::lock_guard<std::mutex> lock(state_->mutex_);
+  return state_->peak_bytes_;
+}
+
+auto GatherExecutor::GetChildren() -> std::vector<AbstractExecutorRef *> {
+  std::vector<AbstractExecutorRef *> children;
+  for (auto &pipeline : pipelines_) { children.push_back(&pipeline); }
+  return children;
+}
+
+/************************************************
+ *                   Explain
+ ************************************************/
+auto executorName(ExecutorType type) -> std::string {
+  switch (type) {
+    case ExecutorType::Dest: return "Dest";
+    case ExecutorType::Filter: return "Filter";
+    case ExecutorType::Limit: return "Limit";
+    case ExecutorType::Projection: return "Projection";
+    case ExecutorType::Seqscan: return "SeqScan";
+    case ExecutorType::IndexScan: return "IndexScan";
+    case ExecutorType::Sort: return "Sort";
+    case ExecutorType::TopN: return "TopN";
+    case ExecutorType::AggExec: return "HashAgg";
+    case ExecutorType::StreamAgg: return "StreamAgg";
+    case ExecutorType::TopKExec: return "TopK";
+    case ExecutorType::HashJoin: return "HashJoin";
+    case ExecutorType::MergeJoin: return "MergeJoin";
+    case ExecutorType::IndexJoin: return "IndexJoin";
+    case ExecutorType::SemiJoin: return "SemiJoin";
+    case ExecutorType::Gather: return "Gather";
+    case ExecutorType::Invalid_exec: return "Invalid";
+  }
+  throw std::domain_error("unknown executor type?? Impossible!");
+}
+
+/** @return the expressions, separated by commas. */
+static auto exprsToString(const std::vector<AbstractExprRef> &exprs) -> std::string {
+  std::string res;
+  for (size_t i = 0; i < exprs.size(); ++i) {
+    if (i != 0) { res += ", "; }
+    res += exprs[i]->toString();
+  }
+  return res;
+}
+
+/** @return the equal keys and the residual predicate of a join. */
+static auto joinToString(const JoinCondition &cond) -> std::string {
+  std::string res;
+  for (size_t i = 0; i < cond.left_keys_.size(); ++i) {
+    if (i != 0) { res += " and "; }
+    res += cond.left_keys_[i]->toString() + " = " + cond.right_keys_[i]->toString();
+  }
+  if (static_cast<bool>(cond.residual_)) { res += ", filter " + cond.residual_->toString(); }
+  return res;
+}
+
+auto TupleComparator::toString() const -> std::string {
+  std::string res;
+  for (size_t i = 0; i < order_by_.size(); ++i) {
+    if (i != 0) { res += ", "; }
+    res += order_by_[i]->toString();
+    if (order_by_type_[i] == OrderByType::DESC) { res += " desc"; }
+  }
+  return res;
+}
+
+auto SeqScanExecutor::Describe() const -> std::string {
+  std::string res = "SeqScan " + table_name_;
+  if (static_cast<bool>(predicate_)) { res += ", filter " + predicate_->toString(); }
+  for (size_t i = 0; i < ranges_.size(); ++i) {
+    res += (i == 0 ? ", zone maps " : " and ") + rangeToString(ranges_[i], table_ptr_->getSchema());
+  }
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    res += (i == 0 ? ", columns " : ", ") + pruned_schema_.getColumn(i).second;
+  }
+  return res;
+}
+
+auto IndexScanExecutor::Describe() const -> std::string {
+  if (!ordered_) { return "IndexScan " + table_name_ + (how_.empty() ? "" : ", " + how_); }
+  const std::string range = rangeToString(range_, table_ptr_->getSchema());
+  return "IndexScan " + table_name_ + ", " + index_->getName() + ": " + range + (descending_ ? " desc" : "");
+}
+
+auto ProjectionExecutor::Describe() const -> std::string { return "Projection " + exprsToString(columns_); }
+
+auto DestExecutor::Describe() const -> std::string {
+  std::string res = "Dest";
+  for (size_t i = 0; i < destinations_.size(); ++i) { res += (i == 0 ? " " : ", ") + destinations_[i]; }
+  return res;
+}
+
+auto FilterExecutor::Describe() const -> std::string { return "Filter " + predicate_->toString(); }
+
+auto LimitExecutor::Describe() const -> std::string {
+  std::string res = "Limit";
+  if (limit_ != static_cast<size_t>(-1)) { res += " " + std::to_string(limit_); }
+  if (offset_ != 0) { res += " offset " + std::to_string(offset_); }
+  return res;
+}
+
+auto SortExecutor::Describe() const -> std::string { return "Sort by " + comparator_.toString(); }
+
+auto TopNExecutor::Describe() const -> std::string {
+  return "TopN " + std::to_string(n_) + " by " + comparator_.toString();
+}
+
+auto AggExecutor::Describe() const -> std::string {
+  std::string res = "HashAgg";
+  if (!group_by_.empty()) { res += " group by " + exprsToString(group_by_); }
+  if (num_threads_ > 1) { res += ", " + std::to_string(num_threads_) + " threads"; }
+  if (static_cast<bool>(having_)) { res += ", having " + having_->toString(); }
+  return res;
+}
+
+auto StreamAggExecutor::Describe() const -> std::string {
+  return group_by_.empty() ? "StreamAgg" : "StreamAgg group by " + exprsToString(group_by_);
+}
+
+auto TopKExecutor::Describe() const -> std::string {
+  return "TopK " + std::to_string(k_) + " of " + input_->toString();
+}
+
+auto HashJoinExecutor::Describe() const -> std::string {
+  return std::string("HashJoin build ") + (build_left_ ? "left" : "right") + ", on " + joinToString(cond_);
+}
+
+auto SortMergeJoinExecutor::Describe() const -> std::string { return "MergeJoin on " + joinToString(*cond_); }
+
+auto IndexNestedLoopJoinExecutor::Describe() const -> std::string {
+  return "IndexJoin lookup " + inner_name_ + (inner_left_ ? "(left)" : "(right)") 
+       + (static_cast<bool>(index_) ? " using index " + index_->getName() : "") + ", on " + joinToString(cond_);
+}
+
+auto SemiJoinExecutor::Describe() const -> std::string {
+  return (anti_ ? "AntiJoin " + key_->toString() + " not in" : "SemiJoin " + key_->toString() + " in")
+       + " subquery";
+}
+
+auto SemiJoinExecutor::GetPeakMemory() const -> size_t {
+  size_t size = 0;
+  for (const auto &value : values_.getSet()) { size += value.getMemorySize(); }
+  return size;
+}
+
+auto GatherExecutor::Describe() const -> std::string {
+  return "Gather " + table_name_ + ", " + std::to_string(num_threads_) + " workers" + (ordered_ ? ", ordered" : "");
+}
+
+void ProfileExecutor::Init() {
+  const Clock::time_point start = Clock::now();
+  inner_->Init();
+  init_time_ += Clock::now() - start;
+  ++loops_;
+}
+
+auto ProfileExecutor::Next(Tuple *tuple) -> bool {
+  const Clock::time_point start = Clock::now();
+  const bool has_next = inner_->Next(tuple);
+  next_time_ += Clock::now() - start;
+  if (has_next) { ++rows_; }
+  return has_next;
+}
+
+auto ProfileExecutor::NextRef(const Tuple **tuple) -> bool {
+  const Clock::time_point start = Clock::now();
+  const bool has_next = inner_->NextRef(tuple);
+  next_time_ += Clock::now() - start;
+  if (has_next) { ++rows_; }
+  return has_next;
+}
+
+void profileExecutors(AbstractExecutorRef *slot) {
+  for (AbstractExecutorRef *child : (*slot)->GetChildren()) { profileExecutors(child); }
+  *slot = std::make_shared<ProfileExecutor>(*slot);
+}
+
+/** @return bytes in B, KB or MB. */
+static auto bytesToString(size_t bytes) -> std::string {
+  std::ostringstream oss;
+  oss << std::fixed << std::setprecision(1);
+  if (bytes < 1024) {
+    oss << bytes << " B";
+  } else if (bytes < 1024 * 1024) {
+    oss << static_cast<double>(bytes) / 1024 << " KB";
+  } else {
+    oss << static_cast<double>(bytes) / (1024 * 1024) << " MB";
+  }
+  return oss.str();
+}
+
+/**
+ * @brief print copies of an executor(the same executor of the pipelines of a gather
+ * executor, or just one) and the executors below them.
+ */
+static void explainCopies(std::ostream &os, const std::vector<AbstractExecutor *> &copies, size_t depth) {
+  AbstractExecutor *first = copies[0];
+  os << std::string(depth * 2, ' ') << (depth == 0 ? "" : "-> ") << first->Describe();
+
+  // children of the copies: group i is the child i of every copy.
+  std::vector<std::vector<AbstractExecutor *>> groups;
+  for (AbstractExecutor *copy : copies) {
+    std::vector<AbstractExecutorRef *> children = copy->GetChildren();
+    // the pipelines of the workers of a gather executor are copies of each other.
+    const bool same = first->GetType() == ExecutorType::Gather;
+    for (size_t i = 0; i < children.size(); ++i) {
+      const size_t group = same ? 0 : i;
+      if (groups.size() <= group) { groups.resize(group + 1); }
+      groups[group].push_back(children[i]->get());
+    }
+  }
+
+  if (static_cast<bool>(dynamic_cast<ProfileExecutor *>(first))) {
+    size_t rows_in = 0, rows_out = 0, loops = 0, memory = 0;
+    double init_time = 0.0, next_time = 0.0;
+    for (AbstractExecutor *copy : copies) {
+      auto profile_ptr = dynamic_cast<ProfileExecutor *>(copy);
+      rows_out += profile_ptr->getRows();
+      loops += profile_ptr->getLoops();
+      init_time += profile_ptr->getInitTime();
+      next_time += profile_ptr->getNextTime();
+      memory += profile_ptr->GetPeakMemory();
+    }
+    for (const auto &group : groups) {
+      for (AbstractExecutor *child : group) { rows_in += dynamic_cast<ProfileExecutor *>(child)->getRows(); }
+    }
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3) << "  (";
+    // scans read tables, not executors.
+    if (!groups.empty()) { oss << "rows in " << rows_in << ", "; }
+    oss << "rows out " << rows_out << "; time " << init_time + next_time << " ms, init " << init_time
+        << " ms, next " << next_time << " ms";
+    if (loops > 1) { oss << "; " << loops << " loops"; }
+    if (copies.size() > 1) { oss << "; sum of " << copies.size() << " workers"; }
+    oss << "; memory " << bytesToString(memory) << ")";
+    os << oss.str();
+  }
+  os << std::endl;
+  for (const auto &group : groups) { explainCopies(os, group, depth + 1); }
+}
+
+void explainTo(std::ostream &os, const AbstractExecutorRef &root) {
+  cqlAssert(static_cast<bool>(root), "explaining a null executor");
+  explainCopies(os, {root.get()}, 0);
 }
 
 }  // namespace cql
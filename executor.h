@@ -13,13 +13,24 @@
  **********************************************************/
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "aggregation.h"
 #include "expr_util.h"
+#include "join.h"
 #include "Parser.h"
+#include "spill_file.h"
 #include "table.h"
 #include "tuple.h"
 #include "variable_manager.h"
@@ -35,17 +46,44 @@ enum ExecutorType {
   Limit,       // limit & offset
   Projection,  // projection execution
   Seqscan,     // load a table.
+  IndexScan,   // rows of a table in a range of an index.
   Sort,        // sort the tuples of a table.
+  TopN,        // the first tuples in the order of order bys, without sorting all.
   AggExec,     // aggregate executor.
+  StreamAgg,   // aggregate executor over input ordered by group.
+  TopKExec,    // approximate most frequent values.
+  HashJoin,    // equi-join by hashing one input.
+  MergeJoin,   // equi-join of inputs sorted on the keys.
+  IndexJoin,   // equi-join by looking up a sorted table for each tuple.
+  SemiJoin,    // in/not in subquery, by hashing the subquery.
+  Gather,      // collect the output of parallel pipelines.
   Invalid_exec // a executor that does nothing(can be used as default value)
 };
 
+/**
+ * @return name of a type of executors.
+ */
+auto executorName(ExecutorType type) -> std::string;
+
 /** Base of all executors. */
 class AbstractExecutor {
  protected:
   ExecutorType exec_type_{Invalid_exec};        // execution type.
   /** DO NOT CREATE POINTER OF SCHEMA USING new */
   const Schema *output_schema_{nullptr};   // output schema of the executor.
+  /** tuple NextRef points to, if built by Next. */
+  Tuple buffer_;
+
+  /**
+   * @brief implement Next by copying the tuple of NextRef.
+   */
+  auto CopyNextRef(Tuple *tuple) -> bool {
+    const Tuple *ref;
+    if (!NextRef(&ref)) { return false; }
+    *tuple = *ref;
+    return true;
+  }
+
  public:
   AbstractExecutor() = default;
   virtual ~AbstractExecutor() {}
@@ -66,11 +104,39 @@ class AbstractExecutor {
    */
   virtual auto Next(Tuple *tuple) -> bool = 0;
 
+  /**
+   * Like Next, without copying the tuple if it is stored elsewhere(in
+   * the table, or in a buffer of the executor or its child).
+   * @param tuple[out] points to the next tuple, valid until next call of Next/NextRef/Init.
+   * @return true if has next; false otherwise.
+   */
+  virtual auto NextRef(const Tuple **tuple) -> bool {
+    if (!Next(&buffer_)) { return false; }
+    *tuple = &buffer_;
+    return true;
+  }
+
   /**
    * initialize the executor.
    */
   virtual void Init() = 0;
-  
+
+  /**
+   * @return the executors this one pulls tuples from, as the members holding
+   * them, so that they can be inspected or wrapped(eg. by explain analyze).
+   */
+  virtual auto GetChildren() -> std::vector<std::shared_ptr<AbstractExecutor> *> { return {}; }
+
+  /**
+   * @return a line of what the executor does: its name, then what the planner
+   * chose for it(predicates, keys, strategies).
+   */
+  virtual auto Describe() const -> std::string { return executorName(exec_type_); }
+
+  /**
+   * @return about the peak number of bytes of tuples and states buffered since Init.
+   */
+  virtual auto GetPeakMemory() const -> size_t { return 0; }
 };
 using AbstractExecutorRef = std::shared_ptr<AbstractExecutor>;
 
@@ -79,26 +145,139 @@ class SeqScanExecutor: public AbstractExecutor {
   std::string table_name_;            // name of the table to scan into.
  private:
   size_t emitted_{0U};                // record number of tuples emitted.
+  /** rows [begin_, end_) of the table are scanned. */
+  size_t begin_{0U};
+  size_t end_{static_cast<size_t>(-1)};
   /** Table manager passed by planner. */
   std::unordered_map<std::string, TableInfo> *table_mgn_;
   Table *table_ptr_;
+  /** if qualified, columns are named 'table.col'(to tell joined tables apart). */
+  bool qualified_{false};
+  Schema qualified_schema_;
+  /** predicate pushed down from the where clause, evaluated on rows in the table(may be nullptr). */
+  AbstractExprRef predicate_{nullptr};
+  VariableManager *var_mgn_{nullptr};
+  /** ranges of columns the predicate accepts, blocks of rows out of them are skipped by zone maps. */
+  std::vector<ColumnRange> ranges_;
+  /** block of the zone map emitted_ was checked in. */
+  size_t block_{static_cast<size_t>(-1)};
+  /** columns of the table to materialize, all if empty. */
+  std::vector<size_t> columns_;
+  Schema pruned_schema_;
  public:
-  SeqScanExecutor(const std::string &name, std::unordered_map<std::string, TableInfo> *tb_mgn): 
-    table_name_(name), table_mgn_(tb_mgn) {
+  SeqScanExecutor(const std::string &name, std::unordered_map<std::string, TableInfo> *tb_mgn, 
+                  bool qualified = false): 
+    table_name_(name), table_mgn_(tb_mgn), qualified_(qualified) {
     this->exec_type_ = ExecutorType::Seqscan;
     auto iter = table_mgn_->find(name);
     cqlAssert(iter != table_mgn_->end(), "cannot find table in checklist");
     table_ptr_ = (iter->second).table_ptr_;
     this->output_schema_ = table_ptr_->getSchema();
+    if (qualified_) {
+      for (const auto &col : output_schema_->getColumns()) {
+        qualified_schema_.AppendCol(col.first, name + "." + col.second);
+      }
+    }
+  }
+
+  auto GetOutputSchema() const -> const Schema * override { 
+    if (!columns_.empty()) { return &pruned_schema_; }
+    return qualified_ ? &qualified_schema_ : output_schema_; 
+  }
+
+  /**
+   * @brief only emit rows satisfying the predicate(and-ed with predicates pushed before).
+   * The predicate is evaluated on the row in the table, so it must use unqualified columns.
+   */
+  void PushPredicate(const AbstractExprRef &predicate, VariableManager *var_mgn);
+
+  /**
+   * @brief only materialize some columns of the table, in the order of the table.
+   * @param cols: indices of columns in the table, sorted and not empty.
+   */
+  void PushColumns(const std::vector<size_t> &cols);
+
+  /**
+   * @brief scan rows [begin, end) only(a morsel), starting from next Init.
+   */
+  void SetRange(size_t begin, size_t end) {
+    begin_ = begin;
+    end_ = end;
   }
 
   /** Initialize the executor. */
-  void Init() override { emitted_ = 0; }
+  void Init() override { 
+    emitted_ = begin_;
+    block_ = static_cast<size_t>(-1);
+  }
 
-  auto Next(Tuple *tuple) -> bool override;
+  auto Next(Tuple *tuple) -> bool override { return CopyNextRef(tuple); }
+
+  /** 
+   * points into the table, unless columns are qualified or pruned. Deleted rows,
+   * and blocks the zone map rules out, are skipped.
+   */
+  auto NextRef(const Tuple **tuple) -> bool override;
+
+  auto Describe() const -> std::string override;
+};
+
+/** finds the rows an index scan reads(ascending), when it is initialized. */
+typedef std::function<void(std::vector<size_t> *)> RowFinder;
+
+/**
+ * Index scan reads the rows of a table an index finds: the rows whose
+ * keys are in a range of a B+tree index in the order of keys(which
+ * satisfies an order by on the column), or rows found by a lookup in
+ * the order of the table.
+ */
+class IndexScanExecutor: public AbstractExecutor {
+ private:
+  std::string table_name_;
+  Table *table_ptr_;
+  /** emit rows in the order of keys, else in the order of the table. */
+  bool ordered_;
+  /** ordered: the index and range to read. */
+  const BTreeIndex *index_{nullptr};
+  ColumnRange range_;
+  bool descending_{false};
+  /** the next entry to emit, if valid_. */
+  BPlusTree::Iterator iter_;
+  bool valid_{false};
+  /** unordered: rows found, ascending. */
+  RowFinder finder_;
+  std::vector<size_t> rows_;
+  size_t pos_{0U};
+  /** unordered: how the rows are found, for explain. */
+  std::string how_;
+
+ public:
+  /**
+   * @brief read a range of a B+tree index of the table in the order of keys.
+   * @param descending: emit in descending order of keys.
+   */
+  IndexScanExecutor(const std::string &name, std::unordered_map<std::string, TableInfo> *tb_mgn, 
+                    const BTreeIndex *index, const ColumnRange &range, bool descending);
+
+  /**
+   * @brief read the rows found by finder, in the order of the table.
+   * @param how: how finder finds the rows, for explain.
+   */
+  IndexScanExecutor(const std::string &name, std::unordered_map<std::string, TableInfo> *tb_mgn,
+                    const RowFinder &finder, const std::string &how = "");
+
+  void Init() override;
+
+  auto Next(Tuple *tuple) -> bool override { return CopyNextRef(tuple); }
+
+  /** points into the table. */
+  auto NextRef(const Tuple **tuple) -> bool override;
+
+  auto Describe() const -> std::string override;
+
+  auto GetPeakMemory() const -> size_t override { return rows_.capacity() * sizeof(size_t); }
 };
 
-/** NOTE: how to implement its output schema method?? */
 class ProjectionExecutor: public AbstractExecutor {
  private:
   VariableManager *var_mgn_;   // variable manager(maybe unused; depends on queries you want to run)
@@ -108,15 +287,18 @@ class ProjectionExecutor: public AbstractExecutor {
   AbstractExecutorRef child_{nullptr};
   /** Record number of tuples emitted. */
   size_t count_{0U};
+  /** a copy of the schema given, so that it outlives the planner. */
+  Schema schema_;
 
  public:
   ProjectionExecutor(const Schema *schema, VariableManager *var_mgn, 
                      const std::vector<AbstractExprRef> &columns, AbstractExecutorRef child):
-                       var_mgn_(var_mgn), columns_(columns), child_(child) {
+                       var_mgn_(var_mgn), columns_(columns), child_(child), schema_(*schema) {
     this->exec_type_ = ExecutorType::Projection;
-    this->output_schema_ = schema;
   }
 
+  auto GetOutputSchema() const -> const Schema * override { return &schema_; }
+
   void Init() override {
     count_ = 0;
     if (static_cast<bool>(child_)) {
@@ -125,6 +307,13 @@ class ProjectionExecutor: public AbstractExecutor {
   }
 
   auto Next(Tuple *tuple) -> bool override;
+
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override {
+    if (!static_cast<bool>(child_)) { return {}; }
+    return {&child_};
+  }
+
+  auto Describe() const -> std::string override;
 };
 
 class DestExecutor: public AbstractExecutor {
@@ -164,7 +353,13 @@ class DestExecutor: public AbstractExecutor {
     // end code
   }
 
-  auto Next(Tuple *tuple) -> bool override;
+  auto Next(Tuple *tuple) -> bool override { return CopyNextRef(tuple); }
+
+  auto NextRef(const Tuple **tuple) -> bool override;
+
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override { return {&child_}; }
+
+  auto Describe() const -> std::string override;
 };
 
 class FilterExecutor: public AbstractExecutor {
@@ -190,7 +385,14 @@ class FilterExecutor: public AbstractExecutor {
 
   void Init() override { child_->Init(); }
 
-  auto Next(Tuple *tuple) -> bool override;
+  auto Next(Tuple *tuple) -> bool override { return CopyNextRef(tuple); }
+
+  /** points to the tuple of the child. */
+  auto NextRef(const Tuple **tuple) -> bool override;
+
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override { return {&child_}; }
+
+  auto Describe() const -> std::string override;
 };
 
 class LimitExecutor: public AbstractExecutor {
@@ -219,7 +421,13 @@ class LimitExecutor: public AbstractExecutor {
     child_->Init();
   }
 
-  auto Next(Tuple *tuple) -> bool override;
+  auto Next(Tuple *tuple) -> bool override { return CopyNextRef(tuple); }
+
+  auto NextRef(const Tuple **tuple) -> bool override;
+
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override { return {&child_}; }
+
+  auto Describe() const -> std::string override;
 };
 
 struct TupleComparator {
@@ -231,6 +439,9 @@ struct TupleComparator {
   
   /** Comparator for tuples */
   auto compare(const Tuple &t1, const Tuple &t2) const -> bool;
+
+  /** @return the order bys, like `#a desc, #b`. */
+  auto toString() const -> std::string;
 };
 
 struct SortHelper {
@@ -249,10 +460,32 @@ struct SortHelper {
   }
 };
 
+/** Default number of bytes a sort executor can buffer before spilling to disk. */
+const size_t DEFAULT_SORT_MEMORY_BUDGET = static_cast<size_t>(256) << 20;
+
+/**
+ * Sort executor buffers tuples in memory until its memory budget
+ * is exhausted; then the buffered tuples are sorted and spilled to
+ * disk as a run. When all tuples are consumed, the runs(together
+ * with the tuples still in memory) are combined with a k-way merge.
+ */
 class SortExecutor: public AbstractExecutor {
   // const std::vector<AbstractExprRef> &order_by_;
   // const std::vector<OrderByType> &order_by_type_;
  private:
+  /** head of a sorted run during k-way merge. */
+  struct MergeEntry {
+    Tuple tuple_;
+    size_t run_;
+  };
+  /** min-heap order of merge entries. */
+  struct MergeEntryComparator {
+    const TupleComparator *cmp_;
+    auto operator()(const MergeEntry &e1, const MergeEntry &e2) const -> bool {
+      return cmp_->compare(e2.tuple_, e1.tuple_);
+    }
+  };
+
   TupleComparator comparator_;
   /** store the tuples in order */
   std::vector<SortHelper> helpers_;
@@ -260,10 +493,26 @@ class SortExecutor: public AbstractExecutor {
   size_t count_{0U};
   /** Get tuples from its child */
   AbstractExecutorRef child_{nullptr};
+  /** number of bytes the buffered tuples may take. */
+  size_t memory_budget_{DEFAULT_SORT_MEMORY_BUDGET};
+  /** sorted runs spilled to disk. */
+  std::vector<std::shared_ptr<SpillFile>> runs_;
+  /** heads of all runs; the in-memory run has index runs_.size(). */
+  std::vector<MergeEntry> heap_;
+  /** schema of the tuples read back from runs. */
+  const Schema *tuple_schema_{nullptr};
+  /** most bytes buffered at a time since Init. */
+  size_t peak_memory_{0U};
+
+  /** sort the buffered tuples and write them to a new run. */
+  void SpillRun();
+  /** read the next tuple of a run and push it into the heap. */
+  void PushRun(size_t run);
 
  public:
   SortExecutor(const std::vector<AbstractExprRef> &order_by, const std::vector<OrderByType> &order_by_type, 
-              AbstractExecutorRef child): comparator_(order_by, order_by_type), child_(child) {
+              AbstractExecutorRef child, size_t memory_budget = DEFAULT_SORT_MEMORY_BUDGET): 
+              comparator_(order_by, order_by_type), child_(child), memory_budget_(memory_budget) {
     cqlAssert(static_cast<bool>(child_), "child of sort executor is null");
     exec_type_ = ExecutorType::Sort;
   }
@@ -271,21 +520,101 @@ class SortExecutor: public AbstractExecutor {
   /** return the schema as-is */
   auto GetOutputSchema() const -> const Schema * override { return child_->GetOutputSchema(); }
 
-  /** do the sorting and put the tuples in the vector */
+  /** do the sorting and put the tuples in the vector(or runs on disk) */
   void Init() override;
 
   /** emit the tuple one by one */
-  auto Next(Tuple *tuple) -> bool override;
+  auto Next(Tuple *tuple) -> bool override { return CopyNextRef(tuple); }
+
+  /** points to the tuple in memory, or to the tuple read back from a run. */
+  auto NextRef(const Tuple **tuple) -> bool override;
+
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override { return {&child_}; }
+
+  auto Describe() const -> std::string override;
+
+  auto GetPeakMemory() const -> size_t override { return peak_memory_; }
+
+  /** @return number of runs spilled to disk since Init. */
+  auto getNumRuns() const -> size_t { return runs_.size(); }
+};
+
+/**
+ * Top-N executor keeps the first n tuples(in the order of order bys)
+ * of its child in a heap, replacing the last of them when a tuple
+ * comes before it. Memory is O(n) tuples, time O(rows * log(n)).
+ * Tuples that compare equal keep the order of the child.
+ */
+class TopNExecutor: public AbstractExecutor {
+ private:
+  struct Entry {
+    Tuple tuple_;
+    /** position in the output of the child. */
+    size_t seq_;
+  };
+  /** order of entries: the heap top is the last one kept. */
+  struct EntryComparator {
+    const TupleComparator *cmp_;
+    auto operator()(const Entry &e1, const Entry &e2) const -> bool {
+      if (cmp_->compare(e1.tuple_, e2.tuple_)) { return true; }
+      return !cmp_->compare(e2.tuple_, e1.tuple_) && e1.seq_ < e2.seq_;
+    }
+  };
+
+  TupleComparator comparator_;
+  /** number of tuples to keep. */
+  size_t n_;
+  AbstractExecutorRef child_;
+  /** a heap while consuming the child, sorted after. */
+  std::vector<Entry> entries_;
+  /** number of tuples emitted */
+  size_t count_{0U};
+  /** bytes of the tuples kept, when the child is consumed. */
+  size_t peak_memory_{0U};
+
+ public:
+  TopNExecutor(const std::vector<AbstractExprRef> &order_by, const std::vector<OrderByType> &order_by_type,
+               size_t n, AbstractExecutorRef child): comparator_(order_by, order_by_type), n_(n), child_(child) {
+    cqlAssert(static_cast<bool>(child_), "child of top-n executor is null");
+    exec_type_ = ExecutorType::TopN;
+  }
+
+  /** return the schema as-is */
+  auto GetOutputSchema() const -> const Schema * override { return child_->GetOutputSchema(); }
+
+  /** keep the first n tuples of the child, and sort them. */
+  void Init() override;
+
+  auto Next(Tuple *tuple) -> bool override { return CopyNextRef(tuple); }
+
+  /** points to the tuple kept. */
+  auto NextRef(const Tuple **tuple) -> bool override;
+
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override { return {&child_}; }
+
+  auto Describe() const -> std::string override;
+
+  auto GetPeakMemory() const -> size_t override { return peak_memory_; }
 };
 
+/** Number of bits of the key hash used to pick a partition in parallel aggregation. */
+const size_t AGG_RADIX_BITS = 5;
+/** Number of tuples handed to an aggregation worker at a time. */
+const size_t AGG_BATCH_SIZE = 1024;
+
 /**
  * Aggregate executor should calculate the value of 
- * all aggregation expressions, create table of tuples,
- * and send up tables when required. 
+ * all aggregation expressions in Init(it is a pipeline
+ * breaker), and then emit the groups one by one.
  * Then other work can be done by other executors.
  *
  * ie. aggregate executor is (almost certainly) 
  * independent of other executors.
+ *
+ * With more than one thread, the child is still consumed on the
+ * calling thread, but batches of tuples are handed to workers that
+ * pre-aggregate into thread-local tables, radix-partitioned by key
+ * hash. Partition i of all workers is then merged by one thread.
  */
 class AggExecutor: public AbstractExecutor {
  private:
@@ -299,33 +628,494 @@ class AggExecutor: public AbstractExecutor {
   const std::vector<AbstractExprRef> &order_by_;
   /** manually create schema of the executor. */
   Schema schema_;
-  /* manually create table of the executor. */
-  Table table_;  // not initialized in Init method.
   /** yield tuples from child executor(probably seqscan or filter)*/
   AbstractExecutorRef child_;
-  /** Number of tuples emitted. */
-  size_t count_{0U};
   /** variable manager?! */
   VariableManager *var_mgn_;
+  /** compiled aggregation expressions. */
+  std::vector<AggregateFunction> funcs_;
+  /** number of threads used to aggregate. */
+  size_t num_threads_{1U};
+  /** groups built by Init(one table, or one per radix partition). */
+  std::vector<AggregationHashTable> tables_;
+  /** position of the next group to emit. */
+  size_t table_idx_{0U};
+  size_t group_idx_{0U};
+  /** bytes of the groups built by Init. */
+  size_t peak_memory_{0U};
+
+  /** fold a tuple into its group of the table. */
+  void Accumulate(AggregationHashTable *table, const std::vector<DataBox> &keys, uint64_t hash, 
+                  const Tuple &tuple) const;
+  /** consume the child on the calling thread. */
+  auto BuildSerial() -> std::vector<AggregationHashTable>;
+  /** consume the child with worker threads, then merge partitions in parallel. */
+  auto BuildParallel() -> std::vector<AggregationHashTable>;
 
  public:
   AggExecutor(const std::vector<AbstractExprRef> &columns, const std::vector<AbstractExprRef> &group_by, 
               const std::vector<AbstractExprRef> &order_by, AbstractExprRef having, VariableManager *var_mgn,
-              AbstractExecutorRef child);
+              AbstractExecutorRef child, size_t num_threads = 1);
 
-  auto GetOutputSchema() const -> const Schema * override { return table_.getSchema(); }
+  auto GetOutputSchema() const -> const Schema * override { return &schema_; }
 
-  void Init() override { count_ = 0U; }
+  /** consume the child and build all groups(again if re-run). */
+  void Init() override;
 
-  auto Next(Tuple *tuple) -> bool override {
-    if (count_ >= table_.getNumRows()) {
-      return false;
-    }
-    auto tuples = table_.getTuples();
-    *tuple = Tuple(&schema_, tuples[count_++].getData());
-    // *tuple = tuples[count_++];
-    return true;
+  /** move the next group out of the tables. */
+  auto Next(Tuple *tuple) -> bool override;
+
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override { return {&child_}; }
+
+  auto Describe() const -> std::string override;
+
+  auto GetPeakMemory() const -> size_t override { return peak_memory_; }
+};
+
+/**
+ * Streaming aggregate executor requires tuples with the same
+ * group by keys to be adjacent(e.g. sorted on the keys). It emits
+ * a group as soon as the keys change, so only the current group
+ * is kept in memory and a limit above can stop it early.
+ *
+ * Without group bys, the whole input is one group, which is
+ * emitted even if the input is empty(eg. count is 0).
+ */
+class StreamAggExecutor: public AbstractExecutor {
+ private:
+  /** group bys. */
+  const std::vector<AbstractExprRef> &group_by_;
+  /** group by keys, then aggregates. */
+  Schema schema_;
+  /** compiled aggregation expressions. */
+  std::vector<AggregateFunction> funcs_;
+  /** yield tuples ordered by group. */
+  AbstractExecutorRef child_;
+  VariableManager *var_mgn_;
+  /** keys and states of the group being aggregated. */
+  std::vector<DataBox> keys_;
+  std::vector<AggregateState> states_;
+  /** the first tuple of the next group(read ahead) and its keys. */
+  const Tuple *next_tuple_{nullptr};
+  std::vector<DataBox> next_keys_;
+  bool has_next_{false};
+  /** whether a group is emitted since Init. */
+  bool emitted_{false};
+
+  /** read the next tuple of child into next_tuple_. */
+  void ReadAhead();
+
+ public:
+  StreamAggExecutor(const std::vector<AbstractExprRef> &columns, const std::vector<AbstractExprRef> &group_by, 
+                    const std::vector<AbstractExprRef> &order_by, AbstractExprRef having, VariableManager *var_mgn,
+                    AbstractExecutorRef child);
+
+  auto GetOutputSchema() const -> const Schema * override { return &schema_; }
+
+  void Init() override {
+    emitted_ = false;
+    child_->Init();
+    ReadAhead();
   }
+
+  auto Next(Tuple *tuple) -> bool override;
+
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override { return {&child_}; }
+
+  auto Describe() const -> std::string override;
 };
 
+/**
+ * Answer `select topk(<expr>, k) from ...` in one streaming pass with
+ * O(k) memory: yields the (approximately) k most frequent values of expr,
+ * most frequent first, as rows (value, #count, #error), where
+ * count - error <= true frequency <= count.
+ */
+class TopKExecutor: public AbstractExecutor {
+ private:
+  /** values to count. */
+  AbstractExprRef input_;
+  /** number of values to yield. */
+  size_t k_;
+  /** value, count, error. */
+  Schema schema_;
+  AbstractExecutorRef child_;
+  VariableManager *var_mgn_;
+  /** counters of the heavy hitters, most frequent first. */
+  std::vector<SpaceSaving::Counter> counters_;
+  size_t emitted_{0U};
+
+ public:
+  /**
+   * @param topk: a topk aggregate expression.
+   */
+  TopKExecutor(const AbstractExprRef &topk, VariableManager *var_mgn, AbstractExecutorRef child);
+
+  auto GetOutputSchema() const -> const Schema * override { return &schema_; }
+
+  void Init() override;
+
+  auto Next(Tuple *tuple) -> bool override;
+
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override { return {&child_}; }
+
+  auto Describe() const -> std::string override;
+};
+
+/**
+ * Inner equi-join: build a hash table on the keys of one input,
+ * then stream the other input and probe. Joined tuples are the columns
+ * of the left input followed by those of the right, in probe order.
+ */
+class HashJoinExecutor: public AbstractExecutor {
+ private:
+  AbstractExecutorRef left_;
+  AbstractExecutorRef right_;
+  VariableManager *var_mgn_;
+  /** build on the left input(probe with the right) if true. */
+  bool build_left_;
+  /** left columns, then right columns. */
+  Schema schema_;
+  /** equal keys and residual predicate. */
+  JoinCondition cond_;
+  JoinHashTable table_;
+  /** the tuple probing, its keys and hash. */
+  const Tuple *probe_{nullptr};
+  std::vector<DataBox> probe_keys_;
+  uint64_t probe_hash_{0U};
+  /** next row of the build side matching probe_. */
+  size_t match_;
+
+  /**
+   * @param keys[out] join keys of a tuple.
+   * @return false if any key is NULL(matches nothing).
+   */
+  auto EvaluateKeys(const Tuple &tuple, const std::vector<AbstractExprRef> &exprs, 
+                    std::vector<DataBox> *keys) const -> bool;
+
+ public:
+  /**
+   * @param on: join predicate, must contain an equality between the two inputs.
+   * @param build_left: build on the left input, usually the smaller one.
+   */
+  HashJoinExecutor(AbstractExecutorRef left, AbstractExecutorRef right, const AbstractExprRef &on,
+                   VariableManager *var_mgn, bool build_left = false);
+
+  auto GetOutputSchema() const -> const Schema * override { return &schema_; }
+
+  void Init() override;
+
+  auto Next(Tuple *tuple) -> bool override;
+
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override { return {&left_, &right_}; }
+
+  auto Describe() const -> std::string override;
+
+  auto GetPeakMemory() const -> size_t override { return table_.getMemorySize(); }
+};
+
+/**
+ * Inner equi-join of two inputs sorted(ascending) on their join keys.
+ * Inputs not sorted yet are sorted by SortExecutors, which spill to disk,
+ * so neither input has to fit in memory; only the tuples of the right
+ * input sharing one key are buffered.
+ */
+class SortMergeJoinExecutor: public AbstractExecutor {
+ private:
+  AbstractExecutorRef left_;
+  AbstractExecutorRef right_;
+  VariableManager *var_mgn_;
+  /** left columns, then right columns. */
+  Schema schema_;
+  /** keys and orders are referenced by the sort executors, keep them in place. */
+  std::shared_ptr<JoinCondition> cond_;
+  std::shared_ptr<std::vector<OrderByType>> order_;
+  /** current tuples of both inputs and their keys. */
+  Tuple left_tuple_;
+  std::vector<DataBox> left_keys_;
+  bool has_left_{false};
+  Tuple right_tuple_;
+  std::vector<DataBox> right_keys_;
+  bool has_right_{false};
+  /** right tuples with keys equal to buffer_keys_, joined with left tuples of the same keys. */
+  std::vector<Tuple> buffer_;
+  std::vector<DataBox> buffer_keys_;
+  size_t buffer_pos_{0U};
+
+  /**
+   * @brief read the next tuple with no NULL key.
+   * @return false if the input is exhausted.
+   */
+  auto Advance(const AbstractExecutorRef &child, const std::vector<AbstractExprRef> &exprs, 
+               Tuple *tuple, std::vector<DataBox> *keys) -> bool;
+
+ public:
+  /**
+   * @param left_sorted/right_sorted: the input is already sorted on its keys.
+   */
+  SortMergeJoinExecutor(AbstractExecutorRef left, AbstractExecutorRef right, const AbstractExprRef &on,
+                        VariableManager *var_mgn, bool left_sorted = false, bool right_sorted = false);
+
+  auto GetOutputSchema() const -> const Schema * override { return &schema_; }
+
+  void Init() override;
+
+  auto Next(Tuple *tuple) -> bool override;
+
+  /** inputs not sorted are sort executors above them. */
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override { return {&left_, &right_}; }
+
+  auto Describe() const -> std::string override;
+};
+
+/**
+ * Inner equi-join looking up the rows of a table(the inner side) for each
+ * tuple of the other input(the outer side). The table must be sorted on the
+ * column of the first join key, so that a lookup is a binary search, or have
+ * a hash or B+ tree index on it, probed instead.
+ * Joined tuples are the columns of the left, then the right, in outer order.
+ */
+class IndexNestedLoopJoinExecutor: public AbstractExecutor {
+ private:
+  AbstractExecutorRef outer_;
+  std::string inner_name_;
+  Table *inner_ptr_;
+  /** the inner table is the left side of the join. */
+  bool inner_left_;
+  /** columns of the inner table, qualified by its name. */
+  Schema inner_schema_;
+  /** left columns, then right columns. */
+  Schema schema_;
+  JoinCondition cond_;
+  /** column of the inner table looked up. */
+  size_t inner_col_;
+  /** the inner table is sorted descending. */
+  bool descending_{false};
+  /** index probed, if the inner table is not sorted on the column. */
+  const TableIndex *index_{nullptr};
+  VariableManager *var_mgn_;
+  /**
+   * the outer tuple and the range of inner rows [pos_, end_) matching its key;
+   * with an index, the range of matches_.
+   */
+  const Tuple *outer_tuple_{nullptr};
+  size_t pos_{0U};
+  size_t end_{0U};
+  /** rows of the inner table with the key, ascending. */
+  std::vector<size_t> matches_;
+
+  /** @brief find the rows of the inner table with the key. */
+  void Lookup(const DataBox &key);
+
+ public:
+  /**
+   * @param outer: the other input of the join.
+   * @param inner: name of the table looked up.
+   */
+  IndexNestedLoopJoinExecutor(AbstractExecutorRef outer, const std::string &inner, 
+                              std::unordered_map<std::string, TableInfo> *tb_mgn, const AbstractExprRef &on,
+                              VariableManager *var_mgn, bool inner_left = false);
+
+  auto GetOutputSchema() const -> const Schema * override { return &schema_; }
+
+  void Init() override;
+
+  auto Next(Tuple *tuple) -> bool override;
+
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override { return {&outer_}; }
+
+  auto Describe() const -> std::string override;
+
+  /**
+   * @return the index an index join probes to look up the column of the table(hash, else B+ tree);
+   * nullptr if there is none, or a row has a key of another type.
+   */
+  static auto LookupIndex(const Table *table, size_t col) -> const TableIndex *;
+};
+
+/**
+ * Semi-join for `<key> in (select ...)`: hash the first column of the
+ * subquery, then pass the tuples of the child whose key is in it.
+ * As an anti-join(`not in`), pass those whose key is not in it.
+ */
+class SemiJoinExecutor: public AbstractExecutor {
+ private:
+  /** expression over tuples of the child. */
+  AbstractExprRef key_;
+  AbstractExecutorRef child_;
+  AbstractExecutorRef subquery_;
+  VariableManager *var_mgn_;
+  /** pass tuples whose key is not in the subquery if true. */
+  bool anti_;
+  ValueSet values_;
+
+ public:
+  SemiJoinExecutor(const AbstractExprRef &key, AbstractExecutorRef child, AbstractExecutorRef subquery,
+                   VariableManager *var_mgn, bool anti = false):
+    key_(key), child_(child), subquery_(subquery), var_mgn_(var_mgn), anti_(anti) {
+    this->exec_type_ = ExecutorType::SemiJoin;
+    cqlAssert(static_cast<bool>(child_), "child of semi join executor is null");
+    cqlAssert(static_cast<bool>(subquery_), "subquery of semi join executor is null");
+  }
+
+  /** Semi join executor has the same output schema as its child */
+  auto GetOutputSchema() const -> const Schema * override { return child_->GetOutputSchema(); }
+
+  void Init() override;
+
+  auto Next(Tuple *tuple) -> bool override { return CopyNextRef(tuple); }
+
+  /** points to the tuple of the child. */
+  auto NextRef(const Tuple **tuple) -> bool override;
+
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override { return {&child_, &subquery_}; }
+
+  auto Describe() const -> std::string override;
+
+  auto GetPeakMemory() const -> size_t override;
+};
+
+/** number of rows of a morsel, the unit of work of a parallel scan. */
+const size_t MORSEL_ROWS = 16384;
+/** morsels a worker may run ahead of the consumer of a gather executor. */
+const size_t GATHER_MORSELS_PER_THREAD = 4;
+
+/**
+ * Morsel-driven parallel scan. Each worker runs its own copy of the
+ * pipeline above a scan(eg. filter, projection), and claims morsels
+ * (ranges of MORSEL_ROWS rows) of the table one at a time; the output
+ * of a morsel is gathered as a whole. If ordered, morsels are emitted
+ * in the order of the table, as a sequential scan would.
+ */
+class GatherExecutor: public AbstractExecutor {
+ public:
+  /** @return the pipeline to run above a scan. */
+  typedef std::function<AbstractExecutorRef(AbstractExecutorRef)> PipelineMaker;
+
+ private:
+  /** shared by the workers of one run. */
+  struct State {
+    std::mutex mutex_;
+    /** a morsel is done, or a worker failed. */
+    std::condition_variable ready_;
+    /** a morsel is consumed, or stopping. */
+    std::condition_variable space_;
+    /** output of morsels done but not emitted. */
+    std::map<size_t, std::vector<Tuple>> done_;
+    size_t num_morsels_{0U};
+    /** next morsel to claim. */
+    size_t next_morsel_{0U};
+    /** number of morsels emitted(if ordered, they are morsels [0, emitted_)). */
+    size_t emitted_{0U};
+    /** bytes of the tuples in done_, and their peak. */
+    size_t queued_bytes_{0U};
+    size_t peak_bytes_{0U};
+    bool stop_{false};
+    std::exception_ptr error_;
+  };
+
+  std::string table_name_;
+  Table *table_ptr_;
+  size_t num_threads_;
+  bool ordered_;
+  /** scan and pipeline of each worker. */
+  std::vector<std::shared_ptr<SeqScanExecutor>> scans_;
+  std::vector<AbstractExecutorRef> pipelines_;
+  std::shared_ptr<State> state_;
+  std::vector<std::thread> workers_;
+  /** output of the morsel being emitted. */
+  std::vector<Tuple> batch_;
+  size_t batch_pos_{0U};
+
+  /** run morsels on the pipeline of a worker. */
+  void Work(size_t id, std::shared_ptr<State> state);
+  /** stop and join the workers. */
+  void Stop();
+
+ public:
+  /**
+   * @param make_pipeline: called once for each worker.
+   * @param ordered: emit tuples in the order of the table.
+   */
+  GatherExecutor(const std::string &name, std::unordered_map<std::string, TableInfo> *tb_mgn, size_t num_threads,
+                 bool ordered, const PipelineMaker &make_pipeline);
+  GatherExecutor(GatherExecutor &&that) = default;
+  ~GatherExecutor() override { Stop(); }
+
+  auto GetOutputSchema() const -> const Schema * override { return pipelines_[0]->GetOutputSchema(); }
+
+  /** (re)start the workers. */
+  void Init() override;
+
+  auto Next(Tuple *tuple) -> bool override { return CopyNextRef(tuple); }
+
+  /** points to the output of the morsel being emitted. */
+  auto NextRef(const Tuple **tuple) -> bool override;
+
+  /** @return peak bytes of the output of morsels done but not emitted. */
+  auto GetPeakMemory() const -> size_t override;
+
+  /** the pipeline of each worker. */
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override;
+
+  auto Describe() const -> std::string override;
+};
+
+/**
+ * Profile executor wraps another one(for explain analyze), counting the
+ * tuples it emits and timing its calls of Init and Next. The times of an
+ * executor include those of its children.
+ */
+class ProfileExecutor: public AbstractExecutor {
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  AbstractExecutorRef inner_;
+  /** number of tuples emitted, and calls of Init since created. */
+  size_t rows_{0U};
+  size_t loops_{0U};
+  Clock::duration init_time_{Clock::duration::zero()};
+  Clock::duration next_time_{Clock::duration::zero()};
+
+ public:
+  explicit ProfileExecutor(AbstractExecutorRef inner): inner_(inner) {
+    cqlAssert(static_cast<bool>(inner_), "profiling a null executor");
+    exec_type_ = inner_->GetType();
+  }
+
+  auto GetOutputSchema() const -> const Schema * override { return inner_->GetOutputSchema(); }
+
+  void Init() override;
+
+  auto Next(Tuple *tuple) -> bool override;
+
+  auto NextRef(const Tuple **tuple) -> bool override;
+
+  auto GetChildren() -> std::vector<AbstractExecutorRef *> override { return inner_->GetChildren(); }
+
+  auto Describe() const -> std::string override { return inner_->Describe(); }
+
+  auto GetPeakMemory() const -> size_t override { return inner_->GetPeakMemory(); }
+
+  auto getRows() const -> size_t { return rows_; }
+  auto getLoops() const -> size_t { return loops_; }
+  /** @return milliseconds spent in Init(or Next/NextRef). */
+  auto getInitTime() const -> double { return std::chrono::duration<double, std::milli>(init_time_).count(); }
+  auto getNextTime() const -> double { return std::chrono::duration<double, std::milli>(next_time_).count(); }
+};
+
+/**
+ * @brief wrap the executor in the slot, and all executors below it, in profile executors.
+ * Must be called before Init.
+ */
+void profileExecutors(AbstractExecutorRef *slot);
+
+/**
+ * @brief print the tree of executors, a line for each(children indented below it).
+ * If profiled(and run), each line is followed by the rows in and out, the time in
+ * Init and Next, and the peak memory. The copies of a pipeline in the workers of a
+ * gather executor are printed once, their statistics summed up.
+ */
+void explainTo(std::ostream &os, const AbstractExecutorRef &root);
+
 }  // namespace cql
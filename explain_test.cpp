@@ -0,0 +1,56 @@
+#include <iostream>
+#include "executor.h"
+
+using namespace std;  using namespace cql;
+
+auto main(int argc, char **argv) -> int {
+  Table table("id:float,v:float");
+  for (size_t i = 0; i < 100000; ++i) {
+    table.insertTuple({DataBox(static_cast<double>(i)), DataBox(static_cast<double>(i % 10))});
+  }
+  unordered_map<string, TableInfo> tables;
+  tables["t"] = {&table};
+  VariableManager var_mgn;
+
+  // the pipeline of each of 4 workers: a filter over its scan.
+  AbstractExprRef predicate = toExprRef({"#v", "=", "3"});
+  AbstractExecutorRef gather = make_shared<GatherExecutor>(GatherExecutor("t", &tables, 4, true,
+    [&](AbstractExecutorRef scan) -> AbstractExecutorRef {
+      return make_shared<FilterExecutor>(predicate, scan, &var_mgn);
+    }));
+  AbstractExecutorRef root = make_shared<LimitExecutor>(20000, 5, gather);
+
+  // expect Limit 20000 offset 5, then Gather t, 4 workers, ordered; a filter and a scan below it once.
+  explainTo(cout, root);
+
+  profileExecutors(&root);
+  root->Init();
+  size_t rows = 0;
+  const Tuple *tuple;
+  while (root->NextRef(&tuple)) { ++rows; }
+  cout << "rows = " << rows << endl;  // expect 9995.
+  // expect rows out 9995, 10000, 10000 and 100000, the last two summed over 4 workers; the gather reports the
+  // memory of its queued morsels.
+  explainTo(cout, root);
+
+  // an index join probes an index of a table not sorted on the key; 3 of the 4 keys of dim match 10000 rows each.
+  Table dim("k:float");
+  for (double k : {3.0, 7.0, 42.0, 8.0}) { dim.insertTuple({DataBox(k)}); }
+  tables["dim"] = {&dim};
+  table.createIndex("tv", 1, IndexType::Hash);
+  AbstractExecutorRef join = make_shared<IndexNestedLoopJoinExecutor>(
+    make_shared<SeqScanExecutor>("dim", &tables, true), "t", &tables, toExprRef({"#dim.k", "=", "#t.v"}), &var_mgn);
+  explainTo(cout, join);  // expect IndexJoin lookup t(right) using index tv.
+  join->Init();
+  rows = 0;
+  bool ordered = true;
+  double prev_id = -1;
+  while (join->NextRef(&tuple)) {
+    ++rows;
+    const double id = tuple->getColumnData(1).getFloatValue();
+    ordered = ordered && (rows % 10000 == 1 || id > prev_id);
+    prev_id = id;
+  }
+  cout << "joined rows = " << rows << (ordered ? ", ordered" : ", unordered") << endl;  // expect 30000, ordered.
+  return 0;
+}
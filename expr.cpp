@@ -6,6 +6,19 @@
 
 namespace cql {
 
+/**********************************************************
+ *                     PatternCache
+ **********************************************************/
+auto PatternCache::getMatcher(MatchType type, const AbstractExpr *pattern) -> const StringMatcher * {
+  std::call_once(compiled_, [&]() {
+    auto const_ptr = dynamic_cast<const ConstExpr *>(pattern);
+    if (static_cast<bool>(const_ptr) && const_ptr->data_.getType() == TypeId::Char) {
+      matcher_.reset(new StringMatcher(type, const_ptr->data_.getStrValue()));
+    }
+  });
+  return matcher_.get();
+}
+
 /**********************************************************
  *                     UnaryExpr
  **********************************************************/
@@ -175,8 +188,35 @@ auto AggregateExpr::toString() const -> std::string {
     case AggregateType::Sum:
       res += "sum(";
       break;
+    case AggregateType::Avg:
+      res += "avg(";
+      break;
+    case AggregateType::Var:
+      res += "var(";
+      break;
+    case AggregateType::Stddev:
+      res += "stddev(";
+      break;
+    case AggregateType::ApproxCountDistinct:
+      res += "approx_count_distinct(";
+      break;
+    case AggregateType::ApproxQuantile:
+      res += "approx_quantile(";
+      break;
+    case AggregateType::Median:
+      res += "median(";
+      break;
+    case AggregateType::Percentile:
+      res += "percentile(";
+      break;
+    case AggregateType::TopK:
+      res += "topk(";
+      break;
   }
   res += child_->toString();
+  if (aggTakesParam(agg_type_)) {
+    res += "," + DataBox::toString(DataBox(param_));
+  }
   return res + ")";
 }
 
@@ -188,25 +228,57 @@ auto BinaryExpr::Evaluate(const Tuple *tuple, VariableManager *var_mgn, size_t i
     throw std::domain_error("left or right child is null");
   }
 
-  auto left_box = left_child_->Evaluate(tuple, var_mgn, idx);
-  auto right_box = right_child_->Evaluate(tuple, var_mgn, idx);
-  if (optr_type_ == BinaryExprType::in) {
+  if (optr_type_ == BinaryExprType::in || optr_type_ == BinaryExprType::NotIn) {
     // in operator is really, really special...
     // only output the result once?? no!
-    size_t i = 0;
-    right_box = right_child_->Evaluate(tuple, var_mgn, i);
-    while (right_box.getType() != TypeId::INVALID) {
-      if (right_box.getType() != left_box.getType()) {
+    auto left_box = left_child_->Evaluate(tuple, var_mgn, idx);
+    bool found = false;
+    auto subquery_ptr = dynamic_cast<const SubqueryExpr *>(right_child_.get());
+    if (static_cast<bool>(subquery_ptr)) {
+      // hash probe into the values of the subquery.
+      found = subquery_ptr->values_->getValues().Contains(left_box);
+    } else {
+      size_t i = 0;
+      auto right_box = right_child_->Evaluate(tuple, var_mgn, i);
+      while (!found && right_box.getType() != TypeId::INVALID) {
+        found = right_box.getType() == left_box.getType() && DataBox::EqualTo(left_box, right_box).getBoolValue();
         right_box = right_child_->Evaluate(tuple, var_mgn, ++i);
-        continue;
       }
-      if (DataBox::EqualTo(left_box, right_box).getBoolValue()) {
-        return DataBox(true);
+    }
+    return DataBox(found != (optr_type_ == BinaryExprType::NotIn));
+  }
+
+  if (isStringMatch(optr_type_)) {
+    const MatchType match_type = optr_type_ == BinaryExprType::Like ? MatchType::Like
+                               : optr_type_ == BinaryExprType::Contains ? MatchType::Contains
+                               : MatchType::StartsWith;
+    auto left_box = left_child_->Evaluate(tuple, var_mgn, idx);
+    const StringMatcher *matcher = static_cast<bool>(pattern_) 
+                                 ? pattern_->getMatcher(match_type, right_child_.get()) : nullptr;
+    if (static_cast<bool>(matcher)) {
+      if (left_box.getType() == TypeId::INVALID) { return DataBox(TypeId::INVALID, ""); }
+      if (left_box.getType() != TypeId::Char) {
+        throw std::domain_error("matching a pattern against a non-string?? Impossible!");
       }
-      right_box = right_child_->Evaluate(tuple, var_mgn, ++i);
+      return DataBox(matcher->Matches(left_box.getStrValue()));
+    }
+    // the pattern varies from row to row.
+    auto right_box = right_child_->Evaluate(tuple, var_mgn, idx);
+    if (left_box.getType() == TypeId::INVALID || right_box.getType() == TypeId::INVALID) {
+      return DataBox(TypeId::INVALID, "");
     }
+    if (left_box.getType() != TypeId::Char || right_box.getType() != TypeId::Char) {
+      throw std::domain_error("matching a pattern against a non-string?? Impossible!");
+    }
+    return DataBox(StringMatcher(match_type, right_box.getStrValue()).Matches(left_box.getStrValue()));
+  }
+
+  auto left_box = left_child_->Evaluate(tuple, var_mgn, idx);
+  if (short_circuit_ && optr_type_ == BinaryExprType::And && (left_box.getType() == TypeId::INVALID 
+      || (left_box.getType() == TypeId::Bool && !left_box.getBoolValue()))) {
     return DataBox(false);
   }
+  auto right_box = right_child_->Evaluate(tuple, var_mgn, idx);
   if (left_box.getType() == TypeId::INVALID || right_box.getType() == TypeId::INVALID) {
     return DataBox(TypeId::INVALID, "");
   }
@@ -224,7 +296,12 @@ auto BinaryExpr::Evaluate(const Tuple *tuple, VariableManager *var_mgn, size_t i
       return DataBox::EqualTo(left_box, right_box);
     case BinaryExprType::NotEqualTo:
       return DataBox::NotEqualTo(left_box, right_box);
-    // others will be handled later.
+    case BinaryExprType::in: case BinaryExprType::NotIn:
+    case BinaryExprType::Like: case BinaryExprType::Contains: case BinaryExprType::StartsWith:
+      throw std::domain_error("in and string matches are evaluated above?? Impossible!");
+    default:
+      // others will be handled later.
+      break;
   }
 
   if (left_box.getType() != right_box.getType()) {
@@ -343,6 +420,18 @@ auto BinaryExpr::toString() const -> std::string {
     case BinaryExprType::in:
       res += ") in (";
       break;
+    case BinaryExprType::NotIn:
+      res += ") not in (";
+      break;
+    case BinaryExprType::Like:
+      res += ") like (";
+      break;
+    case BinaryExprType::Contains:
+      res += ") contains (";
+      break;
+    case BinaryExprType::StartsWith:
+      res += ") startswith (";
+      break;
     default:
       // throw std::domain_error("unrecognizable binary operation on float");
       res += ")<unknown operator>(";
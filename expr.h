@@ -1,8 +1,12 @@
 #pragma once
 
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <unordered_set>
 
+#include "string_match.h"
 #include "tuple.h"
 #include "type.h"
 #include "variable_manager.h"
@@ -19,7 +23,8 @@ enum ExprType {
   Const,     // constant expression
   Unary,     // unary expression of float type
   Binary,    // binary expression of float type
-  Variable   // TODO(Fudanyrd): add variable type.
+  Variable,  // TODO(Fudanyrd): add variable type.
+  Subquery   // values of a subquery, (select ...)
 };
 
 // abstract arithmetic expression.
@@ -152,19 +157,56 @@ enum BinaryExprType {
   EqualTo,              // =
   NotEqualTo,           // !=
   in,                   // a in @var
+  NotIn,                // a not in @var
+  Like,                 // a like 'pattern'
+  Contains,             // a contains 'substring'
+  StartsWith,           // a startswith 'prefix'
   unknown
 };
 
+/**
+ * @return true if the operator matches strings against a pattern.
+ */
+inline auto isStringMatch(BinaryExprType tp) -> bool {
+  return tp == BinaryExprType::Like || tp == BinaryExprType::Contains || tp == BinaryExprType::StartsWith;
+}
+
+/**
+ * Pattern of like/contains/startswith. If it is a constant, it is
+ * compiled once on first use, not once for each row.
+ */
+class PatternCache {
+ private:
+  std::once_flag compiled_;
+  std::unique_ptr<StringMatcher> matcher_;
+
+ public:
+  /**
+   * @return the compiled pattern(thread safe), nullptr if it is not a constant string.
+   */
+  auto getMatcher(MatchType type, const AbstractExpr *pattern) -> const StringMatcher *;
+};
+
 // binary expression
 class BinaryExpr: public AbstractExpr {
  public:
   AbstractExprRef left_child_{nullptr};
   AbstractExprRef right_child_{nullptr};
   BinaryExprType optr_type_{unknown};
+  /** like/contains/startswith only; shared by copies. */
+  std::shared_ptr<PatternCache> pattern_{nullptr};
+  /**
+   * and of the conjuncts of a filter, where false and NULL both reject a row:
+   * once the left child is not true, the right child is not evaluated.
+   */
+  bool short_circuit_{false};
 
   BinaryExpr() { expr_type_ = ExprType::Binary; }
   BinaryExpr(BinaryExprType tp, AbstractExprRef left, AbstractExprRef right):
-    left_child_(left), right_child_(right), optr_type_(tp) { expr_type_ = ExprType::Binary; }
+    left_child_(left), right_child_(right), optr_type_(tp) {
+    expr_type_ = ExprType::Binary;
+    if (isStringMatch(tp)) { pattern_ = std::make_shared<PatternCache>(); }
+  }
 
   auto Clone() const -> AbstractExprRef override {
     return std::make_shared<BinaryExpr>(BinaryExpr(optr_type_, nullptr, nullptr));
@@ -180,22 +222,42 @@ enum AggregateType {
   Count,
   Max,
   Min,
-  Sum
+  Sum,
+  Avg,       // arithmetic mean
+  Var,       // sample variance
+  Stddev,    // sample standard deviation
+  ApproxCountDistinct,  // HyperLogLog distinct count
+  ApproxQuantile,       // KLL quantile, takes the quantile as parameter
+  Median,               // exact median
+  Percentile,           // exact quantile, takes the quantile as parameter
+  TopK                  // Space-Saving heavy hitters, takes k as parameter
 };
 
+/**
+ * @return true if the aggregate takes a constant parameter after its input,
+ * like approx_quantile(#x, 0.5).
+ */
+inline auto aggTakesParam(AggregateType agg_tp) -> bool {
+  return agg_tp == AggregateType::ApproxQuantile || agg_tp == AggregateType::Percentile 
+      || agg_tp == AggregateType::TopK;
+}
+
 // aggregation expression
 class AggregateExpr: public AbstractExpr {
  public:
   AggregateType agg_type_;
   AbstractExprRef child_;
-  AggregateExpr(AggregateType agg_tp, AbstractExprRef child) {
+  /** constant parameter if aggTakesParam(agg_type_). */
+  double param_{0.0};
+  AggregateExpr(AggregateType agg_tp, AbstractExprRef child, double param = 0.0) {
     this->expr_type_ = ExprType::Aggregate;
     this->agg_type_ = agg_tp;
     this->child_ = child;
+    this->param_ = param;
   }
 
   auto Clone() const -> AbstractExprRef override {
-    return std::make_shared<AggregateExpr>(AggregateExpr(agg_type_, nullptr));
+    return std::make_shared<AggregateExpr>(AggregateExpr(agg_type_, nullptr, param_));
   }
 
   auto Evaluate(const Tuple *tuple, VariableManager *var_mgn, size_t idx) const -> DataBox override {
@@ -233,10 +295,9 @@ class ColumnExpr: public AbstractExpr {
 
   auto Evaluate(const Tuple *tuple, [[maybe_unused]] VariableManager *var_mgn, size_t idx) const -> DataBox { 
     auto schema_ptr = tuple->getSchema();
-    for (size_t i = 0; i < schema_ptr->getNumCols(); ++i) {
-      if (column_name_ == schema_ptr->getColumn(i).second) {
-        return tuple->getColumnData(i); 
-      }
+    size_t i = schema_ptr->getColumnIdx(column_name_);
+    if (i != static_cast<size_t>(-1)) {
+      return tuple->getColumnData(i); 
     }
     throw std::domain_error(("unable to recognize column name " + column_name_ + "?? Impossible!").c_str());
   }
@@ -266,4 +327,70 @@ class VariableExpr: public AbstractExpr {
   auto toString() const -> std::string { return var_name_; }
 };
 
+/**
+ * Hash set of values, for probing `in` operators in O(1).
+ * NULLs are never members(as with `in @var`).
+ */
+class ValueSet {
+ private:
+  std::unordered_set<DataBox, BoxHash, BoxEqual> values_;
+
+ public:
+  void Insert(const DataBox &box) {
+    if (box.getType() != TypeId::INVALID) { values_.insert(box); }
+  }
+  auto Contains(const DataBox &box) const -> bool { return values_.count(box) != 0; }
+  auto getSize() const -> size_t { return values_.size(); }
+  auto getSet() const -> const std::unordered_set<DataBox, BoxHash, BoxEqual> & { return values_; }
+  void Clear() { values_.clear(); }
+};
+
+/**
+ * Values of an uncorrelated subquery. The planner sets a loader
+ * running the subquery, which is called once on first use.
+ */
+class SubqueryValues {
+ private:
+  ValueSet values_;
+  std::once_flag loaded_;
+  std::function<void(ValueSet *)> loader_;
+
+ public:
+  void setLoader(const std::function<void(ValueSet *)> &loader) { loader_ = loader; }
+
+  /**
+   * @return values of the subquery, run it if not yet(thread safe).
+   */
+  auto getValues() -> const ValueSet & {
+    cqlAssert(static_cast<bool>(loader_), "subquery is not planned");
+    std::call_once(loaded_, loader_, &values_);
+    return values_;
+  }
+};
+
+// subquery expression: the i-th subquery of a statement, written as $i
+// once the parser has taken the subquery out.
+// can only be the right operand of in/not in.
+class SubqueryExpr: public AbstractExpr {
+ public:
+  /** index of the subquery in the parser log. */
+  size_t subquery_idx_{0U};
+  /** shared by clones. */
+  std::shared_ptr<SubqueryValues> values_;
+
+  SubqueryExpr(size_t idx, std::shared_ptr<SubqueryValues> values = std::make_shared<SubqueryValues>()):
+    subquery_idx_(idx), values_(values) {
+    expr_type_ = ExprType::Subquery;
+  }
+
+  auto Clone() const -> AbstractExprRef override {
+    return std::make_shared<SubqueryExpr>(SubqueryExpr(subquery_idx_, values_));
+  }
+
+  auto Evaluate(const Tuple *tuple, VariableManager *var_mgn, size_t idx) const -> DataBox override {
+    throw std::domain_error("subquery is not the right operand of in?? Impossible!");
+  }
+  auto toString() const -> std::string override { return "$" + std::to_string(subquery_idx_); }
+};
+
 }  // namespace cql;
\ No newline at end of file
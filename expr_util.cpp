@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include <stack>
 #include <unordered_map>
 
@@ -29,8 +30,12 @@ const std::unordered_map<std::string, int> isp_table = {
   {"<=", 8},
   {">=", 8},
   {"=", 8},
+  {"like", 8},
+  {"contains", 8},
+  {"startswith", 8},
   // in
   {"in", 4},
+  {"not in", 4},
   // not
   {"not", 3},
   // and, or, xor
@@ -72,10 +77,14 @@ const std::unordered_map<std::string, int> icp_table = {
   {"<=", 7},
   {">=", 7},
   {"=", 7},
+  {"like", 7},
+  {"contains", 7},
+  {"startswith", 7},
   // not
   {"not", 6},
   // in
   {"in", 5},
+  {"not in", 5},
   // and, or, xor
   {"and", 1},
   {"or",  1},
@@ -134,6 +143,16 @@ auto getVariableExpr(const std::string &word) -> AbstractExprRef {
   }
   return std::make_shared<VariableExpr>(VariableExpr(word));
 }
+/**
+ * @return the subquery expression node of a placeholder $i.
+ * nullptr if not a subquery.
+ */
+auto getSubqueryExpr(const std::string &word) -> AbstractExprRef {
+  if (word.size() < 2 || word[0] != '$') {
+    return nullptr;
+  }
+  return std::make_shared<SubqueryExpr>(SubqueryExpr(static_cast<size_t>(atoi(word.c_str() + 1))));
+}
 /**
  * @return the column expression node.
  * nullptr if not an column type.
@@ -196,6 +215,18 @@ auto XorOperator() -> AbstractExprRef {
 auto InOperator() -> AbstractExprRef {
   return std::make_shared<BinaryExpr>(BinaryExpr(BinaryExprType::in, nullptr, nullptr));
 }
+auto NotInOperator() -> AbstractExprRef {
+  return std::make_shared<BinaryExpr>(BinaryExpr(BinaryExprType::NotIn, nullptr, nullptr));
+}
+auto LikeOperator() -> AbstractExprRef {
+  return std::make_shared<BinaryExpr>(BinaryExpr(BinaryExprType::Like, nullptr, nullptr));
+}
+auto ContainsOperator() -> AbstractExprRef {
+  return std::make_shared<BinaryExpr>(BinaryExpr(BinaryExprType::Contains, nullptr, nullptr));
+}
+auto StartsWithOperator() -> AbstractExprRef {
+  return std::make_shared<BinaryExpr>(BinaryExpr(BinaryExprType::StartsWith, nullptr, nullptr));
+}
 auto ToBoolOperator() -> AbstractExprRef {
   return std::make_shared<UnaryExpr>(UnaryExpr(UnaryExprType::ToBool, nullptr));
 }
@@ -259,6 +290,30 @@ auto MinOperator() -> AbstractExprRef {
 auto SumOperator() -> AbstractExprRef {
   return std::make_shared<AggregateExpr>(AggregateExpr(AggregateType::Sum, nullptr));
 }
+auto AvgOperator() -> AbstractExprRef {
+  return std::make_shared<AggregateExpr>(AggregateExpr(AggregateType::Avg, nullptr));
+}
+auto VarOperator() -> AbstractExprRef {
+  return std::make_shared<AggregateExpr>(AggregateExpr(AggregateType::Var, nullptr));
+}
+auto StddevOperator() -> AbstractExprRef {
+  return std::make_shared<AggregateExpr>(AggregateExpr(AggregateType::Stddev, nullptr));
+}
+auto ApproxCountDistinctOperator() -> AbstractExprRef {
+  return std::make_shared<AggregateExpr>(AggregateExpr(AggregateType::ApproxCountDistinct, nullptr));
+}
+auto ApproxQuantileOperator() -> AbstractExprRef {
+  return std::make_shared<AggregateExpr>(AggregateExpr(AggregateType::ApproxQuantile, nullptr));
+}
+auto MedianOperator() -> AbstractExprRef {
+  return std::make_shared<AggregateExpr>(AggregateExpr(AggregateType::Median, nullptr));
+}
+auto PercentileOperator() -> AbstractExprRef {
+  return std::make_shared<AggregateExpr>(AggregateExpr(AggregateType::Percentile, nullptr));
+}
+auto TopKOperator() -> AbstractExprRef {
+  return std::make_shared<AggregateExpr>(AggregateExpr(AggregateType::TopK, nullptr));
+}
  
 typedef AbstractExprRef (*ExprFunc)();  // expr functions
 std::unordered_map<std::string, ExprFunc> operator_factory = {
@@ -278,6 +333,10 @@ std::unordered_map<std::string, ExprFunc> operator_factory = {
   {"or", OrOperator},
   {"xor", XorOperator},
   {"in", InOperator},
+  {"not in", NotInOperator},
+  {"like", LikeOperator},
+  {"contains", ContainsOperator},
+  {"startswith", StartsWithOperator},
   {"tobool", ToBoolOperator},
   {"tofloat", ToFloatOperator},
   {"tostr", ToStrOperator},
@@ -298,7 +357,15 @@ std::unordered_map<std::string, ExprFunc> operator_factory = {
   {"count", CountOperator},
   {"max", MaxOperator},
   {"min", MinOperator},
-  {"sum", SumOperator}
+  {"sum", SumOperator},
+  {"avg", AvgOperator},
+  {"var", VarOperator},
+  {"stddev", StddevOperator},
+  {"approx_count_distinct", ApproxCountDistinctOperator},
+  {"approx_quantile", ApproxQuantileOperator},
+  {"median", MedianOperator},
+  {"percentile", PercentileOperator},
+  {"topk", TopKOperator}
 };
 
 /**
@@ -347,6 +414,13 @@ auto toPostOrder(const std::vector<std::string> &words) -> std::vector<AbstractE
       continue;
     }
 
+    current = getSubqueryExpr(word);
+    if (static_cast<bool>(current)) {
+      // OK, is a subquery taken out by the parser.
+      expr_refs.push_back(current);
+      continue;
+    }
+
     current = getColumnExpr(word);
     if (static_cast<bool>(current)) {
       // OK, is column from a table...
@@ -355,6 +429,21 @@ auto toPostOrder(const std::vector<std::string> &words) -> std::vector<AbstractE
       continue;
     }
 
+    if (word == ",") {
+      // separates arguments of a function: output operators of
+      // the previous argument, keep the '(' of the function.
+      while (!operators.empty() && operators.top() != "(") {
+        if (operators.top() != ")") {
+          expr_refs.push_back(getOperator(operators.top()));
+        }
+        operators.pop();
+      }
+      if (operators.empty()) {
+        throw std::domain_error("ERROR: ',' outside of a function call");
+      }
+      continue;
+    }
+
     current = getOperator(word);
     if (static_cast<bool>(current) || word == "(" || word == ")") {
       // OK, is a variable.
@@ -429,6 +518,13 @@ auto toPostOrder(const std::vector<std::string> &words, size_t begin, size_t end
       continue;
     }
 
+    current = getSubqueryExpr(word);
+    if (static_cast<bool>(current)) {
+      // OK, is a subquery taken out by the parser.
+      expr_refs.push_back(current);
+      continue;
+    }
+
     current = getColumnExpr(word);
     if (static_cast<bool>(current)) {
       // OK, is column from a table...
@@ -437,6 +533,21 @@ auto toPostOrder(const std::vector<std::string> &words, size_t begin, size_t end
       continue;
     }
 
+    if (word == ",") {
+      // separates arguments of a function: output operators of
+      // the previous argument, keep the '(' of the function.
+      while (!operators.empty() && operators.top() != "(") {
+        if (operators.top() != ")") {
+          expr_refs.push_back(getOperator(operators.top()));
+        }
+        operators.pop();
+      }
+      if (operators.empty()) {
+        throw std::domain_error("ERROR: ',' outside of a function call");
+      }
+      continue;
+    }
+
     current = getOperator(word);
     if (static_cast<bool>(current) || word == "(" || word == ")") {
       // OK, is a variable.
@@ -482,6 +593,16 @@ auto toPostOrder(const std::vector<std::string> &words, size_t begin, size_t end
   return expr_refs;
 }
 
+/**
+ * @return value of the constant parameter of an aggregate.
+ */
+static auto aggParam(const AbstractExprRef &param) -> double {
+  cqlAssert(isConstExpr(param), "parameter of aggregate is not a constant");
+  DataBox box = DataBox::toFloat(param->Evaluate(nullptr, nullptr, 0));
+  cqlAssert(box.getType() == TypeId::Float, "parameter of aggregate is not a number");
+  return box.getFloatValue();
+}
+
 auto toExprRef(const std::vector<std::string> &words) -> AbstractExprRef {
   std::vector<AbstractExprRef> refs = toPostOrder(words);
   std::stack<AbstractExprRef> operands;
@@ -502,9 +623,17 @@ auto toExprRef(const std::vector<std::string> &words) -> AbstractExprRef {
           throw std::domain_error("aggregate expr missing operand?? Impossible!");
         }
         auto unary_ptr = dynamic_cast<AggregateExpr *>(ref.get());
+        if (aggTakesParam(unary_ptr->agg_type_)) {
+          unary_ptr->param_ = aggParam(operands.top());
+          operands.pop();
+          if (operands.empty()) {
+            throw std::domain_error("aggregate expr missing operand?? Impossible!");
+          }
+        }
         unary_ptr->child_ = operands.top();
         operands.pop();
-        operands.push(std::make_shared<AggregateExpr>(AggregateExpr(unary_ptr->agg_type_, unary_ptr->child_)));
+        operands.push(std::make_shared<AggregateExpr>(AggregateExpr(unary_ptr->agg_type_, unary_ptr->child_,
+                                                                    unary_ptr->param_)));
         break;
       }
 
@@ -550,9 +679,17 @@ auto toExprRef(const std::vector<std::string> &words, size_t begin, size_t end)
           throw std::domain_error("aggregate expr missing operand?? Impossible!");
         }
         auto unary_ptr = dynamic_cast<AggregateExpr *>(ref.get());
+        if (aggTakesParam(unary_ptr->agg_type_)) {
+          unary_ptr->param_ = aggParam(operands.top());
+          operands.pop();
+          if (operands.empty()) {
+            throw std::domain_error("aggregate expr missing operand?? Impossible!");
+          }
+        }
         unary_ptr->child_ = operands.top();
         operands.pop();
-        operands.push(std::make_shared<AggregateExpr>(AggregateExpr(unary_ptr->agg_type_, unary_ptr->child_)));
+        operands.push(std::make_shared<AggregateExpr>(AggregateExpr(unary_ptr->agg_type_, unary_ptr->child_,
+                                                                    unary_ptr->param_)));
         break;
       }
 
@@ -586,7 +723,7 @@ auto isConstExpr(const AbstractExprRef &root) -> bool {
   const BinaryExpr *bin_ptr;
   const AggregateExpr *agg_ptr;
   switch(root->GetExprType()) {
-    case ExprType::Column: case ExprType::Variable:
+    case ExprType::Column: case ExprType::Variable: case ExprType::Subquery:
       return false;
     case ExprType::Const:
       return true;
@@ -598,7 +735,7 @@ auto isConstExpr(const AbstractExprRef &root) -> bool {
         return isConstExpr(agg_ptr->child_);
     case ExprType::Binary:
       bin_ptr = dynamic_cast<const BinaryExpr *>(root.get());
-      if (bin_ptr->optr_type_ == BinaryExprType::in) {
+      if (bin_ptr->optr_type_ == BinaryExprType::in || bin_ptr->optr_type_ == BinaryExprType::NotIn) {
         // this should be seen as const expr.
         return true;
       }
@@ -611,7 +748,7 @@ auto isConstExpr(const AbstractExprRef &root) -> bool {
 auto isAggExpr(const AbstractExprRef &root) -> bool {
   cqlAssert(static_cast<bool>(root), "trying to tell if a null expr tree is agg");
   switch (root->GetExprType()) {
-    case ExprType::Column: case ExprType::Variable: case ExprType::Const:
+    case ExprType::Column: case ExprType::Variable: case ExprType::Const: case ExprType::Subquery:
       return false;
     case ExprType::Aggregate:
       return true;
@@ -632,7 +769,7 @@ void findAggExprs(const AbstractExprRef &root, std::unordered_map<std::string, A
     throw std::domain_error("trying to find agg exprs in a null expr tree?? Impossible!");
   }
   switch (root->GetExprType()) {
-    case ExprType::Column: case ExprType::Variable: case ExprType::Const:
+    case ExprType::Column: case ExprType::Variable: case ExprType::Const: case ExprType::Subquery:
       return;
     case ExprType::Unary: {
       const UnaryExpr *unary_ptr = dynamic_cast<const UnaryExpr *>(root.get());
@@ -655,7 +792,7 @@ void findAggExprs(const AbstractExprRef &root, std::unordered_map<std::string, A
 auto aggAsColumn(const AbstractExprRef &root) -> AbstractExprRef {
   cqlAssert(static_cast<bool>(root), "argument to aggAsColumn is null");
   switch (root->GetExprType()) {
-    case ExprType::Column: case ExprType::Variable: case ExprType::Const:
+    case ExprType::Column: case ExprType::Variable: case ExprType::Const: case ExprType::Subquery:
       return root->Clone();
     case ExprType::Unary: {
       const UnaryExpr *unary_ptr = dynamic_cast<const UnaryExpr *>(root.get());
@@ -673,4 +810,189 @@ auto aggAsColumn(const AbstractExprRef &root) -> AbstractExprRef {
   throw std::domain_error("(in function aggAsColumn)expr type didn't match any?? Impossible!");
 }
 
+void splitConjuncts(const AbstractExprRef &expr, std::vector<AbstractExprRef> &conjuncts) {
+  auto binary_ptr = dynamic_cast<const BinaryExpr *>(expr.get());
+  if (static_cast<bool>(binary_ptr) && binary_ptr->optr_type_ == BinaryExprType::And) {
+    splitConjuncts(binary_ptr->left_child_, conjuncts);
+    splitConjuncts(binary_ptr->right_child_, conjuncts);
+    return;
+  }
+  conjuncts.push_back(expr);
+}
+
+auto conjoinFilter(const AbstractExprRef &left, const AbstractExprRef &right) -> AbstractExprRef {
+  if (!static_cast<bool>(left)) { return right; }
+  auto res = std::make_shared<BinaryExpr>(BinaryExpr(BinaryExprType::And, left, right));
+  res->short_circuit_ = true;
+  return res;
+}
+
+void findSubqueries(const AbstractExprRef &root, std::vector<std::shared_ptr<SubqueryExpr>> &subqueries) {
+  cqlAssert(static_cast<bool>(root), "trying to find subqueries in a null expr tree");
+  switch (root->GetExprType()) {
+    case ExprType::Column: case ExprType::Variable: case ExprType::Const:
+      return;
+    case ExprType::Subquery:
+      subqueries.push_back(std::dynamic_pointer_cast<SubqueryExpr>(root));
+      return;
+    case ExprType::Unary:
+      findSubqueries(dynamic_cast<const UnaryExpr *>(root.get())->child_, subqueries);
+      return;
+    case ExprType::Aggregate:
+      findSubqueries(dynamic_cast<const AggregateExpr *>(root.get())->child_, subqueries);
+      return;
+    case ExprType::Binary: {
+      const BinaryExpr *binary_ptr = dynamic_cast<const BinaryExpr *>(root.get());
+      findSubqueries(binary_ptr->left_child_, subqueries);
+      findSubqueries(binary_ptr->right_child_, subqueries);
+      return;
+    }
+  }
+}
+
+/**
+ * @brief narrow the range of a column by a conjunct `<column> op <const>`(or `<const> op <column>`),
+ * other conjuncts are ignored.
+ */
+static void narrowRange(const AbstractExprRef &conjunct, const Schema *schema, std::vector<ColumnRange> *ranges) {
+  auto binary_ptr = dynamic_cast<const BinaryExpr *>(conjunct.get());
+  if (!static_cast<bool>(binary_ptr)) { return; }
+  BinaryExprType op = binary_ptr->optr_type_;
+  auto col_ptr = dynamic_cast<const ColumnExpr *>(binary_ptr->left_child_.get());
+  auto const_ptr = dynamic_cast<const ConstExpr *>(binary_ptr->right_child_.get());
+  if (!static_cast<bool>(col_ptr)) {
+    // const op column: flip to column op const.
+    col_ptr = dynamic_cast<const ColumnExpr *>(binary_ptr->right_child_.get());
+    const_ptr = dynamic_cast<const ConstExpr *>(binary_ptr->left_child_.get());
+    switch (op) {
+      case BinaryExprType::LessThan: op = BinaryExprType::GreaterThan; break;
+      case BinaryExprType::LessThanOrEqual: op = BinaryExprType::GreaterThanOrEqual; break;
+      case BinaryExprType::GreaterThan: op = BinaryExprType::LessThan; break;
+      case BinaryExprType::GreaterThanOrEqual: op = BinaryExprType::LessThanOrEqual; break;
+      default: break;
+    }
+  }
+  if (!static_cast<bool>(col_ptr) || !static_cast<bool>(const_ptr)) { return; }
+  // NOTE: 'prefix' startswith #col is not a range.
+  if (op == BinaryExprType::StartsWith && col_ptr != binary_ptr->left_child_.get()) { return; }
+  const bool prefix = op == BinaryExprType::StartsWith && const_ptr->data_.getType() == TypeId::Char;
+  const bool lower = op == BinaryExprType::GreaterThan || op == BinaryExprType::GreaterThanOrEqual 
+                  || op == BinaryExprType::EqualTo || prefix;
+  bool upper = op == BinaryExprType::LessThan || op == BinaryExprType::LessThanOrEqual
+              || op == BinaryExprType::EqualTo;
+  bool inclusive = op != BinaryExprType::LessThan && op != BinaryExprType::GreaterThan;
+  const size_t col = schema->getColumnIdx(col_ptr->column_name_);
+  const DataBox &val = const_ptr->data_;
+  // comparing values of different types throws, leave it to the predicate.
+  if ((!lower && !upper) || col == static_cast<size_t>(-1) || val.getType() != schema->getColumn(col).first) {
+    return;
+  }
+  // strings with a prefix are in [prefix, successor), where the successor
+  // increments the last byte below 0xff and drops those after it.
+  DataBox hi_val = val;
+  if (prefix) {
+    std::string successor = val.getStrValue();
+    while (!successor.empty() && static_cast<unsigned char>(successor.back()) == 0xff) { successor.pop_back(); }
+    if (!successor.empty()) {
+      successor.back() = static_cast<char>(static_cast<unsigned char>(successor.back()) + 1);
+      hi_val = DataBox(TypeId::Char, successor);
+      upper = true;
+    }
+  }
+
+  size_t i = 0;
+  while (i < ranges->size() && (*ranges)[i].col_ != col) { ++i; }
+  if (i == ranges->size()) {
+    ranges->push_back(ColumnRange());
+    ranges->back().col_ = col;
+  }
+  ColumnRange &range = (*ranges)[i];
+  if (lower) {
+    if (range.lo_.getType() == TypeId::INVALID || DataBox::GreaterThan(val, range.lo_).getBoolValue()) {
+      range.lo_ = val;
+      range.lo_inclusive_ = inclusive;
+    } else if (DataBox::EqualTo(val, range.lo_).getBoolValue()) {
+      range.lo_inclusive_ = range.lo_inclusive_ && inclusive;
+    }
+  }
+  if (upper) {
+    inclusive = inclusive && !prefix;
+    if (range.hi_.getType() == TypeId::INVALID || DataBox::LessThan(hi_val, range.hi_).getBoolValue()) {
+      range.hi_ = hi_val;
+      range.hi_inclusive_ = inclusive;
+    } else if (DataBox::EqualTo(hi_val, range.hi_).getBoolValue()) {
+      range.hi_inclusive_ = range.hi_inclusive_ && inclusive;
+    }
+  }
+}
+
+void findColumnRanges(const AbstractExprRef &predicate, const Schema *schema, std::vector<ColumnRange> *ranges) {
+  std::vector<AbstractExprRef> conjuncts;
+  splitConjuncts(predicate, conjuncts);
+  for (const auto &conjunct : conjuncts) {
+    narrowRange(conjunct, schema, ranges);
+  }
+}
+
+auto rangeToString(const ColumnRange &range, const Schema *schema) -> std::string {
+  const std::string column = schema->getColumn(range.col_).second;
+  const bool has_lo = range.lo_.getType() != TypeId::INVALID, has_hi = range.hi_.getType() != TypeId::INVALID;
+  if (has_lo && has_hi && range.lo_inclusive_ && range.hi_inclusive_ && DataBox::Identical(range.lo_, range.hi_)) {
+    return column + " = " + DataBox::toString(range.lo_);
+  }
+  if (has_lo && has_hi) {
+    return column + " in " + (range.lo_inclusive_ ? "[" : "(") + DataBox::toString(range.lo_) + ", "
+         + DataBox::toString(range.hi_) + (range.hi_inclusive_ ? "]" : ")");
+  }
+  if (has_lo) { return column + (range.lo_inclusive_ ? " >= " : " > ") + DataBox::toString(range.lo_); }
+  if (has_hi) { return column + (range.hi_inclusive_ ? " <= " : " < ") + DataBox::toString(range.hi_); }
+  return column + " in (-inf, inf)";
+}
+
+void findColumns(const AbstractExprRef &root, std::vector<std::string> &columns) {
+  cqlAssert(static_cast<bool>(root), "trying to find columns in a null expr tree");
+  switch (root->GetExprType()) {
+    case ExprType::Variable: case ExprType::Const: case ExprType::Subquery:
+      return;
+    case ExprType::Column:
+      columns.push_back(dynamic_cast<const ColumnExpr *>(root.get())->column_name_);
+      return;
+    case ExprType::Unary:
+      findColumns(dynamic_cast<const UnaryExpr *>(root.get())->child_, columns);
+      return;
+    case ExprType::Aggregate:
+      findColumns(dynamic_cast<const AggregateExpr *>(root.get())->child_, columns);
+      return;
+    case ExprType::Binary: {
+      const BinaryExpr *binary_ptr = dynamic_cast<const BinaryExpr *>(root.get());
+      findColumns(binary_ptr->left_child_, columns);
+      findColumns(binary_ptr->right_child_, columns);
+      return;
+    }
+  }
+}
+
+void findVariables(const AbstractExprRef &root, std::vector<std::string> &variables) {
+  cqlAssert(static_cast<bool>(root), "trying to find variables in a null expr tree");
+  switch (root->GetExprType()) {
+    case ExprType::Column: case ExprType::Const: case ExprType::Subquery:
+      return;
+    case ExprType::Variable:
+      variables.push_back(dynamic_cast<const VariableExpr *>(root.get())->var_name_);
+      return;
+    case ExprType::Unary:
+      findVariables(dynamic_cast<const UnaryExpr *>(root.get())->child_, variables);
+      return;
+    case ExprType::Aggregate:
+      findVariables(dynamic_cast<const AggregateExpr *>(root.get())->child_, variables);
+      return;
+    case ExprType::Binary: {
+      const BinaryExpr *binary_ptr = dynamic_cast<const BinaryExpr *>(root.get());
+      findVariables(binary_ptr->left_child_, variables);
+      findVariables(binary_ptr->right_child_, variables);
+      return;
+    }
+  }
+}
+
 }  // namespace cql
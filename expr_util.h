@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "expr.h"
+#include "zone_map.h"
 
 namespace cql {
 
@@ -65,4 +66,42 @@ void findAggExprs(const AbstractExprRef &root, std::unordered_map<std::string, A
  */
 auto aggAsColumn(const AbstractExprRef &root) -> AbstractExprRef;
 
+/**
+ * @brief split expr into conjuncts(operands of and).
+ */
+void splitConjuncts(const AbstractExprRef &expr, std::vector<AbstractExprRef> &conjuncts);
+
+/**
+ * @return the and of two conjuncts of a filter(nullptr if left is): right
+ * is not evaluated for the rows left rejects.
+ */
+auto conjoinFilter(const AbstractExprRef &left, const AbstractExprRef &right) -> AbstractExprRef;
+
+/**
+ * @brief find all subquery expressions in an expression tree.
+ */
+void findSubqueries(const AbstractExprRef &root, std::vector<std::shared_ptr<SubqueryExpr>> &subqueries);
+
+/**
+ * @brief narrow ranges of columns by the conjuncts `<column> op <const>`(or `<const> op <column>`) of
+ * a predicate, op being one of = < <= > >=. Rows out of the ranges are rejected by the predicate.
+ * @param ranges[in/out] at most one range per column.
+ */
+void findColumnRanges(const AbstractExprRef &predicate, const Schema *schema, std::vector<ColumnRange> *ranges);
+
+/**
+ * @return a range of a column of the schema, like `a in [1, 5)`, `a = 3` or `a >= 1`.
+ */
+auto rangeToString(const ColumnRange &range, const Schema *schema) -> std::string;
+
+/**
+ * @brief find names of all columns an expression tree reads(not those of its subqueries).
+ */
+void findColumns(const AbstractExprRef &root, std::vector<std::string> &columns);
+
+/**
+ * @brief find names of all variables an expression tree reads(not those of its subqueries).
+ */
+void findVariables(const AbstractExprRef &root, std::vector<std::string> &variables);
+
 }  // namespace cql
\ No newline at end of file
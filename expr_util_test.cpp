@@ -10,7 +10,7 @@ auto main(int argc, char **argv) -> int {
 
   cql::AbstractExprRef root = cql::toExprRef(test);
   std::cout << root->toString() << std::endl;
-  std::cout << root->Evaluate(nullptr).getFloatValue() << std::endl;
+  std::cout << root->Evaluate(nullptr, nullptr, 0).getFloatValue() << std::endl;
 
   // input any expressions word by word.
   test.clear();
@@ -22,9 +22,9 @@ auto main(int argc, char **argv) -> int {
   }
   root = cql::toExprRef(test);
   std::cout << root->toString() << std::endl;
-  std::cout << root->Evaluate(nullptr).getFloatValue() << std::endl;
+  std::cout << root->Evaluate(nullptr, nullptr, 0).getFloatValue() << std::endl;
   // maybe can test on string...
-  std::cout << root->Evaluate(nullptr).getStrValue();
+  std::cout << root->Evaluate(nullptr, nullptr, 0).getStrValue();
 
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,621 @@
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+
+#include "index.h"
+
+namespace cql {
+
+/************************************************
+ *                TableIndex
+ ************************************************/
+auto TableIndex::CountOut(const DataBox &key, int delta) -> bool {
+  if (key.getType() == TypeId::INVALID) {
+    nulls_ += delta;
+  } else if (key.getType() != key_type_) {
+    mismatched_ += delta;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void findKeys(const TableIndex *index, const std::vector<DataBox> &keys, std::vector<size_t> *rows) {
+  for (const auto &key : keys) {
+    if (key.getType() == index->getKeyType()) { index->Find(key, rows); }
+  }
+  std::sort(rows->begin(), rows->end());
+  rows->erase(std::unique(rows->begin(), rows->end()), rows->end());
+}
+
+auto workerThreads(size_t max_threads) -> size_t {
+  // hardware_concurrency may return 0 if unknown.
+  return std::max(static_cast<size_t>(1), std::min(static_cast<size_t>(std::thread::hardware_concurrency()), 
+                                                   max_threads));
+}
+
+/************************************************
+ *                BTreeIndex
+ ************************************************/
+BTreeIndex::BTreeIndex(const std::string &name, size_t col, TypeId key_type, const std::vector<Tuple> &tuples,
+                       bool unique)
+  : TableIndex(name, col, key_type, IndexType::BTree, unique) {
+  std::vector<std::pair<DataBox, size_t>> entries;
+  entries.reserve(tuples.size());
+  for (size_t row = 0; row < tuples.size(); ++row) {
+    if (tuples[row].isDeleted()) { continue; }
+    DataBox key = tuples[row].getColumnData(col_);
+    if (!CountOut(key, 1)) { entries.push_back(std::make_pair(std::move(key), row)); }
+  }
+  // rows are ascending already, a stable sort keeps them so for equal keys.
+  std::stable_sort(entries.begin(), entries.end(),
+                   [](const std::pair<DataBox, size_t> &e1, const std::pair<DataBox, size_t> &e2) {
+    return DataBox::LessThan(e1.first, e2.first).getBoolValue();
+  });
+  for (size_t i = 1; unique_ && i < entries.size(); ++i) {
+    if (DataBox::EqualTo(entries[i - 1].first, entries[i].first).getBoolValue()) {
+      throw std::domain_error("duplicate keys in a unique index?? Impossible!");
+    }
+  }
+  tree_.Build(entries);
+}
+
+void BTreeIndex::Insert(const DataBox &key, size_t row) {
+  if (!CountOut(key, 1)) { tree_.Insert(key, row); }
+}
+
+void BTreeIndex::Erase(const DataBox &key, size_t row) {
+  if (!CountOut(key, -1)) { tree_.Erase(key, row); }
+}
+
+void BTreeIndex::Find(const DataBox &key, std::vector<size_t> *rows) const {
+  for (auto iter = tree_.Seek(key, false); !iter.isEnd() && DataBox::EqualTo(iter.getKey(), key).getBoolValue();
+       iter.Next()) {
+    rows->push_back(iter.getRow());
+  }
+}
+
+auto BTreeIndex::Contains(const DataBox &key) const -> bool {
+  auto iter = tree_.Seek(key, false);
+  return !iter.isEnd() && DataBox::EqualTo(iter.getKey(), key).getBoolValue();
+}
+
+auto BTreeIndex::AboveLow(const DataBox &key, const ColumnRange &range) -> bool {
+  if (range.lo_.getType() == TypeId::INVALID) { return true; }
+  if (DataBox::LessThan(key, range.lo_).getBoolValue()) { return false; }
+  return range.lo_inclusive_ || !DataBox::EqualTo(key, range.lo_).getBoolValue();
+}
+
+auto BTreeIndex::BelowHigh(const DataBox &key, const ColumnRange &range) -> bool {
+  if (range.hi_.getType() == TypeId::INVALID) { return true; }
+  if (DataBox::GreaterThan(key, range.hi_).getBoolValue()) { return false; }
+  return range.hi_inclusive_ || !DataBox::EqualTo(key, range.hi_).getBoolValue();
+}
+
+auto BTreeIndex::LowerBound(const ColumnRange &range) const -> BPlusTree::Iterator {
+  if (range.lo_.getType() == TypeId::INVALID) { return tree_.Begin(); }
+  return tree_.Seek(range.lo_, !range.lo_inclusive_);
+}
+
+auto BTreeIndex::UpperBound(const ColumnRange &range, bool *found) const -> BPlusTree::Iterator {
+  BPlusTree::Iterator iter = range.hi_.getType() == TypeId::INVALID ? tree_.End()
+                                                                     : tree_.Seek(range.hi_, range.hi_inclusive_);
+  *found = iter.Prev();
+  return iter;
+}
+
+void BTreeIndex::Lookup(const ColumnRange &range, std::vector<size_t> *rows) const {
+  for (auto iter = LowerBound(range); !iter.isEnd() && BelowHigh(iter.getKey(), range); iter.Next()) {
+    rows->push_back(iter.getRow());
+  }
+}
+
+/************************************************
+ *                HashIndex
+ ************************************************/
+const size_t HashIndex::NO_ROW;
+
+HashIndex::HashIndex(const std::string &name, size_t col, TypeId key_type, const std::vector<Tuple> &tuples,
+                     bool unique)
+  : TableIndex(name, col, key_type, IndexType::Hash, unique), partitions_(1U << HASH_PARTITION_BITS),
+    next_(tuples.size(), NO_ROW) {
+  const size_t num_partitions = partitions_.size();
+  const size_t num_threads = workerThreads(tuples.size() / HASH_BUILD_ROWS + 1);
+
+  // phase 1: each thread hashes a slice of rows into lists by partition.
+  struct Hashed {
+    size_t row_;
+    uint64_t hash_;
+  };
+  std::vector<std::vector<std::vector<Hashed>>> lists(num_threads, std::vector<std::vector<Hashed>>(num_partitions));
+  std::vector<size_t> nulls(num_threads, 0), mismatched(num_threads, 0);
+  const size_t slice = (tuples.size() + num_threads - 1) / num_threads;
+  auto hash_rows = [&](size_t t) {
+    for (size_t row = t * slice; row < std::min(tuples.size(), (t + 1) * slice); ++row) {
+      if (tuples[row].isDeleted()) { continue; }
+      const DataBox key = tuples[row].getColumnData(col_);
+      if (key.getType() == TypeId::INVALID) {
+        ++nulls[t];
+      } else if (key.getType() != key_type_) {
+        ++mismatched[t];
+      } else {
+        const uint64_t hash = DataBox::Hash(key);
+        lists[t][PartitionOf(hash)].push_back({row, hash});
+      }
+    }
+  };
+
+  // phase 2: each thread builds its partitions, reading the lists in order of slices.
+  std::vector<char> duplicate(num_partitions, 0);
+  auto build_partitions = [&](size_t t) {
+    for (size_t p = t; p < num_partitions; p += num_threads) {
+      size_t n = 0;
+      for (size_t i = 0; i < num_threads; ++i) { n += lists[i][p].size(); }
+      Resize(&partitions_[p], n);
+      for (size_t i = 0; i < num_threads; ++i) {
+        for (const auto &hashed : lists[i][p]) {
+          if (!Link(&partitions_[p], tuples[hashed.row_].getColumnData(col_), hashed.hash_, hashed.row_)) {
+            duplicate[p] = 1;
+          }
+        }
+      }
+    }
+  };
+
+  if (num_threads == 1) {
+    hash_rows(0);
+    build_partitions(0);
+  } else {
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; ++t) { threads.emplace_back(hash_rows, t); }
+    for (auto &thread : threads) { thread.join(); }
+    threads.clear();
+    for (size_t t = 0; t < num_threads; ++t) { threads.emplace_back(build_partitions, t); }
+    for (auto &thread : threads) { thread.join(); }
+  }
+
+  for (size_t t = 0; t < num_threads; ++t) {
+    nulls_ += nulls[t];
+    mismatched_ += mismatched[t];
+  }
+  if (std::find(duplicate.begin(), duplicate.end(), 1) != duplicate.end()) {
+    throw std::domain_error("duplicate keys in a unique index?? Impossible!");
+  }
+}
+
+auto HashIndex::FindSlot(const Partition &part, const DataBox &key, uint64_t hash) -> const Slot * {
+  if (part.slots_.empty()) { return nullptr; }
+  const size_t mask = part.slots_.size() - 1;
+  for (size_t i = hash & mask; part.slots_[i].used_; i = (i + 1) & mask) {
+    const Slot &slot = part.slots_[i];
+    if (slot.hash_ == hash && DataBox::Identical(slot.key_, key)) { return &slot; }
+  }
+  return nullptr;
+}
+
+auto HashIndex::ClaimSlot(Partition *part, const DataBox &key, uint64_t hash) -> Slot * {
+  Slot *slot = const_cast<Slot *>(FindSlot(*part, key, hash));
+  if (static_cast<bool>(slot)) { return slot; }
+  if ((part->used_ + 1) * 4 > part->slots_.size() * 3) { Resize(part, part->used_ + 1); }
+  const size_t mask = part->slots_.size() - 1;
+  size_t i = hash & mask;
+  while (part->slots_[i].used_) { i = (i + 1) & mask; }
+  slot = &part->slots_[i];
+  slot->used_ = true;
+  slot->hash_ = hash;
+  slot->key_ = key;
+  ++part->used_;
+  return slot;
+}
+
+void HashIndex::Resize(Partition *part, size_t n) {
+  std::vector<Slot> old;
+  old.swap(part->slots_);
+  // at most half full after resizing.
+  size_t capacity = 16;
+  while (capacity < 2 * n) { capacity *= 2; }
+  part->slots_.resize(capacity);
+  part->used_ = 0;
+  const size_t mask = capacity - 1;
+  for (auto &slot : old) {
+    if (!slot.used_ || slot.head_ == NO_ROW) { continue; }
+    size_t i = slot.hash_ & mask;
+    while (part->slots_[i].used_) { i = (i + 1) & mask; }
+    part->slots_[i] = std::move(slot);
+    ++part->used_;
+  }
+}
+
+auto HashIndex::Link(Partition *part, const DataBox &key, uint64_t hash, size_t row) -> bool {
+  Slot *slot = ClaimSlot(part, key, hash);
+  if (unique_ && slot->head_ != NO_ROW) { return false; }
+  if (row >= next_.size()) { next_.resize(row + 1, NO_ROW); }
+  next_[row] = slot->head_;
+  slot->head_ = row;
+  return true;
+}
+
+void HashIndex::Insert(const DataBox &key, size_t row) {
+  if (CountOut(key, 1)) { return; }
+  const uint64_t hash = DataBox::Hash(key);
+  Link(&partitions_[PartitionOf(hash)], key, hash, row);
+}
+
+void HashIndex::Erase(const DataBox &key, size_t row) {
+  if (CountOut(key, -1)) { return; }
+  const uint64_t hash = DataBox::Hash(key);
+  Slot *slot = const_cast<Slot *>(FindSlot(partitions_[PartitionOf(hash)], key, hash));
+  if (!static_cast<bool>(slot)) { return; }
+  if (slot->head_ == row) {
+    slot->head_ = next_[row];
+    return;
+  }
+  for (size_t prev = slot->head_; prev != NO_ROW; prev = next_[prev]) {
+    if (next_[prev] == row) {
+      next_[prev] = next_[row];
+      return;
+    }
+  }
+}
+
+void HashIndex::Find(const DataBox &key, std::vector<size_t> *rows) const {
+  const uint64_t hash = DataBox::Hash(key);
+  const Slot *slot = FindSlot(partitions_[PartitionOf(hash)], key, hash);
+  if (!static_cast<bool>(slot)) { return; }
+  for (size_t row = slot->head_; row != NO_ROW; row = next_[row]) { rows->push_back(row); }
+}
+
+auto HashIndex::Contains(const DataBox &key) const -> bool {
+  const uint64_t hash = DataBox::Hash(key);
+  const Slot *slot = FindSlot(partitions_[PartitionOf(hash)], key, hash);
+  return static_cast<bool>(slot) && slot->head_ != NO_ROW;
+}
+
+/************************************************
+ *                BitmapIndex
+ ************************************************/
+BitmapIndex::BitmapIndex(const std::string &name, size_t col, TypeId key_type, const std::vector<Tuple> &tuples,
+                         bool unique)
+  : TableIndex(name, col, key_type, IndexType::Bitmap, unique) {
+  if (key_type_ != TypeId::Bool && key_type_ != TypeId::Char) {
+    throw std::domain_error("bitmap index on a column neither bool nor char?? Impossible!");
+  }
+  for (size_t row = 0; row < tuples.size(); ++row) {
+    if (tuples[row].isDeleted()) { continue; }
+    const DataBox key = tuples[row].getColumnData(col_);
+    if (CountOut(key, 1)) { continue; }
+    if (unique_ && Contains(key)) {
+      throw std::domain_error("duplicate keys in a unique index?? Impossible!");
+    }
+    bitmaps_[key].Add(row);
+    known_.Add(row);
+    if (bitmaps_.size() > BITMAP_MAX_VALUES) {
+      throw std::domain_error("too many distinct values for a bitmap index?? Impossible!");
+    }
+  }
+}
+
+void BitmapIndex::Insert(const DataBox &key, size_t row) {
+  if (CountOut(key, 1)) { return; }
+  bitmaps_[key].Add(row);
+  known_.Add(row);
+}
+
+void BitmapIndex::Erase(const DataBox &key, size_t row) {
+  if (CountOut(key, -1)) { return; }
+  auto iter = bitmaps_.find(key);
+  if (iter == bitmaps_.end()) { return; }
+  iter->second.Remove(row);
+  if (iter->second.isEmpty()) { bitmaps_.erase(iter); }
+  known_.Remove(row);
+}
+
+void BitmapIndex::Find(const DataBox &key, std::vector<size_t> *rows) const {
+  const RoaringBitmap *bitmap = getBitmap(key);
+  if (static_cast<bool>(bitmap)) { bitmap->getRows(rows); }
+}
+
+auto BitmapIndex::Contains(const DataBox &key) const -> bool {
+  return static_cast<bool>(getBitmap(key));
+}
+
+auto BitmapIndex::getBitmap(const DataBox &key) const -> const RoaringBitmap * {
+  auto iter = bitmaps_.find(key);
+  return iter == bitmaps_.end() ? nullptr : &iter->second;
+}
+
+/************************************************
+ *                TrigramIndex
+ ************************************************/
+void findTrigrams(const std::string &str, std::vector<Trigram> *grams) {
+  const size_t begin = grams->size();
+  for (size_t i = 0; i + 3 <= str.size(); ++i) {
+    grams->push_back(static_cast<Trigram>(static_cast<unsigned char>(str[i])) << 16
+                   | static_cast<Trigram>(static_cast<unsigned char>(str[i + 1])) << 8
+                   | static_cast<Trigram>(static_cast<unsigned char>(str[i + 2])));
+  }
+  std::sort(grams->begin() + begin, grams->end());
+  grams->erase(std::unique(grams->begin() + begin, grams->end()), grams->end());
+}
+
+void TrigramIndex::Postings::getRows(std::vector<size_t> *rows) const {
+  std::vector<size_t> base;
+  list_.Decode(&base);
+  if (!erased_.empty()) {
+    std::vector<size_t> kept;
+    std::set_difference(base.begin(), base.end(), erased_.begin(), erased_.end(), std::back_inserter(kept));
+    base.swap(kept);
+  }
+  std::merge(base.begin(), base.end(), added_.begin(), added_.end(), std::back_inserter(*rows));
+}
+
+void TrigramIndex::Postings::Compact() {
+  if (added_.size() + erased_.size() <= std::max(TRIGRAM_DELTA_MIN, list_.getSize() / 16)) { return; }
+  std::vector<size_t> rows;
+  getRows(&rows);
+  list_.Encode(rows);
+  std::vector<size_t>().swap(added_);
+  std::vector<size_t>().swap(erased_);
+}
+
+TrigramIndex::TrigramIndex(const std::string &name, size_t col, TypeId key_type, const std::vector<Tuple> &tuples,
+                           bool unique)
+  : TableIndex(name, col, key_type, IndexType::Trigram, unique) {
+  if (key_type_ != TypeId::Char) {
+    throw std::domain_error("trigram index on a column not char?? Impossible!");
+  }
+  if (unique_) {
+    throw std::domain_error("trigram index cannot be unique?? Impossible!");
+  }
+  const size_t num_threads = workerThreads(tuples.size() / TRIGRAM_BUILD_ROWS + 1);
+
+  // phase 1: each thread indexes a slice of rows into its own lists.
+  std::vector<std::unordered_map<Trigram, PostingList>> lists(num_threads);
+  std::vector<size_t> nulls(num_threads, 0), mismatched(num_threads, 0);
+  const size_t slice = (tuples.size() + num_threads - 1) / num_threads;
+  auto index_rows = [&](size_t t) {
+    std::vector<Trigram> grams;
+    for (size_t row = t * slice; row < std::min(tuples.size(), (t + 1) * slice); ++row) {
+      if (tuples[row].isDeleted()) { continue; }
+      const DataBox key = tuples[row].getColumnData(col_);
+      if (key.getType() == TypeId::INVALID) {
+        ++nulls[t];
+      } else if (key.getType() != key_type_) {
+        ++mismatched[t];
+      } else {
+        grams.clear();
+        findTrigrams(key.getStrValue(), &grams);
+        // rows come in order, appending keeps the lists sorted.
+        for (Trigram gram : grams) { lists[t][gram].Append(row); }
+      }
+    }
+  };
+
+  if (num_threads == 1) {
+    index_rows(0);
+    for (auto &entry : lists[0]) { postings_[entry.first].list_ = std::move(entry.second); }
+  } else {
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; ++t) { threads.emplace_back(index_rows, t); }
+    for (auto &thread : threads) { thread.join(); }
+    threads.clear();
+
+    // phase 2: each thread joins the lists of some trigrams in order of slices.
+    std::vector<std::pair<Trigram, PostingList *>> joined;
+    for (const auto &slice_lists : lists) {
+      for (const auto &entry : slice_lists) {
+        if (postings_.count(entry.first) == 0) { joined.push_back({entry.first, &postings_[entry.first].list_}); }
+      }
+    }
+    auto join_lists = [&](size_t t) {
+      for (size_t i = t; i < joined.size(); i += num_threads) {
+        for (const auto &slice_lists : lists) {
+          auto iter = slice_lists.find(joined[i].first);
+          if (iter != slice_lists.end()) { joined[i].second->Extend(iter->second); }
+        }
+      }
+    };
+    for (size_t t = 0; t < num_threads; ++t) { threads.emplace_back(join_lists, t); }
+    for (auto &thread : threads) { thread.join(); }
+  }
+
+  for (size_t t = 0; t < num_threads; ++t) {
+    nulls_ += nulls[t];
+    mismatched_ += mismatched[t];
+  }
+}
+
+void TrigramIndex::Insert(const DataBox &key, size_t row) {
+  if (CountOut(key, 1)) { return; }
+  std::vector<Trigram> grams;
+  findTrigrams(key.getStrValue(), &grams);
+  for (Trigram gram : grams) {
+    Postings &postings = postings_[gram];
+    if (postings.added_.empty() && (postings.list_.isEmpty() || row > postings.list_.getLast())) {
+      postings.list_.Append(row);
+      continue;
+    }
+    auto pos = std::lower_bound(postings.erased_.begin(), postings.erased_.end(), row);
+    if (pos != postings.erased_.end() && *pos == row) {
+      postings.erased_.erase(pos);
+    } else {
+      postings.added_.insert(std::lower_bound(postings.added_.begin(), postings.added_.end(), row), row);
+    }
+    postings.Compact();
+  }
+}
+
+void TrigramIndex::Erase(const DataBox &key, size_t row) {
+  if (CountOut(key, -1)) { return; }
+  std::vector<Trigram> grams;
+  findTrigrams(key.getStrValue(), &grams);
+  for (Trigram gram : grams) {
+    auto iter = postings_.find(gram);
+    if (iter == postings_.end()) { continue; }
+    Postings &postings = iter->second;
+    auto pos = std::lower_bound(postings.added_.begin(), postings.added_.end(), row);
+    if (pos != postings.added_.end() && *pos == row) {
+      postings.added_.erase(pos);
+    } else {
+      postings.erased_.insert(std::lower_bound(postings.erased_.begin(), postings.erased_.end(), row), row);
+    }
+    if (postings.getSize() == 0) {
+      postings_.erase(iter);
+    } else {
+      postings.Compact();
+    }
+  }
+}
+
+void TrigramIndex::Find(const DataBox &key, std::vector<size_t> *rows) const {
+  throw std::domain_error("trigram index cannot find keys?? Impossible!");
+}
+
+auto TrigramIndex::Contains(const DataBox &key) const -> bool {
+  throw std::domain_error("trigram index cannot find keys?? Impossible!");
+}
+
+auto TrigramIndex::getFrequency(Trigram gram) const -> size_t {
+  auto iter = postings_.find(gram);
+  return iter == postings_.end() ? 0 : iter->second.getSize();
+}
+
+void TrigramIndex::Candidates(const std::vector<Trigram> &grams, std::vector<size_t> *rows) const {
+  std::vector<const Postings *> lists;
+  for (Trigram gram : grams) {
+    auto iter = postings_.find(gram);
+    if (iter == postings_.end()) { return; }
+    lists.push_back(&iter->second);
+  }
+  // start from the rarest trigram, the others only filter its rows.
+  std::sort(lists.begin(), lists.end(), [](const Postings *p1, const Postings *p2) -> bool {
+    return p1->getSize() < p2->getSize();
+  });
+  std::vector<size_t> res;
+  lists[0]->getRows(&res);
+  for (size_t i = 1; i < lists.size() && !res.empty(); ++i) {
+    const Postings &postings = *lists[i];
+    std::vector<size_t> kept;
+    if (postings.added_.empty() && postings.erased_.empty()) {
+      // skip through the compressed list without decoding all of it into memory.
+      PostingList::Cursor cursor(&postings.list_);
+      for (size_t row : res) {
+        cursor.SkipTo(row);
+        if (!cursor.isValid()) { break; }
+        if (cursor.getRow() == row) { kept.push_back(row); }
+      }
+    } else {
+      std::vector<size_t> other;
+      postings.getRows(&other);
+      std::set_intersection(res.begin(), res.end(), other.begin(), other.end(), std::back_inserter(kept));
+    }
+    res.swap(kept);
+  }
+  rows->insert(rows->end(), res.begin(), res.end());
+}
+
+/************************************************
+ *                CrackerIndex
+ ************************************************/
+CrackerIndex::CrackerIndex(const std::string &name, size_t col, TypeId key_type, const std::vector<Tuple> &tuples,
+                           bool unique)
+  : TableIndex(name, col, key_type, IndexType::Cracker, unique) {
+  if (key_type_ != TypeId::Float) {
+    throw std::domain_error("cracker index on a column not float?? Impossible!");
+  }
+  if (unique_) {
+    throw std::domain_error("cracker index cannot be unique?? Impossible!");
+  }
+  entries_.reserve(tuples.size());
+  for (size_t row = 0; row < tuples.size(); ++row) {
+    if (tuples[row].isDeleted()) { continue; }
+    const DataBox key = tuples[row].getColumnData(col_);
+    if (CountOut(key, 1)) { continue; }
+    entries_.push_back({key.getFloatValue(), row});
+  }
+}
+
+auto CrackerIndex::Crack(const Cut &cut) const -> size_t {
+  auto iter = cuts_.lower_bound(cut);
+  if (iter != cuts_.end() && iter->first == cut) { return iter->second; }
+  // the piece between the cuts around it.
+  const size_t begin = iter == cuts_.begin() ? 0 : std::prev(iter)->second;
+  const size_t end = iter == cuts_.end() ? entries_.size() : iter->second;
+  auto middle = std::partition(entries_.begin() + begin, entries_.begin() + end, [&cut](const Entry &entry) -> bool {
+    return Before(entry.key_, cut);
+  });
+  const size_t pos = static_cast<size_t>(middle - entries_.begin());
+  cuts_.emplace_hint(iter, cut, pos);
+  return pos;
+}
+
+void CrackerIndex::Insert(const DataBox &key, size_t row) {
+  if (CountOut(key, 1)) { return; }
+  std::lock_guard<std::mutex> guard(latch_);
+  const double value = key.getFloatValue();
+  entries_.push_back({value, row});
+  size_t hole = entries_.size() - 1;
+  // the entry is last of the piece after a cut, swap it with the first of the piece and move the cut past it.
+  for (auto iter = cuts_.rbegin(); iter != cuts_.rend() && Before(value, iter->first); ++iter) {
+    std::swap(entries_[hole], entries_[iter->second]);
+    hole = iter->second++;
+  }
+}
+
+void CrackerIndex::Erase(const DataBox &key, size_t row) {
+  if (CountOut(key, -1)) { return; }
+  std::lock_guard<std::mutex> guard(latch_);
+  const double value = key.getFloatValue();
+  // the first cut the key is before ends its piece.
+  auto iter = cuts_.lower_bound(Cut(value, true));
+  const size_t begin = iter == cuts_.begin() ? 0 : std::prev(iter)->second;
+  const size_t end = iter == cuts_.end() ? entries_.size() : iter->second;
+  size_t hole = begin;
+  while (hole < end && entries_[hole].row_ != row) { ++hole; }
+  if (hole == end) { return; }
+  std::swap(entries_[hole], entries_[end - 1]);
+  hole = end - 1;
+  // the hole is last of the piece before a cut: move the cut before it, swap it with the last of the next piece.
+  for (; iter != cuts_.end(); ++iter) {
+    --iter->second;
+    auto next = std::next(iter);
+    const size_t last = (next == cuts_.end() ? entries_.size() : next->second) - 1;
+    std::swap(entries_[hole], entries_[last]);
+    hole = last;
+  }
+  entries_.pop_back();
+}
+
+void CrackerIndex::Find(const DataBox &key, std::vector<size_t> *rows) const {
+  ColumnRange range;
+  range.col_ = col_;
+  range.lo_ = range.hi_ = key;
+  Lookup(range, rows);
+}
+
+auto CrackerIndex::Contains(const DataBox &key) const -> bool {
+  std::vector<size_t> rows;
+  Find(key, &rows);
+  return !rows.empty();
+}
+
+void CrackerIndex::Lookup(const ColumnRange &range, std::vector<size_t> *rows) const {
+  std::lock_guard<std::mutex> guard(latch_);
+  // keys not below the lower bound come after the cut(lo, false), or (lo, true) if exclusive.
+  const size_t lo = range.lo_.getType() == TypeId::Float ? Crack(Cut(range.lo_.getFloatValue(), !range.lo_inclusive_))
+                                                         : 0;
+  const size_t hi = range.hi_.getType() == TypeId::Float ? Crack(Cut(range.hi_.getFloatValue(), range.hi_inclusive_))
+                                                         : entries_.size();
+  if (lo >= hi) { return; }
+  const size_t first = rows->size();
+  for (size_t i = lo; i < hi; ++i) { rows->push_back(entries_[i].row_); }
+  std::sort(rows->begin() + first, rows->end());
+}
+
+auto CrackerIndex::getNumPieces() const -> size_t {
+  std::lock_guard<std::mutex> guard(latch_);
+  return cuts_.size() + 1;
+}
+
+}  // namespace cql
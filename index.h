@@ -0,0 +1,384 @@
+/*****************************************************
+ * File: index.h
+ * Author: Fudanyrd (email: yangrundong7@gmail.com)
+ *
+ * Secondary indexes on a column of a table, mapping
+ * values of the column to row ids. They are kept up
+ * to date by the table on insert, update and delete.
+ *****************************************************/
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bitmap.h"
+#include "btree.h"
+#include "posting.h"
+#include "tuple.h"
+#include "type.h"
+#include "zone_map.h"
+
+namespace cql {
+
+enum class IndexType {
+  BTree,        // ordered: equality, ranges and order bys.
+  Hash,         // equality only.
+  Bitmap,       // equality, and/or/not of them; Bool and low-cardinality Char columns.
+  Trigram,      // candidates of like/contains/startswith; Char columns.
+  Cracker,      // ranges, reorganized by each lookup; Float columns, added by the planner in cracking mode.
+};
+
+/** Interface of an index on a column. */
+class TableIndex {
+ protected:
+  std::string name_;
+  /** the column indexed. */
+  size_t col_;
+  /** type of the column. */
+  TypeId key_type_;
+  IndexType index_type_;
+  /** no two rows may have the same key(NULLs excepted). */
+  bool unique_;
+  /** number of rows with NULL keys. */
+  size_t nulls_{0U};
+  /** number of rows with keys of another type(comparing them throws). */
+  size_t mismatched_{0U};
+
+  /**
+   * @brief count a key not kept by the index(NULL, or of another type).
+   * @param delta: 1 if a row with the key is inserted, -1 if erased.
+   * @return true if the key is not kept.
+   */
+  auto CountOut(const DataBox &key, int delta) -> bool;
+
+ public:
+  TableIndex(const std::string &name, size_t col, TypeId key_type, IndexType index_type, bool unique):
+    name_(name), col_(col), key_type_(key_type), index_type_(index_type), unique_(unique) {}
+  virtual ~TableIndex() = default;
+
+  auto getName() const -> const std::string & { return name_; }
+  auto getColumn() const -> size_t { return col_; }
+  auto getKeyType() const -> TypeId { return key_type_; }
+  auto getIndexType() const -> IndexType { return index_type_; }
+  auto isUnique() const -> bool { return unique_; }
+
+  /**
+   * @return true if all rows are kept, so that the index covers the whole table.
+   */
+  auto isComplete() const -> bool { return nulls_ == 0 && mismatched_ == 0; }
+
+  /**
+   * @return true if a row has a key of another type; predicates on the column may throw.
+   */
+  auto hasMismatched() const -> bool { return mismatched_ != 0; }
+
+  /** @brief a row with the key is inserted(or updated to it). */
+  virtual void Insert(const DataBox &key, size_t row) = 0;
+
+  /** @brief a row with the key is deleted(or updated from it). */
+  virtual void Erase(const DataBox &key, size_t row) = 0;
+
+  /**
+   * @brief append the rows with the key, in any order.
+   * @param key: of the type of the column.
+   */
+  virtual void Find(const DataBox &key, std::vector<size_t> *rows) const = 0;
+
+  /**
+   * @return true if a row has the key.
+   * @param key: of the type of the column.
+   */
+  virtual auto Contains(const DataBox &key) const -> bool = 0;
+
+  /**
+   * @return false if a row with the key would break the uniqueness of the index.
+   */
+  auto Admits(const DataBox &key) const -> bool {
+    return !unique_ || key.getType() != key_type_ || !Contains(key);
+  }
+};
+
+typedef std::shared_ptr<TableIndex> TableIndexRef;
+
+/**
+ * @brief find the rows with any of the keys; keys of other types than the column never match.
+ * @param rows[out] ascending and distinct.
+ */
+void findKeys(const TableIndex *index, const std::vector<DataBox> &keys, std::vector<size_t> *rows);
+
+/**
+ * @return number of threads to work with in parallel: those of the hardware(1 if unknown), at most max_threads.
+ */
+auto workerThreads(size_t max_threads = static_cast<size_t>(-1)) -> size_t;
+
+/**
+ * B+tree index. Keys not of the type of the column(NULLs, or values
+ * inserted with another type) are only counted, not kept in the tree.
+ */
+class BTreeIndex: public TableIndex {
+ private:
+  BPlusTree tree_;
+
+ public:
+  /**
+   * @brief build the index over rows of a table not deleted.
+   * @throw domain_error if unique but two rows have the same key.
+   */
+  BTreeIndex(const std::string &name, size_t col, TypeId key_type, const std::vector<Tuple> &tuples,
+             bool unique = false);
+
+  void Insert(const DataBox &key, size_t row) override;
+  void Erase(const DataBox &key, size_t row) override;
+  void Find(const DataBox &key, std::vector<size_t> *rows) const override;
+  auto Contains(const DataBox &key) const -> bool override;
+
+  auto getTree() const -> const BPlusTree & { return tree_; }
+
+  /** @return true if key is not below the lower bound of range. */
+  static auto AboveLow(const DataBox &key, const ColumnRange &range) -> bool;
+  /** @return true if key is not above the upper bound of range. */
+  static auto BelowHigh(const DataBox &key, const ColumnRange &range) -> bool;
+
+  /**
+   * @return the first entry whose key is not below the range(it may be above).
+   */
+  auto LowerBound(const ColumnRange &range) const -> BPlusTree::Iterator;
+
+  /**
+   * @return the last entry whose key is not above the range(it may be below).
+   * @param found[out] false if there is no such entry.
+   */
+  auto UpperBound(const ColumnRange &range, bool *found) const -> BPlusTree::Iterator;
+
+  /**
+   * @brief append the rows whose keys are in range, in the order of keys.
+   */
+  void Lookup(const ColumnRange &range, std::vector<size_t> *rows) const;
+};
+
+/** the hash index is split into 2^HASH_PARTITION_BITS partitions by the high bits of hashes. */
+const size_t HASH_PARTITION_BITS = 6;
+/** rows hashed by a thread when building a hash index. */
+const size_t HASH_BUILD_ROWS = 65536;
+
+/**
+ * Hash index. Each partition is an open-addressing table(linear probing)
+ * with a slot per distinct key; rows with the same key are chained. The
+ * partitions are independent, so they are built in parallel.
+ */
+class HashIndex: public TableIndex {
+ private:
+  static const size_t NO_ROW = static_cast<size_t>(-1);
+
+  /** a distinct key; a tombstone if all its rows are erased(reused if the key comes back). */
+  struct Slot {
+    bool used_{false};
+    uint64_t hash_{0U};
+    DataBox key_;
+    /** first row of the chain, NO_ROW if none. */
+    size_t head_{NO_ROW};
+  };
+
+  struct Partition {
+    /** number of slots is a power of 2. */
+    std::vector<Slot> slots_;
+    /** slots used, tombstones included. */
+    size_t used_{0U};
+  };
+
+  std::vector<Partition> partitions_;
+  /** next row of the chain of a row. */
+  std::vector<size_t> next_;
+
+  static auto PartitionOf(uint64_t hash) -> size_t { return static_cast<size_t>(hash >> (64 - HASH_PARTITION_BITS)); }
+
+  /** @return the slot of the key, nullptr if absent. */
+  static auto FindSlot(const Partition &part, const DataBox &key, uint64_t hash) -> const Slot *;
+
+  /** @return the slot of the key, claimed if absent(the partition grows if 3/4 used). */
+  static auto ClaimSlot(Partition *part, const DataBox &key, uint64_t hash) -> Slot *;
+
+  /** @brief resize a partition to hold n keys, dropping tombstones. */
+  static void Resize(Partition *part, size_t n);
+
+  /**
+   * @brief add a row to the chain of its key.
+   * @return false if unique and the key has a row.
+   */
+  auto Link(Partition *part, const DataBox &key, uint64_t hash, size_t row) -> bool;
+
+ public:
+  /**
+   * @brief build the index over rows of a table not deleted, in parallel for large tables.
+   * @throw domain_error if unique but two rows have the same key.
+   */
+  HashIndex(const std::string &name, size_t col, TypeId key_type, const std::vector<Tuple> &tuples,
+            bool unique = false);
+
+  void Insert(const DataBox &key, size_t row) override;
+  void Erase(const DataBox &key, size_t row) override;
+  void Find(const DataBox &key, std::vector<size_t> *rows) const override;
+  auto Contains(const DataBox &key) const -> bool override;
+};
+
+/** a bitmap index is not built over more distinct values than this. */
+const size_t BITMAP_MAX_VALUES = 256;
+
+/**
+ * Bitmap index: a compressed bitmap of rows for each distinct value of a
+ * Bool or Char column, so that predicates over such columns combine by
+ * and/or/and-not of bitmaps before any row is read.
+ */
+class BitmapIndex: public TableIndex {
+ private:
+  std::unordered_map<DataBox, RoaringBitmap, BoxHash, BoxEqual> bitmaps_;
+  /** rows with keys of the type of the column. */
+  RoaringBitmap known_;
+
+ public:
+  /**
+   * @brief build the index over rows of a table not deleted. Values inserted
+   * later may exceed BITMAP_MAX_VALUES.
+   * @throw domain_error if the column is not Bool or Char, it has too many
+   * distinct values, or unique but two rows have the same key.
+   */
+  BitmapIndex(const std::string &name, size_t col, TypeId key_type, const std::vector<Tuple> &tuples,
+              bool unique = false);
+
+  void Insert(const DataBox &key, size_t row) override;
+  void Erase(const DataBox &key, size_t row) override;
+  void Find(const DataBox &key, std::vector<size_t> *rows) const override;
+  auto Contains(const DataBox &key) const -> bool override;
+
+  /**
+   * @return rows with the key(of the type of the column), nullptr if none.
+   */
+  auto getBitmap(const DataBox &key) const -> const RoaringBitmap *;
+
+  /** @return rows whose keys are not NULL. */
+  auto getKnown() const -> const RoaringBitmap & { return known_; }
+};
+
+/** three bytes of a string, the first in the high bits. */
+typedef uint32_t Trigram;
+
+/**
+ * @brief append the distinct trigrams of a string, ascending.
+ */
+void findTrigrams(const std::string &str, std::vector<Trigram> *grams);
+
+/** rows indexed by a thread when building a trigram index. */
+const size_t TRIGRAM_BUILD_ROWS = 65536;
+/** rows added or erased out of order are merged into a posting list when more than this(or 1/16 of it). */
+const size_t TRIGRAM_DELTA_MIN = 64;
+
+/**
+ * Trigram index on a Char column: for each trigram, the rows whose strings
+ * have it. A string contains a needle only if it has all trigrams of the
+ * needle, so intersecting their lists finds candidate rows of like/contains/
+ * startswith, which are then verified. Strings shorter than 3 bytes have no
+ * trigram and are in no list.
+ */
+class TrigramIndex: public TableIndex {
+ private:
+  struct Postings {
+    PostingList list_;
+    /** rows inserted before the last row of list_, ascending; merged into list_ later. */
+    std::vector<size_t> added_;
+    /** rows of list_ erased, ascending. */
+    std::vector<size_t> erased_;
+
+    auto getSize() const -> size_t { return list_.getSize() + added_.size() - erased_.size(); }
+    /** @brief append the rows, ascending. */
+    void getRows(std::vector<size_t> *rows) const;
+    /** @brief merge added_ and erased_ into list_ if they are many. */
+    void Compact();
+  };
+
+  std::unordered_map<Trigram, Postings> postings_;
+
+ public:
+  /**
+   * @brief build the index over rows of a table not deleted, in parallel for large tables.
+   * @throw domain_error if the column is not Char, or unique.
+   */
+  TrigramIndex(const std::string &name, size_t col, TypeId key_type, const std::vector<Tuple> &tuples,
+               bool unique = false);
+
+  void Insert(const DataBox &key, size_t row) override;
+  void Erase(const DataBox &key, size_t row) override;
+
+  /** @throw domain_error: trigrams do not find keys, use Candidates. */
+  void Find(const DataBox &key, std::vector<size_t> *rows) const override;
+  /** @throw domain_error: trigrams do not find keys, use Candidates. */
+  auto Contains(const DataBox &key) const -> bool override;
+
+  /** @return number of rows with the trigram. */
+  auto getFrequency(Trigram gram) const -> size_t;
+
+  /**
+   * @brief find the rows with all the trigrams; a superset of the rows containing
+   * the string they come from.
+   * @param grams: not empty.
+   * @param rows[out] ascending.
+   */
+  void Candidates(const std::vector<Trigram> &grams, std::vector<size_t> *rows) const;
+};
+
+/**
+ * Cracker index(database cracking) on a Float column: a copy of the column
+ * with the rows of its keys, split into pieces by the bounds of lookups so
+ * far. A lookup partitions only the pieces its bounds fall in and remembers
+ * the cuts, so repeated lookups touch ever smaller pieces and converge to
+ * the cost of an index, without building one upfront.
+ */
+class CrackerIndex: public TableIndex {
+ private:
+  /** keys before a cut are below its value(or not above it, if the flag is set). */
+  typedef std::pair<double, bool> Cut;
+  struct Entry {
+    double key_;
+    size_t row_;
+  };
+
+  /** lookups reorganize the copy, they are serialized by latch_. */
+  mutable std::vector<Entry> entries_;
+  /** position of each cut in entries_, the first entry after it. */
+  mutable std::map<Cut, size_t> cuts_;
+  mutable std::mutex latch_;
+
+  static auto Before(double key, const Cut &cut) -> bool { return cut.second ? key <= cut.first : key < cut.first; }
+
+  /** @return position of the cut, partitioning the piece it falls in if not cut yet. */
+  auto Crack(const Cut &cut) const -> size_t;
+
+ public:
+  /**
+   * @brief copy the column over rows of a table not deleted, uncracked.
+   * @throw domain_error if the column is not Float, or unique.
+   */
+  CrackerIndex(const std::string &name, size_t col, TypeId key_type, const std::vector<Tuple> &tuples,
+               bool unique = false);
+
+  /** @brief the row moves into its piece, swapping with one entry of each piece after it. */
+  void Insert(const DataBox &key, size_t row) override;
+  /** @brief the hole left by the row moves to the end, as Insert in reverse. */
+  void Erase(const DataBox &key, size_t row) override;
+  void Find(const DataBox &key, std::vector<size_t> *rows) const override;
+  auto Contains(const DataBox &key) const -> bool override;
+
+  /**
+   * @brief append the rows whose keys are in range, ascending; cracks the copy at the bounds.
+   */
+  void Lookup(const ColumnRange &range, std::vector<size_t> *rows) const;
+
+  /** @return number of pieces the copy is cracked into. */
+  auto getNumPieces() const -> size_t;
+};
+
+}  // namespace cql
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <iostream>
+#include "table.h"
+
+using namespace std;  using namespace cql;
+
+/** @return the rows of the index in the range, as "r1 r2 ...". */
+static auto lookup(const BTreeIndex *index, const ColumnRange &range) -> string {
+  vector<size_t> rows;
+  index->Lookup(range, &rows);
+  string res;
+  for (size_t row : rows) { res += to_string(row) + ' '; }
+  return res;
+}
+
+auto main(int argc, char **argv) -> int {
+  // #k = (i * 7) % 10000 is a permutation. Half of the rows are bulk loaded, the rest inserted(splitting nodes).
+  Table table("k:float,v:float");
+  for (size_t i = 0; i < 10000; ++i) {
+    if (i == 5000) { table.createIndex("idx", 0, IndexType::BTree); }
+    table.insertTuple({DataBox(static_cast<double>((i * 7) % 10000)), DataBox(static_cast<double>(i % 3))});
+  }
+  auto index = dynamic_cast<const BTreeIndex *>(table.findIndex(0, IndexType::BTree));
+  cout << "size = " << index->getTree().getSize() << endl;  // expect 10000.
+
+  ColumnRange range;
+  range.col_ = 0;
+  range.lo_ = range.hi_ = DataBox(14.0);
+  cout << "#k = 14: " << lookup(index, range) << endl;  // expect 2.
+  range.lo_ = DataBox(7.0);
+  range.hi_inclusive_ = false;
+  cout << "7 <= #k < 14: " << lookup(index, range) << endl;  // expect 1 7144 4287 1430 8573 5716 2859.
+
+  // ascending and descending reads visit every key in order.
+  bool ordered = true;
+  size_t count = 0;
+  double prev = -1;
+  for (auto iter = index->getTree().Begin(); !iter.isEnd(); iter.Next(), ++count) {
+    ordered = ordered && iter.getKey().getFloatValue() > prev;
+    prev = iter.getKey().getFloatValue();
+  }
+  cout << "ascending: " << count << (ordered ? " ordered" : " unordered") << endl;  // expect 10000 ordered.
+  count = 0;
+  auto iter = index->getTree().End();
+  while (iter.Prev()) {
+    ++count;
+    ordered = ordered && iter.getKey().getFloatValue() < prev + 1;
+    prev = iter.getKey().getFloatValue();
+  }
+  cout << "descending: " << count << (ordered ? " ordered" : " unordered") << endl;  // expect 10000 ordered.
+
+  // the table keeps the index up to date.
+  table.updateTuple(DataBox(-1.0), 2, 0);
+  table.deleteTuple(1);
+  table.insertTuple({DataBox(8.0), DataBox(0.0)});
+  range.hi_inclusive_ = true;
+  range.lo_ = DataBox(-1.0);
+  range.hi_ = DataBox(14.0);
+  cout << "-1 <= #k <= 14 after update: " << lookup(index, range) << endl;
+  // expect 2 0 7143 4286 1429 8572 5715 2858 7144 10000 4287 1430 8573 5716 2859.
+
+  // hash index over enough rows to be built by several threads; #k = i % 50000 has 3 rows per key.
+  Table hashed("k:float,tag:char");
+  for (size_t i = 0; i < 150000; ++i) {
+    DataBox tag = i % 1000 == 0 ? DataBox(TypeId::INVALID, "") : DataBox(TypeId::Char, "t");
+    hashed.insertTuple({DataBox(static_cast<double>(i % 50000)), tag});
+  }
+  hashed.createIndex("hash", 0, IndexType::Hash);
+  auto hash = hashed.findIndex(0, IndexType::Hash);
+  vector<size_t> rows;
+  findKeys(hash, {DataBox(7.0), DataBox(TypeId::Char, "7"), DataBox(49999.0)}, &rows);
+  cout << "#k in (7, '7', 49999): ";
+  for (size_t row : rows) { cout << row << ' '; }
+  cout << endl;  // expect 7 49999 50007 99999 100007 149999.
+  hashed.createIndex("tag", 1, IndexType::Hash);
+  cout << "complete(#tag) = " << hashed.findIndex(1, IndexType::Hash)->isComplete() << endl;  // expect 0.
+
+  // unique indexes reject duplicate keys, on creation and on updates.
+  try {
+    hashed.createIndex("unique", 0, IndexType::Hash, true);
+    cout << "created a unique index over duplicates" << endl;
+  } catch (std::domain_error &e) {
+    cout << e.what() << endl;  // expect duplicate keys.
+  }
+  hashed.deleteTuple(50007);
+  hashed.deleteTuple(100007);
+  hashed.deleteTuple(100000);
+  hashed.deleteTuple(50000);
+  Table keys("k:float");
+  for (size_t i = 0; i < 100; ++i) { keys.insertTuple({DataBox(static_cast<double>(i))}); }
+  keys.createIndex("unique", 0, IndexType::Hash, true);
+  try {
+    keys.updateTuple(DataBox(3.0), 4, 0);
+    cout << "updated to a duplicate key" << endl;
+  } catch (std::domain_error &e) {
+    cout << e.what() << endl;  // expect duplicate key.
+  }
+  keys.deleteTuple(3);
+  keys.updateTuple(DataBox(3.0), 4, 0);
+  rows.clear();
+  findKeys(keys.findIndex(0, IndexType::Hash), {DataBox(3.0), DataBox(4.0)}, &rows);
+  cout << "#k in (3, 4) after delete and update: " << rows.size() << ' ' << rows[0] << endl;  // expect 1 4.
+  rows.clear();
+  findKeys(hash, {DataBox(7.0), DataBox(0.0)}, &rows);
+  cout << "#k in (0, 7) after delete: " << rows.size() << endl;  // expect 2.
+
+  // bitmap indexes only take bool and low-cardinality char columns.
+  try {
+    hashed.createIndex("bitmap", 0, IndexType::Bitmap);
+    cout << "created a bitmap index on a float column" << endl;
+  } catch (std::domain_error &e) {
+    cout << e.what() << endl;  // expect neither bool nor char.
+  }
+  hashed.createIndex("bitmap", 1, IndexType::Bitmap);
+  auto bitmap = dynamic_cast<const BitmapIndex *>(hashed.findIndex(1, IndexType::Bitmap));
+  cout << "#tag = 't': " << bitmap->getBitmap(DataBox(TypeId::Char, "t"))->getCardinality()
+       << ", not NULL: " << bitmap->getKnown().getCardinality() << endl;  // expect 149848, 149848.
+  hashed.updateTuple(DataBox(TypeId::Char, "u"), 1, 1);
+  hashed.updateTuple(DataBox(TypeId::Char, "u"), 0, 1);
+  hashed.deleteTuple(2);
+  rows.clear();
+  findKeys(bitmap, {DataBox(TypeId::Char, "u")}, &rows);
+  cout << "#tag = 'u' after update: " << rows.size() << ' ' << rows[0] << ' ' << rows[1]
+       << ", not NULL: " << bitmap->getKnown().getCardinality() << endl;  // expect 2 0 1, 149848.
+
+  // trigram index over enough rows to be built by several threads; its candidates are the rows with
+  // all trigrams of the needle, checked against all rows after updates out of order and deletes.
+  Table logs("msg:char");
+  for (size_t i = 0; i < 150000; ++i) { logs.insertTuple({DataBox(TypeId::Char, "r" + to_string(i * 7 % 150000))}); }
+  logs.createIndex("trigram", 0, IndexType::Trigram);
+  auto trigram = dynamic_cast<const TrigramIndex *>(logs.findIndex(0, IndexType::Trigram));
+  auto candidates_ok = [&logs, trigram](const string &needle) -> bool {
+    vector<Trigram> grams, found;
+    findTrigrams(needle, &grams);
+    vector<size_t> expect, candidates;
+    for (size_t row = 0; row < logs.getTuples().size(); ++row) {
+      if (logs.getTuples()[row].isDeleted()) { continue; }
+      found.clear();
+      findTrigrams(logs.getTuples()[row].getColumnData(0).getStrValue(), &found);
+      if (includes(found.begin(), found.end(), grams.begin(), grams.end())) { expect.push_back(row); }
+    }
+    trigram->Candidates(grams, &candidates);
+    return candidates == expect;
+  };
+  cout << "trigram candidates: " << candidates_ok("r1234") << candidates_ok("999") << candidates_ok("r12x")
+       << endl;  // expect 111.
+  for (size_t row = 0; row < 150000; row += 97) { logs.updateTuple(DataBox(TypeId::Char, "x1234"), row, 0); }
+  for (size_t row = 5; row < 150000; row += 1001) { logs.deleteTuple(row); }
+  cout << "after update and delete: " << candidates_ok("1234") << candidates_ok("x12") << candidates_ok("r99")
+       << endl;  // expect 111.
+
+  // cracker index: lookups crack the copy at their bounds; compared with all rows while rows move between pieces.
+  Table cracked("k:float");
+  for (size_t i = 0; i < 20000; ++i) { cracked.insertTuple({DataBox(static_cast<double>(i * 7919 % 20000))}); }
+  cracked.createIndex("cracker", 0, IndexType::Cracker);
+  auto cracker = dynamic_cast<const CrackerIndex *>(cracked.findIndex(0, IndexType::Cracker));
+  auto lookup_ok = [&cracked, cracker](double lo, bool lo_inclusive, double hi, bool hi_inclusive) -> bool {
+    ColumnRange range;
+    range.lo_ = DataBox(lo);
+    range.lo_inclusive_ = lo_inclusive;
+    range.hi_ = DataBox(hi);
+    range.hi_inclusive_ = hi_inclusive;
+    vector<size_t> expect, found;
+    for (size_t row = 0; row < cracked.getTuples().size(); ++row) {
+      if (cracked.getTuples()[row].isDeleted()) { continue; }
+      double key = cracked.getTuples()[row].getColumnData(0).getFloatValue();
+      if ((lo_inclusive ? key >= lo : key > lo) && (hi_inclusive ? key <= hi : key < hi)) { expect.push_back(row); }
+    }
+    cracker->Lookup(range, &found);
+    return found == expect;
+  };
+  bool cracked_ok = true;
+  for (size_t i = 0; i < 200; ++i) {
+    double lo = static_cast<double>(i * 97 % 20000);
+    cracked_ok = cracked_ok && lookup_ok(lo, i % 2 == 0, lo + static_cast<double>(i % 500), i % 3 == 0);
+    if (i % 10 == 0) { cracked.insertTuple({DataBox(lo + 0.5)}); }
+    if (i % 10 == 5) { cracked.updateTuple(DataBox(static_cast<double>(i)), i * 13, 0); }
+    if (i % 10 == 7) { cracked.deleteTuple(i * 31); }
+  }
+  cout << "cracker lookups: " << cracked_ok << ", pieces > 300: " << (cracker->getNumPieces() > 300) << endl;
+  // expect 1, 1.
+
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include <stdexcept>
+#include <utility>
+
+#include "expr_util.h"
+#include "join.h"
+
+namespace cql {
+
+/** Sides of a join the columns of an expression come from. */
+enum JoinSide {
+  NoSide = 0,      // no column at all(eg. a constant).
+  LeftSide = 1,
+  RightSide = 2,
+  BothSides = 3    // columns of both sides, or unknown columns.
+};
+
+/**
+ * @return the side of a column name.
+ */
+static auto sideOfColumn(const std::string &name, const Schema *left, const Schema *right) -> int {
+  const size_t not_found = static_cast<size_t>(-1);
+  try {
+    bool in_left = left->getColumnIdx(name) != not_found;
+    bool in_right = right->getColumnIdx(name) != not_found;
+    if (in_left && !in_right) { return JoinSide::LeftSide; }
+    if (in_right && !in_left) { return JoinSide::RightSide; }
+  } catch (std::domain_error &e) {
+    // ambiguous in one side.
+  }
+  return JoinSide::BothSides;
+}
+
+/**
+ * @return the sides the columns of expr come from.
+ */
+static auto sideOf(const AbstractExprRef &expr, const Schema *left, const Schema *right) -> int {
+  switch (expr->GetExprType()) {
+    case ExprType::Const: case ExprType::Variable: case ExprType::Subquery:
+      return JoinSide::NoSide;
+    case ExprType::Column:
+      return sideOfColumn(dynamic_cast<const ColumnExpr *>(expr.get())->column_name_, left, right);
+    case ExprType::Unary:
+      return sideOf(dynamic_cast<const UnaryExpr *>(expr.get())->child_, left, right);
+    case ExprType::Binary: {
+      auto binary_ptr = dynamic_cast<const BinaryExpr *>(expr.get());
+      return sideOf(binary_ptr->left_child_, left, right) | sideOf(binary_ptr->right_child_, left, right);
+    }
+    case ExprType::Aggregate:
+      break;
+  }
+  return JoinSide::BothSides;
+}
+
+auto JoinCondition::Make(const AbstractExprRef &on, const Schema *left, const Schema *right) -> JoinCondition {
+  JoinCondition cond;
+  std::vector<AbstractExprRef> conjuncts;
+  splitConjuncts(on, conjuncts);
+  for (const auto &expr : conjuncts) {
+    auto binary_ptr = dynamic_cast<const BinaryExpr *>(expr.get());
+    if (static_cast<bool>(binary_ptr) && binary_ptr->optr_type_ == BinaryExprType::EqualTo) {
+      int lhs = sideOf(binary_ptr->left_child_, left, right);
+      int rhs = sideOf(binary_ptr->right_child_, left, right);
+      if (lhs == JoinSide::LeftSide && rhs == JoinSide::RightSide) {
+        cond.left_keys_.push_back(binary_ptr->left_child_);
+        cond.right_keys_.push_back(binary_ptr->right_child_);
+        continue;
+      }
+      if (lhs == JoinSide::RightSide && rhs == JoinSide::LeftSide) {
+        cond.left_keys_.push_back(binary_ptr->right_child_);
+        cond.right_keys_.push_back(binary_ptr->left_child_);
+        continue;
+      }
+    }
+    // not an equality between the two sides, check it on the joined tuple.
+    cond.residual_ = static_cast<bool>(cond.residual_) 
+                   ? std::make_shared<BinaryExpr>(BinaryExpr(BinaryExprType::And, cond.residual_, expr)) 
+                   : expr;
+  }
+  return cond;
+}
+
+auto compareJoinKeys(const DataBox *keys1, const DataBox *keys2, size_t num_keys) -> int {
+  for (size_t i = 0; i < num_keys; ++i) {
+    if (keys1[i].getType() != keys2[i].getType()) {
+      return static_cast<int>(keys1[i].getType()) - static_cast<int>(keys2[i].getType());
+    }
+    if (DataBox::Identical(keys1[i], keys2[i])) { continue; }
+    return DataBox::LessThan(keys1[i], keys2[i]).getBoolValue() ? -1 : 1;
+  }
+  return 0;
+}
+
+auto makeJoinSchema(const Schema *left, const Schema *right) -> Schema {
+  Schema schema(*left);
+  for (const auto &col : right->getColumns()) {
+    schema.AppendCol(col.first, col.second);
+  }
+  return schema;
+}
+
+/************************************************
+ *               JoinHashTable
+ ************************************************/
+const size_t JoinHashTable::EMPTY;
+
+void JoinHashTable::Insert(const DataBox *keys, uint64_t hash, Tuple &&row) {
+  keys_.insert(keys_.end(), keys, keys + num_keys_);
+  hashes_.push_back(hash);
+  rows_.push_back(std::move(row));
+}
+
+void JoinHashTable::Build() {
+  // at most 1 row per bucket on average.
+  size_t size = 16;
+  while (size < rows_.size()) { size <<= 1; }
+  buckets_.assign(size, EMPTY);
+  next_.assign(rows_.size(), EMPTY);
+  // link in reverse, so that a chain lists rows in the order of insertion.
+  for (size_t row = rows_.size(); row > 0; --row) {
+    size_t bucket = hashes_[row - 1] & (size - 1);
+    next_[row - 1] = buckets_[bucket];
+    buckets_[bucket] = row - 1;
+  }
+}
+
+auto JoinHashTable::Scan(size_t row, const DataBox *keys, uint64_t hash) const -> size_t {
+  for (; row != EMPTY; row = next_[row]) {
+    if (hashes_[row] != hash) { continue; }
+    const DataBox *row_keys = keys_.data() + row * num_keys_;
+    size_t i = 0;
+    while (i < num_keys_ && DataBox::Identical(row_keys[i], keys[i])) { ++i; }
+    if (i == num_keys_) { return row; }
+  }
+  return EMPTY;
+}
+
+auto JoinHashTable::getMemorySize() const -> size_t {
+  size_t size = (buckets_.capacity() + next_.capacity()) * sizeof(size_t) + hashes_.capacity() * sizeof(uint64_t);
+  for (const auto &key : keys_) { size += key.getMemorySize(); }
+  for (const auto &row : rows_) { size += row.getMemorySize(); }
+  return size;
+}
+
+}  // namespace cql
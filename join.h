@@ -0,0 +1,120 @@
+/*****************************************************
+ * File: join.h
+ * Author: Fudanyrd (email: yangrundong7@gmail.com)
+ *
+ * Building blocks of join executors:
+ * (1) splitting a join predicate into equal keys of
+ *     both sides and a residual predicate;
+ * (2) a hash table from typed join keys to the rows
+ *     of the build side.
+ *****************************************************/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "expr.h"
+#include "schema.h"
+#include "tuple.h"
+#include "type.h"
+
+namespace cql {
+
+/**
+ * A join predicate split by the sides its columns come from.
+ * left_keys_[i] = right_keys_[i] for every i, and residual_ holds.
+ */
+struct JoinCondition {
+  std::vector<AbstractExprRef> left_keys_;
+  std::vector<AbstractExprRef> right_keys_;
+  /** conjuncts that are not equalities between the two sides, nullptr if none. */
+  AbstractExprRef residual_{nullptr};
+
+  /**
+   * @brief split the conjuncts(joined by and) of a join predicate.
+   * @param left/right: output schema of the two inputs.
+   */
+  static auto Make(const AbstractExprRef &on, const Schema *left, const Schema *right) -> JoinCondition;
+};
+
+/**
+ * @brief total order of join keys: by type, then by value.
+ * @return negative if keys1 < keys2, 0 if equal, positive otherwise.
+ */
+auto compareJoinKeys(const DataBox *keys1, const DataBox *keys2, size_t num_keys) -> int;
+
+/**
+ * @return schema of joined tuples: columns of the left, then the right.
+ */
+auto makeJoinSchema(const Schema *left, const Schema *right) -> Schema;
+
+/**
+ * Chained hash table from join keys to rows of the build side.
+ * Rows are inserted first, then Build() links each row into the chain
+ * of its bucket; chains are indexes into flat arrays, so there is one
+ * allocation per array instead of one per row.
+ */
+class JoinHashTable {
+ private:
+  static const size_t EMPTY = static_cast<size_t>(-1);
+
+  /** number of join keys. */
+  size_t num_keys_;
+  /** head of the chain of each bucket; number of buckets is a power of 2. */
+  std::vector<size_t> buckets_;
+  /** next row in the chain of each row. */
+  std::vector<size_t> next_;
+  /** hash of the keys of each row. */
+  std::vector<uint64_t> hashes_;
+  /** keys of row r are at [r * num_keys_, (r + 1) * num_keys_). */
+  std::vector<DataBox> keys_;
+  std::vector<Tuple> rows_;
+
+ public:
+  explicit JoinHashTable(size_t num_keys): num_keys_(num_keys) {}
+
+  /**
+   * @brief add a row of the build side. Must be called before Build.
+   * @param keys: num_keys_ keys of the row.
+   */
+  void Insert(const DataBox *keys, uint64_t hash, Tuple &&row);
+
+  /**
+   * @brief link all inserted rows into the buckets.
+   */
+  void Build();
+
+  /**
+   * @return the first row matching the keys, EMPTY if none.
+   */
+  auto Find(const DataBox *keys, uint64_t hash) const -> size_t {
+    return Scan(buckets_[hash & (buckets_.size() - 1)], keys, hash);
+  }
+
+  /**
+   * @return the next row after row matching the keys, EMPTY if none.
+   */
+  auto FindNext(size_t row, const DataBox *keys, uint64_t hash) const -> size_t {
+    return Scan(next_[row], keys, hash);
+  }
+
+  /**
+   * @return true if row is not EMPTY.
+   */
+  static auto isValid(size_t row) -> bool { return row != EMPTY; }
+
+  auto getRow(size_t row) const -> const Tuple & { return rows_[row]; }
+
+  auto getNumRows() const -> size_t { return rows_.size(); }
+
+  /**
+   * @return number of bytes of the buckets, keys and rows.
+   */
+  auto getMemorySize() const -> size_t;
+
+ private:
+  /** @return the first row in the chain from row matching the keys. */
+  auto Scan(size_t row, const DataBox *keys, uint64_t hash) const -> size_t;
+};
+
+}  // namespace cql
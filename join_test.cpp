@@ -0,0 +1,40 @@
+#include <iostream>
+#include "aggregation.h"
+#include "expr_util.h"
+#include "join.h"
+
+using namespace std;  using namespace cql;
+
+auto main(int argc, char **argv) -> int {
+  Schema left, right;
+  left.AppendCol(TypeId::Float, "a.id");
+  left.AppendCol(TypeId::Char, "a.name");
+  right.AppendCol(TypeId::Float, "b.uid");
+  right.AppendCol(TypeId::Float, "b.price");
+
+  // keys are found whatever side of '=' they are on; the rest is residual.
+  JoinCondition cond = JoinCondition::Make(toExprRef({"#b.uid", "=", "#id", "and", "#price", ">", "4"}), 
+                                           &left, &right);
+  cout << cond.left_keys_.size() << " key(s): " << cond.left_keys_[0]->toString() << " = " 
+       << cond.right_keys_[0]->toString() << endl;           // expect 1 key(s): id = b.uid
+  cout << "residual: " << cond.residual_->toString() << endl;  // expect the price predicate.
+
+  // duplicate keys are chained in the order of insertion.
+  JoinHashTable table(1);
+  for (int i = 0; i < 100; ++i) {
+    DataBox key(static_cast<double>(i % 10));
+    table.Insert(&key, AggregationHashTable::HashKeys(&key, 1), Tuple(&right, {key, DataBox(static_cast<double>(i))}));
+  }
+  table.Build();
+  DataBox key(3.0);
+  uint64_t hash = AggregationHashTable::HashKeys(&key, 1);
+  cout << "rows of key 3:";  // expect 3 13 23 ... 93
+  for (size_t row = table.Find(&key, hash); JoinHashTable::isValid(row); row = table.FindNext(row, &key, hash)) {
+    cout << ' ' << table.getRow(row).getColumnData(1).getFloatValue();
+  }
+  cout << endl;
+  DataBox missing(TypeId::Char, "3");
+  cout << "'3' matches: " << JoinHashTable::isValid(table.Find(&missing, AggregationHashTable::HashKeys(&missing, 1)))
+       << endl;  // expect 0: keys are typed.
+  return 0;
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "planner.h"
 #include "string_util.h"
 
@@ -12,6 +14,807 @@ auto aggsAsColumns(const std::vector<AbstractExprRef> &refs) -> std::vector<Abst
   return res;
 }
 
+/**
+ * @return true if order bys are the group bys(in any order), so that 
+ * sorting before aggregation also orders the groups.
+ */
+auto orderByGroupBy(const ParserLog &log) -> bool {
+  if (log.order_by_.size() != log.group_by_.size()) { return false; }
+  std::vector<std::string> order_by;
+  std::vector<std::string> group_by;
+  for (size_t i = 0; i < log.order_by_.size(); ++i) {
+    order_by.push_back(log.order_by_[i]->toString());
+    group_by.push_back(log.group_by_[i]->toString());
+  }
+  std::sort(order_by.begin(), order_by.end());
+  std::sort(group_by.begin(), group_by.end());
+  return order_by == group_by;
+}
+
+/**
+ * @return true if the predicate is `<key> in $i` or `<key> not in $i`(or `not <key> in $i`).
+ * @param key[out] the key, idx[out] the subquery, anti[out] true for not in.
+ * @param values[out] the values of the subquery, if not nullptr.
+ */
+auto matchInSubquery(const AbstractExprRef &pred, AbstractExprRef *key, size_t *idx, bool *anti,
+                     std::shared_ptr<SubqueryValues> *values = nullptr) -> bool {
+  AbstractExprRef expr = pred;
+  *anti = false;
+  auto unary_ptr = dynamic_cast<const UnaryExpr *>(expr.get());
+  if (static_cast<bool>(unary_ptr) && unary_ptr->optr_type_ == UnaryExprType::Not) {
+    expr = unary_ptr->child_;
+    *anti = true;
+  }
+  auto binary_ptr = dynamic_cast<const BinaryExpr *>(expr.get());
+  if (!static_cast<bool>(binary_ptr) || 
+      (binary_ptr->optr_type_ != BinaryExprType::in && binary_ptr->optr_type_ != BinaryExprType::NotIn)) {
+    return false;
+  }
+  auto subquery_ptr = dynamic_cast<const SubqueryExpr *>(binary_ptr->right_child_.get());
+  if (!static_cast<bool>(subquery_ptr)) { return false; }
+  if (binary_ptr->optr_type_ == BinaryExprType::NotIn) { *anti = !*anti; }
+  *key = binary_ptr->left_child_;
+  *idx = subquery_ptr->subquery_idx_;
+  if (static_cast<bool>(values)) { *values = subquery_ptr->values_; }
+  return true;
+}
+
+/**
+ * @brief make a scan materialize only the columns of its table a query reads.
+ * @param used: names of the columns the query reads.
+ */
+void pruneScan(const AbstractExecutorRef &exec, const std::vector<std::string> &used) {
+  auto scan_ptr = std::dynamic_pointer_cast<SeqScanExecutor>(exec);
+  if (!static_cast<bool>(scan_ptr) || used.empty()) { return; }
+  const Schema *schema = scan_ptr->GetOutputSchema();
+  std::vector<bool> keep(schema->getNumCols(), false);
+  for (const auto &name : used) {
+    size_t col = schema->getColumnIdx(name);
+    if (col != static_cast<size_t>(-1)) { keep[col] = true; }
+  }
+  std::vector<size_t> cols;
+  for (size_t col = 0; col < keep.size(); ++col) {
+    if (keep[col]) { cols.push_back(col); }
+  }
+  // a joined table may have no column read, keep one so that rows are not empty.
+  if (cols.empty()) { cols.push_back(0); }
+  if (cols.size() < schema->getNumCols()) { scan_ptr->PushColumns(cols); }
+}
+
+/**
+ * @return names of the columns a query reads(not those read by its subqueries).
+ */
+auto usedColumns(const ParserLog &log) -> std::vector<std::string> {
+  std::vector<std::string> used;
+  for (const auto &expr : log.columns_) { findColumns(expr, used); }
+  for (const auto &join : log.joins_) { findColumns(join.on_, used); }
+  for (const auto &expr : log.order_by_) { findColumns(expr, used); }
+  for (const auto &expr : log.group_by_) { findColumns(expr, used); }
+  if (static_cast<bool>(log.where_)) { findColumns(log.where_, used); }
+  if (static_cast<bool>(log.having_)) { findColumns(log.having_, used); }
+  return used;
+}
+
+/** @return rows of a bitmap index with the key. */
+auto bitmapOf(const BitmapIndex *index, const DataBox &key) -> RoaringBitmap {
+  const RoaringBitmap *bitmap = index->getBitmap(key);
+  return static_cast<bool>(bitmap) ? *bitmap : RoaringBitmap();
+}
+
+/**
+ * @brief evaluate a predicate(and, or, not of bool columns and `<column> =(!=) <const>`)
+ * by bitmap indexes: the rows where it is true, and where it is false(rows where it is
+ * NULL are in neither, since NULL operands make and, or and not NULL).
+ * @param truth[out], falsity[out] nullptr to only check if it can be done.
+ * @return false if a part of the predicate has no bitmap index.
+ */
+auto evalBitmaps(const AbstractExprRef &pred, const Table *table, RoaringBitmap *truth, RoaringBitmap *falsity)
+  -> bool {
+  const bool check = !static_cast<bool>(truth);
+  auto bitmap_index = [table](const AbstractExprRef &expr) -> const BitmapIndex * {
+    auto col_ptr = dynamic_cast<const ColumnExpr *>(expr.get());
+    if (!static_cast<bool>(col_ptr)) { return nullptr; }
+    size_t col = table->getSchema()->getColumnIdx(col_ptr->column_name_);
+    if (col == static_cast<size_t>(-1)) { return nullptr; }
+    auto index = dynamic_cast<const BitmapIndex *>(table->findIndex(col, IndexType::Bitmap));
+    // comparing keys of other types throws.
+    return static_cast<bool>(index) && !index->hasMismatched() ? index : nullptr;
+  };
+
+  // a bool column.
+  const BitmapIndex *index = bitmap_index(pred);
+  if (static_cast<bool>(index)) {
+    if (index->getKeyType() != TypeId::Bool) { return false; }
+    if (!check) {
+      *truth = bitmapOf(index, DataBox(true));
+      *falsity = bitmapOf(index, DataBox(false));
+    }
+    return true;
+  }
+
+  auto unary_ptr = dynamic_cast<const UnaryExpr *>(pred.get());
+  if (static_cast<bool>(unary_ptr)) {
+    return unary_ptr->optr_type_ == UnaryExprType::Not && evalBitmaps(unary_ptr->child_, table, falsity, truth);
+  }
+
+  auto binary_ptr = dynamic_cast<const BinaryExpr *>(pred.get());
+  if (!static_cast<bool>(binary_ptr)) { return false; }
+  const BinaryExprType op = binary_ptr->optr_type_;
+  if (op == BinaryExprType::And || op == BinaryExprType::Or) {
+    RoaringBitmap t1, f1, t2, f2;
+    if (!evalBitmaps(binary_ptr->left_child_, table, check ? nullptr : &t1, check ? nullptr : &f1)
+        || !evalBitmaps(binary_ptr->right_child_, table, check ? nullptr : &t2, check ? nullptr : &f2)) {
+      return false;
+    }
+    if (check) { return true; }
+    // rows where both operands are not NULL.
+    const RoaringBitmap known = RoaringBitmap::And(RoaringBitmap::Or(t1, f1), RoaringBitmap::Or(t2, f2));
+    *truth = op == BinaryExprType::And ? RoaringBitmap::And(t1, t2)
+                                       : RoaringBitmap::And(RoaringBitmap::Or(t1, t2), known);
+    *falsity = RoaringBitmap::AndNot(known, *truth);
+    return true;
+  }
+  if (op != BinaryExprType::EqualTo && op != BinaryExprType::NotEqualTo) { return false; }
+  index = bitmap_index(binary_ptr->left_child_);
+  auto const_ptr = dynamic_cast<const ConstExpr *>(binary_ptr->right_child_.get());
+  if (!static_cast<bool>(index)) {
+    index = bitmap_index(binary_ptr->right_child_);
+    const_ptr = dynamic_cast<const ConstExpr *>(binary_ptr->left_child_.get());
+  }
+  if (!static_cast<bool>(index) || !static_cast<bool>(const_ptr) || const_ptr->data_.getType() != index->getKeyType()) {
+    return false;
+  }
+  if (!check) {
+    RoaringBitmap equal = bitmapOf(index, const_ptr->data_);
+    RoaringBitmap other = RoaringBitmap::AndNot(index->getKnown(), equal);
+    *truth = op == BinaryExprType::EqualTo ? equal : other;
+    *falsity = op == BinaryExprType::EqualTo ? other : equal;
+  }
+  return true;
+}
+
+/** How an index finds the rows a where clause may accept. */
+struct IndexProbe {
+  const TableIndex *index_{nullptr};
+  /** keys of an equality. */
+  std::vector<DataBox> keys_;
+  /** values of a subquery, for `<column> in (select ...)`. */
+  std::shared_ptr<SubqueryValues> values_;
+  size_t subquery_idx_{static_cast<size_t>(-1)};
+  /** conjuncts evaluated by bitmap indexes of table_. */
+  std::vector<AbstractExprRef> bitmap_conjuncts_;
+  const Table *table_{nullptr};
+  /** true if the rows found are exactly those the where clause accepts. */
+  bool exact_{false};
+  /** trigrams the strings of the rows must have, of a trigram index. */
+  std::vector<Trigram> grams_;
+  /** a range of a B+tree index, if none of the above. */
+  ColumnRange range_;
+
+  auto isRange() const -> bool {
+    return keys_.empty() && !static_cast<bool>(values_) && bitmap_conjuncts_.empty() && grams_.empty();
+  }
+};
+
+/**
+ * @brief find the trigrams of strings a conjunct `<column> like/contains/startswith <string>` accepts.
+ * @return the column, -1 if the conjunct is not of the form.
+ */
+static auto needleTrigrams(const AbstractExprRef &conjunct, const Schema *schema, std::vector<Trigram> *grams)
+  -> size_t {
+  auto binary_ptr = dynamic_cast<const BinaryExpr *>(conjunct.get());
+  if (!static_cast<bool>(binary_ptr) || !isStringMatch(binary_ptr->optr_type_)) { return static_cast<size_t>(-1); }
+  auto col_ptr = dynamic_cast<const ColumnExpr *>(binary_ptr->left_child_.get());
+  auto const_ptr = dynamic_cast<const ConstExpr *>(binary_ptr->right_child_.get());
+  if (!static_cast<bool>(col_ptr) || !static_cast<bool>(const_ptr) || const_ptr->data_.getType() != TypeId::Char) {
+    return static_cast<size_t>(-1);
+  }
+  const std::string &pattern = const_ptr->data_.getStrValue();
+  if (binary_ptr->optr_type_ != BinaryExprType::Like) {
+    findTrigrams(pattern, grams);
+    return schema->getColumnIdx(col_ptr->column_name_);
+  }
+  // trigrams of the pieces between wildcards.
+  std::string piece;
+  for (size_t i = 0; i <= pattern.size(); ++i) {
+    if (i < pattern.size() && pattern[i] != '%' && pattern[i] != '_') {
+      piece.push_back(pattern[i]);
+      continue;
+    }
+    findTrigrams(piece, grams);
+    piece.clear();
+  }
+  std::sort(grams->begin(), grams->end());
+  grams->erase(std::unique(grams->begin(), grams->end()), grams->end());
+  return schema->getColumnIdx(col_ptr->column_name_);
+}
+
+/**
+ * @brief choose an index finding the rows a predicate may accept: an equality(on a hash
+ * index if any), else `<column> in (select ...)`, else conjuncts over bitmap indexes,
+ * else string matches over a trigram index, else a range of a B+tree index, else a
+ * range of a cracker index.
+ * @return false if no index helps.
+ */
+auto chooseIndex(const Table *table, const AbstractExprRef &predicate, IndexProbe *probe) -> bool {
+  if (table->getIndexes().empty() || !static_cast<bool>(predicate)) { return false; }
+  const Schema *schema = table->getSchema();
+  // the predicate throws on keys of other types, they must not be skipped.
+  auto usable = [table](size_t col, IndexType type) -> const TableIndex * {
+    const TableIndex *index = table->findIndex(col, type);
+    return static_cast<bool>(index) && !index->hasMismatched() ? index : nullptr;
+  };
+  auto point_index = [&usable](size_t col) -> const TableIndex * {
+    const TableIndex *index = usable(col, IndexType::Hash);
+    return static_cast<bool>(index) ? index : usable(col, IndexType::BTree);
+  };
+
+  std::vector<ColumnRange> ranges;
+  findColumnRanges(predicate, schema, &ranges);
+  for (const auto &range : ranges) {
+    // a point: [x, x]; (x, x) and the like accept no key.
+    if (range.lo_.getType() == TypeId::INVALID || range.hi_.getType() == TypeId::INVALID 
+        || !range.lo_inclusive_ || !range.hi_inclusive_ || !DataBox::EqualTo(range.lo_, range.hi_).getBoolValue()) {
+      continue;
+    }
+    probe->index_ = point_index(range.col_);
+    if (static_cast<bool>(probe->index_)) {
+      probe->keys_.push_back(range.lo_);
+      return true;
+    }
+  }
+
+  std::vector<AbstractExprRef> conjuncts;
+  splitConjuncts(predicate, conjuncts);
+  for (const auto &conjunct : conjuncts) {
+    AbstractExprRef key;
+    size_t idx;
+    bool anti;
+    std::shared_ptr<SubqueryValues> values;
+    if (!matchInSubquery(conjunct, &key, &idx, &anti, &values) || anti) { continue; }
+    auto col_ptr = dynamic_cast<const ColumnExpr *>(key.get());
+    size_t col = static_cast<bool>(col_ptr) ? schema->getColumnIdx(col_ptr->column_name_) : static_cast<size_t>(-1);
+    if (col == static_cast<size_t>(-1)) { continue; }
+    probe->index_ = point_index(col);
+    if (static_cast<bool>(probe->index_)) {
+      probe->values_ = values;
+      probe->subquery_idx_ = idx;
+      return true;
+    }
+  }
+
+  for (const auto &conjunct : conjuncts) {
+    if (evalBitmaps(conjunct, table, nullptr, nullptr)) { probe->bitmap_conjuncts_.push_back(conjunct); }
+  }
+  if (!probe->bitmap_conjuncts_.empty()) {
+    probe->table_ = table;
+    probe->exact_ = probe->bitmap_conjuncts_.size() == conjuncts.size();
+    return true;
+  }
+
+  // needles of 3 bytes or more; the trigrams of all of them on a column must be present.
+  for (const auto &conjunct : conjuncts) {
+    std::vector<Trigram> grams;
+    const size_t col = needleTrigrams(conjunct, schema, &grams);
+    const TableIndex *index = col == static_cast<size_t>(-1) ? nullptr : usable(col, IndexType::Trigram);
+    if (grams.empty() || !static_cast<bool>(index) || (!probe->grams_.empty() && index != probe->index_)) {
+      continue;
+    }
+    probe->index_ = index;
+    probe->grams_.insert(probe->grams_.end(), grams.begin(), grams.end());
+  }
+  if (!probe->grams_.empty()) {
+    std::sort(probe->grams_.begin(), probe->grams_.end());
+    probe->grams_.erase(std::unique(probe->grams_.begin(), probe->grams_.end()), probe->grams_.end());
+    return true;
+  }
+
+  for (const auto &range : ranges) {
+    probe->index_ = usable(range.col_, IndexType::BTree);
+    if (static_cast<bool>(probe->index_)) {
+      probe->range_ = range;
+      return true;
+    }
+  }
+  for (const auto &range : ranges) {
+    probe->index_ = usable(range.col_, IndexType::Cracker);
+    if (static_cast<bool>(probe->index_)) {
+      probe->range_ = range;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief find the rows of an index probe.
+ * @param rows[out] ascending.
+ */
+void findProbedRows(const IndexProbe &probe, std::vector<size_t> *rows) {
+  if (probe.isRange() && probe.index_->getIndexType() == IndexType::Cracker) {
+    dynamic_cast<const CrackerIndex *>(probe.index_)->Lookup(probe.range_, rows);
+    return;
+  }
+  if (probe.isRange()) {
+    dynamic_cast<const BTreeIndex *>(probe.index_)->Lookup(probe.range_, rows);
+    std::sort(rows->begin(), rows->end());
+    return;
+  }
+  if (!probe.grams_.empty()) {
+    dynamic_cast<const TrigramIndex *>(probe.index_)->Candidates(probe.grams_, rows);
+    return;
+  }
+  if (!probe.bitmap_conjuncts_.empty()) {
+    RoaringBitmap accepted;
+    for (size_t i = 0; i < probe.bitmap_conjuncts_.size(); ++i) {
+      RoaringBitmap truth, falsity;
+      evalBitmaps(probe.bitmap_conjuncts_[i], probe.table_, &truth, &falsity);
+      accepted = i == 0 ? std::move(truth) : RoaringBitmap::And(accepted, truth);
+    }
+    accepted.getRows(rows);
+    return;
+  }
+  std::vector<DataBox> keys = probe.keys_;
+  if (static_cast<bool>(probe.values_)) {
+    for (const auto &value : probe.values_->getValues().getSet()) { keys.push_back(value); }
+  }
+  findKeys(probe.index_, keys, rows);
+}
+
+/**
+ * @return how an index probe finds rows, for explain.
+ */
+static auto describeProbe(const Table *table, const IndexProbe &probe) -> std::string {
+  std::string res;
+  if (!probe.bitmap_conjuncts_.empty()) {
+    res = "bitmaps of";
+    for (const auto &conjunct : probe.bitmap_conjuncts_) { res += " " + conjunct->toString(); }
+  } else {
+    res = probe.index_->getName() + ": ";
+    const std::string &column = table->getSchema()->getColumn(probe.index_->getColumn()).second;
+    if (!probe.keys_.empty()) {
+      res += column + " = " + DataBox::toString(probe.keys_[0]);
+    } else if (static_cast<bool>(probe.values_)) {
+      res += column + " in $" + std::to_string(probe.subquery_idx_);
+    } else if (!probe.grams_.empty()) {
+      res += column + " has " + std::to_string(probe.grams_.size()) + " trigrams";
+    } else {
+      res += rangeToString(probe.range_, table->getSchema());
+    }
+  }
+  return probe.exact_ ? res + ", exact" : res;
+}
+
+/**
+ * @return false if the statistics of the table say the probe finds so many rows that
+ * a scan is cheaper; true if there are no statistics, or the probe is not of keys or a range.
+ */
+static auto worthProbing(const Table *table, const IndexProbe &probe) -> bool {
+  const TableStats *stats = table->getStats();
+  if (!static_cast<bool>(stats)) { return true; }
+  double selectivity = 0.0;
+  if (probe.isRange()) {
+    selectivity = stats->RangeSelectivity(probe.range_);
+  } else if (!probe.keys_.empty()) {
+    ColumnRange range;
+    range.col_ = probe.index_->getColumn();
+    for (const auto &key : probe.keys_) {
+      range.lo_ = range.hi_ = key;
+      selectivity += stats->RangeSelectivity(range);
+    }
+  }
+  return selectivity <= INDEX_SCAN_MAX_SELECTIVITY;
+}
+
+void Planner::LoadColumns(const ParserLog &log) {
+  std::vector<std::string> tables;
+  if (!log.table_.empty()) { tables.push_back(log.table_); }
+  for (const auto &join : log.joins_) { tables.push_back(join.table_); }
+  const std::vector<std::string> used = usedColumns(log);
+  for (const auto &name : tables) {
+    auto iter = table_mgn_->find(name);
+    if (iter == table_mgn_->end() || iter->second.table_ptr_->isMaterialized()) { continue; }
+    Table *table = iter->second.table_ptr_;
+    if (log.columns_.empty()) {
+      table->Materialize();
+      continue;
+    }
+    // unqualified names of the table match 'other.col' too, parsing a column more is harmless.
+    std::vector<size_t> cols;
+    for (const auto &col_name : used) {
+      size_t col = table->getSchema()->getColumnIdx(col_name);
+      if (col != static_cast<size_t>(-1)) { cols.push_back(col); }
+    }
+    table->Materialize(cols);
+  }
+}
+
+auto Planner::NumRows(const std::string &table) const -> size_t {
+  auto iter = table_mgn_->find(table);
+  return iter == table_mgn_->end() ? 0 : iter->second.table_ptr_->getNumRows();
+}
+
+auto Planner::StatsOf(const std::string &table) const -> const TableStats * {
+  auto iter = table_mgn_->find(table);
+  return iter == table_mgn_->end() ? nullptr : iter->second.table_ptr_->getStats();
+}
+
+auto Planner::EstimateGroups(const ParserLog &log) const -> size_t {
+  if (log.group_by_.empty()) { return 1; }
+  const TableStats *stats = StatsOf(log.table_);
+  if (!log.joins_.empty() || !static_cast<bool>(stats)) { return static_cast<size_t>(-1); }
+  std::vector<size_t> cols = KeyColumns(table_mgn_->find(log.table_)->second.table_ptr_->getSchema(), log.group_by_);
+  if (cols.empty()) { return static_cast<size_t>(-1); }
+  // assume the columns are independent, NULL(and values of other types) being one more group.
+  double groups = 1.0;
+  for (size_t col : cols) {
+    const ColumnStats &column = stats->getColumn(col);
+    groups *= static_cast<double>(column.distinct_ + (column.nulls_ + column.mismatched_ != 0 ? 1 : 0));
+  }
+  return static_cast<size_t>(std::min(groups, static_cast<double>(stats->getRows())));
+}
+
+auto Planner::KeyColumns(const Schema *schema, const std::vector<AbstractExprRef> &keys) const 
+  -> std::vector<size_t> {
+  std::vector<size_t> cols;
+  for (const auto &key : keys) {
+    auto col_ptr = dynamic_cast<const ColumnExpr *>(key.get());
+    if (!static_cast<bool>(col_ptr)) { return {}; }
+    size_t col = schema->getColumnIdx(col_ptr->column_name_);
+    if (col == static_cast<size_t>(-1)) { return {}; }
+    cols.push_back(col);
+  }
+  return cols;
+}
+
+auto Planner::ResolveColumn(const ParserLog &log, const std::string &name, std::string *table) const -> size_t {
+  std::vector<std::string> tables = {log.table_};
+  for (const auto &join : log.joins_) { tables.push_back(join.table_); }
+  // a table joined with itself: its columns cannot be told apart.
+  std::vector<std::string> sorted = tables;
+  std::sort(sorted.begin(), sorted.end());
+  if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) { return static_cast<size_t>(-1); }
+
+  // 'a.x' is column x of table a; 'x' is of the only table with column x.
+  const size_t dot = name.rfind('.');
+  size_t col = static_cast<size_t>(-1);
+  for (const auto &candidate : tables) {
+    auto iter = table_mgn_->find(candidate);
+    if (iter == table_mgn_->end()) { return static_cast<size_t>(-1); }
+    const Schema *schema = iter->second.table_ptr_->getSchema();
+    size_t idx = static_cast<size_t>(-1);
+    if (dot == std::string::npos) {
+      idx = schema->getColumnIdx(name);
+    } else if (dot == candidate.size() && name.compare(0, dot, candidate) == 0) {
+      idx = schema->getColumnIdx(name.substr(dot + 1));
+    }
+    if (idx == static_cast<size_t>(-1)) { continue; }
+    if (col != static_cast<size_t>(-1)) { return static_cast<size_t>(-1); }
+    col = idx;
+    *table = candidate;
+  }
+  return col;
+}
+
+auto Planner::ReadTables(const ParserLog &log, const AbstractExprRef &expr, std::vector<std::string> *tables) const 
+  -> bool {
+  std::vector<std::string> columns;
+  findColumns(expr, columns);
+  tables->clear();
+  for (const auto &name : columns) {
+    std::string table;
+    if (ResolveColumn(log, name, &table) == static_cast<size_t>(-1)) { return false; }
+    if (std::find(tables->begin(), tables->end(), table) == tables->end()) { tables->push_back(table); }
+  }
+  return true;
+}
+
+auto Planner::OwnerTable(const ParserLog &log, const AbstractExprRef &expr) const -> std::string {
+  std::vector<std::string> tables;
+  return ReadTables(log, expr, &tables) && tables.size() == 1 ? tables[0] : "";
+}
+
+auto Planner::FilteredRows(const std::string &table, const std::unordered_map<std::string, AbstractExprRef> &filters) 
+  const -> size_t {
+  size_t rows = NumRows(table);
+  auto filter = filters.find(table);
+  const TableStats *stats = StatsOf(table);
+  if (filter != filters.end() && static_cast<bool>(stats)) {
+    rows = static_cast<size_t>(static_cast<double>(rows) * stats->Selectivity(filter->second));
+  }
+  return rows;
+}
+
+auto Planner::EstimateJoinRows(const ParserLog &log, const std::vector<AbstractExprRef> &conjuncts, size_t left_rows,
+                               size_t right_rows) const -> size_t {
+  // distinct values of a column, 0 if unknown.
+  auto distinct = [this, &log](const AbstractExprRef &expr, std::string *table) -> size_t {
+    auto col_ptr = dynamic_cast<const ColumnExpr *>(expr.get());
+    size_t col = static_cast<bool>(col_ptr) ? ResolveColumn(log, col_ptr->column_name_, table) 
+                                            : static_cast<size_t>(-1);
+    const TableStats *stats = col == static_cast<size_t>(-1) ? nullptr : StatsOf(*table);
+    return static_cast<bool>(stats) ? stats->getColumn(col).distinct_ : 0;
+  };
+  for (const auto &conjunct : conjuncts) {
+    auto binary_ptr = dynamic_cast<const BinaryExpr *>(conjunct.get());
+    if (!static_cast<bool>(binary_ptr) || binary_ptr->optr_type_ != BinaryExprType::EqualTo) { continue; }
+    std::string left_table, right_table;
+    const size_t keys = std::max(distinct(binary_ptr->left_child_, &left_table), 
+                                 distinct(binary_ptr->right_child_, &right_table));
+    if (keys != 0 && left_table != right_table) {
+      return static_cast<size_t>(static_cast<double>(left_rows) * static_cast<double>(right_rows) 
+                                 / static_cast<double>(keys));
+    }
+  }
+  return std::max(left_rows, right_rows);
+}
+
+auto Planner::OrderJoins(const ParserLog &log, const std::unordered_map<std::string, AbstractExprRef> &filters,
+                         std::string *first) const -> std::vector<JoinClause> {
+  *first = log.table_;
+  // without a select list, the columns of the query are those of the joined tables, in order.
+  if (log.joins_.size() < 2 || log.columns_.empty()) { return log.joins_; }
+
+  // the join conjuncts, pooled, and the tables each reads.
+  std::vector<AbstractExprRef> conjuncts;
+  for (const auto &join : log.joins_) { splitConjuncts(join.on_, conjuncts); }
+  std::vector<std::vector<std::string>> reads(conjuncts.size());
+  for (size_t i = 0; i < conjuncts.size(); ++i) {
+    if (!ReadTables(log, conjuncts[i], &reads[i]) || reads[i].empty()) { return log.joins_; }
+  }
+  std::vector<std::string> tables = {log.table_};
+  for (const auto &join : log.joins_) { tables.push_back(join.table_); }
+  std::vector<size_t> rows;
+  for (const auto &table : tables) { rows.push_back(FilteredRows(table, filters)); }
+
+  // greedy left-deep: start from the smallest table, then join the table giving the smallest result.
+  std::vector<bool> joined(tables.size(), false), used(conjuncts.size(), false);
+  size_t start = std::min_element(rows.begin(), rows.end()) - rows.begin();
+  joined[start] = true;
+  *first = tables[start];
+  size_t estimate = rows[start];
+  std::vector<JoinClause> order;
+  while (order.size() + 1 < tables.size()) {
+    size_t best = tables.size(), best_estimate = 0;
+    for (size_t t = 0; t < tables.size(); ++t) {
+      if (joined[t]) { continue; }
+      // joined only on conjuncts reading the table and one joined before.
+      std::vector<AbstractExprRef> on;
+      for (size_t i = 0; i < conjuncts.size(); ++i) {
+        bool reads_t = false, reads_joined = false, covered = true;
+        for (const auto &table : reads[i]) {
+          size_t idx = std::find(tables.begin(), tables.end(), table) - tables.begin();
+          reads_t = reads_t || idx == t;
+          reads_joined = reads_joined || joined[idx];
+          covered = covered && (idx == t || joined[idx]);
+        }
+        if (!used[i] && reads_t && reads_joined && covered) { on.push_back(conjuncts[i]); }
+      }
+      if (on.empty()) { continue; }
+      const size_t join_estimate = EstimateJoinRows(log, on, estimate, rows[t]);
+      if (best == tables.size() || join_estimate < best_estimate) {
+        best = t;
+        best_estimate = join_estimate;
+      }
+    }
+    // a table not joined on the others: keep the order of the query.
+    if (best == tables.size()) {
+      *first = log.table_;
+      return log.joins_;
+    }
+
+    JoinClause join;
+    join.table_ = tables[best];
+    joined[best] = true;
+    for (size_t i = 0; i < conjuncts.size(); ++i) {
+      bool covered = true;
+      for (const auto &table : reads[i]) {
+        covered = covered && joined[std::find(tables.begin(), tables.end(), table) - tables.begin()];
+      }
+      if (used[i] || !covered) { continue; }
+      used[i] = true;
+      join.on_ = conjoinFilter(join.on_, conjuncts[i]);
+    }
+    order.push_back(join);
+    estimate = best_estimate;
+  }
+  return order;
+}
+
+auto Planner::PlanJoin(const ParserLog &log, const JoinClause &join, const std::string &left_name, 
+                       AbstractExecutorRef left, size_t *left_rows, const std::vector<std::string> &used, 
+                       const std::unordered_map<std::string, AbstractExprRef> &filters, 
+                       AbstractExprRef *above) const -> AbstractExecutorRef {
+  AbstractExecutorRef right = std::make_shared<SeqScanExecutor>(SeqScanExecutor(join.table_, table_mgn_, true));
+  const Table *right_table = table_mgn_->find(join.table_)->second.table_ptr_;
+  auto right_filter = filters.find(join.table_);
+  if (right_filter != filters.end()) {
+    std::dynamic_pointer_cast<SeqScanExecutor>(right)->PushPredicate(right_filter->second, var_mgn_);
+  }
+  const size_t right_rows = FilteredRows(join.table_, filters);
+  const Table *left_table = left_name.empty() ? nullptr : table_mgn_->find(left_name)->second.table_ptr_;
+  JoinCondition cond = JoinCondition::Make(join.on_, left->GetOutputSchema(), right->GetOutputSchema());
+  std::vector<size_t> left_cols = KeyColumns(left->GetOutputSchema(), cond.left_keys_);
+  std::vector<size_t> right_cols = KeyColumns(right->GetOutputSchema(), cond.right_keys_);
+  // key columns above are columns of the tables, prune only after finding them.
+  if (static_cast<bool>(left_table)) { pruneScan(left, used); }
+  pruneScan(right, used);
+  const size_t left_estimate = *left_rows;
+  std::vector<AbstractExprRef> conjuncts;
+  splitConjuncts(join.on_, conjuncts);
+  *left_rows = EstimateJoinRows(log, conjuncts, left_estimate, right_rows);
+
+  if (cond.left_keys_.empty()) {
+    // no equal keys, let the hash join report it.
+    return std::make_shared<HashJoinExecutor>(HashJoinExecutor(left, right, join.on_, var_mgn_));
+  }
+
+  // a few lookups into a large table sorted(binary searches) or indexed(probes) on the key. The table is read
+  // directly, the filter of its scan goes above the joins.
+  auto lookup = [](const Table *table, size_t col) -> bool {
+    return table->isClusteredOn({col}) || static_cast<bool>(IndexNestedLoopJoinExecutor::LookupIndex(table, col));
+  };
+  if (!right_cols.empty() && left_estimate * INDEX_JOIN_MIN_RATIO <= NumRows(join.table_) 
+      && lookup(right_table, right_cols[0])) {
+    if (right_filter != filters.end()) { *above = conjoinFilter(*above, right_filter->second); }
+    return std::make_shared<IndexNestedLoopJoinExecutor>(
+      IndexNestedLoopJoinExecutor(left, join.table_, table_mgn_, join.on_, var_mgn_, false));
+  }
+  if (static_cast<bool>(left_table) && !left_cols.empty() && right_rows * INDEX_JOIN_MIN_RATIO <= NumRows(left_name)
+      && lookup(left_table, left_cols[0])) {
+    auto left_filter = filters.find(left_name);
+    if (left_filter != filters.end()) { *above = conjoinFilter(*above, left_filter->second); }
+    return std::make_shared<IndexNestedLoopJoinExecutor>(
+      IndexNestedLoopJoinExecutor(right, left_name, table_mgn_, join.on_, var_mgn_, true));
+  }
+
+  // merge inputs already sorted on the keys, or too large to hash.
+  bool left_sorted = static_cast<bool>(left_table) && !left_cols.empty() && left_table->isSortedOn(left_cols);
+  bool right_sorted = !right_cols.empty() && right_table->isSortedOn(right_cols);
+  if ((left_sorted && right_sorted) || std::min(left_estimate, right_rows) >= MERGE_JOIN_MIN_ROWS) {
+    return std::make_shared<SortMergeJoinExecutor>(
+      SortMergeJoinExecutor(left, right, join.on_, var_mgn_, left_sorted, right_sorted));
+  }
+
+  // build the hash table on the smaller input.
+  bool build_left = static_cast<bool>(left_table) && left_estimate < right_rows;
+  return std::make_shared<HashJoinExecutor>(HashJoinExecutor(left, right, join.on_, var_mgn_, build_left));
+}
+
+void Planner::AddCrackers(const ParserLog &log) const {
+  if (!cracking_ || log.table_.empty() || !static_cast<bool>(log.where_)) { return; }
+  auto iter = table_mgn_->find(log.table_);
+  if (iter == table_mgn_->end()) { return; }
+  Table *table = iter->second.table_ptr_;
+  const Schema *schema = table->getSchema();
+  std::vector<ColumnRange> ranges;
+  findColumnRanges(log.where_, schema, &ranges);
+  for (const auto &range : ranges) {
+    const size_t col = range.col_;
+    if (schema->getColumn(col).first != TypeId::Float || static_cast<bool>(table->findIndex(col, IndexType::BTree))
+        || static_cast<bool>(table->findIndex(col, IndexType::Cracker))) {
+      continue;
+    }
+    // users cannot name an index so.
+    table->createIndex("cracker(#" + schema->getColumn(col).second + ")", col, IndexType::Cracker);
+  }
+}
+
+auto Planner::PlanIndexScan(const ParserLog &log, bool is_agg, bool *sorted, size_t *probed_subquery,
+                            bool *filtered) const -> AbstractExecutorRef {
+  *sorted = false;
+  *probed_subquery = static_cast<size_t>(-1);
+  *filtered = false;
+  if (log.table_.empty() || !log.joins_.empty()) { return nullptr; }
+  AddCrackers(log);
+  auto iter = table_mgn_->find(log.table_);
+  if (iter == table_mgn_->end() || iter->second.table_ptr_->getIndexes().empty()) { return nullptr; }
+  const Table *table = iter->second.table_ptr_;
+
+  // lookups of keys find few rows, sorting them is cheap.
+  IndexProbe probe;
+  const bool probed = chooseIndex(table, log.where_, &probe) && worthProbing(table, probe);
+  if (probed && !probe.isRange()) {
+    *probed_subquery = probe.subquery_idx_;
+    *filtered = probe.exact_;
+    return std::make_shared<IndexScanExecutor>(IndexScanExecutor(log.table_, table_mgn_, 
+      [probe](std::vector<size_t> *rows) { findProbedRows(probe, rows); }, describeProbe(table, probe)));
+  }
+
+  // order by an indexed column: read the index in order instead of sorting.
+  if (!is_agg && log.order_by_.size() == 1) {
+    auto col_ptr = dynamic_cast<const ColumnExpr *>(log.order_by_[0].get());
+    size_t col = static_cast<bool>(col_ptr) ? table->getSchema()->getColumnIdx(col_ptr->column_name_) 
+                                            : static_cast<size_t>(-1);
+    const BTreeIndex *index = nullptr;
+    if (col != static_cast<size_t>(-1)) {
+      index = dynamic_cast<const BTreeIndex *>(table->findIndex(col, IndexType::BTree));
+    }
+    // rows with NULL keys are not in the tree.
+    if (static_cast<bool>(index) && index->isComplete()) {
+      ColumnRange range;
+      range.col_ = col;
+      if (static_cast<bool>(log.where_)) {
+        std::vector<ColumnRange> ranges;
+        findColumnRanges(log.where_, table->getSchema(), &ranges);
+        for (const auto &candidate : ranges) {
+          if (candidate.col_ == col) { range = candidate; }
+        }
+      }
+      *sorted = true;
+      return std::make_shared<IndexScanExecutor>(IndexScanExecutor(log.table_, table_mgn_, index, range, 
+                                                                   log.order_by_type_[0] == OrderByType::DESC));
+    }
+  }
+
+  if (!probed) { return nullptr; }
+  return std::make_shared<IndexScanExecutor>(IndexScanExecutor(log.table_, table_mgn_, 
+    [probe](std::vector<size_t> *rows) { findProbedRows(probe, rows); }, describeProbe(table, probe)));
+}
+
+auto Planner::IndexedRows(const ParserLog &log, std::vector<size_t> *rows) const -> bool {
+  AddCrackers(log);
+  auto iter = table_mgn_->find(log.table_);
+  if (iter == table_mgn_->end()) { return false; }
+  IndexProbe probe;
+  if (!chooseIndex(iter->second.table_ptr_, log.where_, &probe) || !worthProbing(iter->second.table_ptr_, probe)) {
+    return false;
+  }
+  findProbedRows(probe, rows);
+  return true;
+}
+
+auto Planner::ClusteredOnGroupBy(const ParserLog &log) const -> bool {
+  // joined tuples are not in the order of the table.
+  if (!log.joins_.empty()) { return false; }
+  auto iter = table_mgn_->find(log.table_);
+  if (iter == table_mgn_->end()) { return false; }
+  const Schema *schema = iter->second.table_ptr_->getSchema();
+  std::vector<size_t> cols;
+  for (const auto &expr : log.group_by_) {
+    auto col_ptr = dynamic_cast<const ColumnExpr *>(expr.get());
+    if (!static_cast<bool>(col_ptr)) { return false; }
+    size_t col = 0;
+    while (col < schema->getNumCols() && schema->getColumn(col).second != col_ptr->column_name_) { ++col; }
+    if (col == schema->getNumCols()) { return false; }
+    cols.push_back(col);
+  }
+  return iter->second.table_ptr_->isClusteredOn(cols);
+}
+
+auto Planner::AggThreads(const std::string &table) const -> size_t {
+  return NumRows(table) < PARALLEL_AGG_MIN_ROWS ? 1 : workerThreads();
+}
+
+auto Planner::ScanThreads(const std::string &table) const -> size_t {
+  return NumRows(table) < PARALLEL_SCAN_MIN_ROWS ? 1 : workerThreads();
+}
+
+auto Planner::PlanSubqueries(const ParserLog &log) -> std::unordered_map<size_t, AbstractExecutorRef> {
+  std::vector<std::shared_ptr<SubqueryExpr>> subqueries;
+  for (const auto &expr : log.columns_) { findSubqueries(expr, subqueries); }
+  for (const auto &join : log.joins_) { findSubqueries(join.on_, subqueries); }
+  for (const auto &expr : log.order_by_) { findSubqueries(expr, subqueries); }
+  for (const auto &expr : log.group_by_) { findSubqueries(expr, subqueries); }
+  if (static_cast<bool>(log.where_)) { findSubqueries(log.where_, subqueries); }
+  if (static_cast<bool>(log.having_)) { findSubqueries(log.having_, subqueries); }
+
+  std::unordered_map<size_t, AbstractExecutorRef> execs;
+  for (const auto &subquery : subqueries) {
+    cqlAssert(subquery->subquery_idx_ < log.subqueries_.size(), "subquery index out of range");
+    AbstractExecutorRef exec = GetExecutors(*log.subqueries_[subquery->subquery_idx_]);
+    subquery->values_->setLoader([exec](ValueSet *values) {
+      exec->Init();
+      const Tuple *tuple;
+      while (exec->NextRef(&tuple)) {
+        values->Insert(tuple->getColumnData(0));
+      }
+    });
+    execs[subquery->subquery_idx_] = exec;
+  }
+  return execs;
+}
+
 auto Planner::GetExecutors(const ParserLog &log) -> AbstractExecutorRef {
   /** Planner should manage a schema for projection executor. */
   static const std::string col_name = "<expr>";
@@ -22,32 +825,221 @@ auto Planner::GetExecutors(const ParserLog &log) -> AbstractExecutorRef {
     projection_schema.AppendCol(TypeId::INVALID, col_name);
   }
 
-  AbstractExecutorRef res = nullptr;
-  /** Sequential scan executor */
-  if (!log.table_.empty()) {
-    res = std::make_shared<SeqScanExecutor>(SeqScanExecutor(log.table_, table_mgn_));
+  /** Parse the columns read from lazily loaded tables, before looking at their data. */
+  LoadColumns(log);
+
+  /** Aggregation, decided first: a parallel scan has to know if the order of tuples matters. */
+  bool is_agg = !log.group_by_.empty();
+  for (const auto &expr : log.columns_) {
+    // aggregating needs a table.
+    if (isAggExpr(expr) && !log.table_.empty()) { is_agg = true; }
   }
+  bool ordered_by_agg = false;   // groups already come out in the order of order bys.
+  /** Top-K query: select topk(<expr>, k) from ... yields rows (value, #count, #error). */
+  bool is_topk = false;
+  if (is_agg && log.group_by_.empty() && !static_cast<bool>(log.having_) && log.columns_.size() == 1) {
+    auto agg_ptr = dynamic_cast<const AggregateExpr *>(log.columns_[0].get());
+    is_topk = static_cast<bool>(agg_ptr) && agg_ptr->agg_type_ == AggregateType::TopK;
+  }
+  // streaming aggregation over groups clustered in the table.
+  const bool clustered_agg = is_agg && !is_topk && !log.group_by_.empty() && !orderByGroupBy(log) 
+                          && ClusteredOnGroupBy(log);
+
+  /** Subqueries that are not semi joins are probed by expressions, the others run under their semi joins. */
+  const std::unordered_map<size_t, AbstractExecutorRef> subquery_execs = PlanSubqueries(log);
 
-  /** Filter executor */
+  /**
+   * Where clause: a filter pushed into the scan of each table(conjuncts reading only that table; all of
+   * them without joins), a filter above the joins for the rest, and a semi join for each
+   * `<key> in (select ...)` conjunct.
+   */
+  std::unordered_map<std::string, AbstractExprRef> table_filters;
+  AbstractExprRef join_filter = nullptr;
+  std::vector<AbstractExprRef> semi_keys;
+  std::vector<size_t> semi_subqueries;
+  std::vector<bool> semi_anti;
   if (static_cast<bool>(log.where_)) {
-    res = std::make_shared<FilterExecutor>(FilterExecutor(log.where_, res, var_mgn_));
+    std::vector<AbstractExprRef> conjuncts;
+    splitConjuncts(log.where_, conjuncts);
+    std::unordered_map<std::string, std::vector<std::pair<double, AbstractExprRef>>> filters;
+    for (const auto &conjunct : conjuncts) {
+      AbstractExprRef key;
+      size_t idx;
+      bool anti;
+      if (!log.table_.empty() && matchInSubquery(conjunct, &key, &idx, &anti)) {
+        semi_keys.push_back(key);
+        semi_subqueries.push_back(idx);
+        semi_anti.push_back(anti);
+        continue;
+      }
+      const std::string table = log.joins_.empty() ? log.table_ : OwnerTable(log, conjunct);
+      if (table.empty()) {
+        join_filter = conjoinFilter(join_filter, conjunct);
+        continue;
+      }
+      const TableStats *table_stats = StatsOf(table);
+      filters[table].push_back({static_cast<bool>(table_stats) ? table_stats->Selectivity(conjunct) : 0.0, 
+                                conjunct});
+    }
+    // a filter stops at the first conjunct rejecting a row: check the most selective first.
+    for (auto &entry : filters) {
+      std::stable_sort(entry.second.begin(), entry.second.end(), 
+                       [](const std::pair<double, AbstractExprRef> &f1, const std::pair<double, AbstractExprRef> &f2) {
+                         return f1.first < f2.first;
+                       });
+      for (const auto &conjunct : entry.second) {
+        table_filters[entry.first] = conjoinFilter(table_filters[entry.first], conjunct.second);
+      }
+    }
+  }
+  auto filter_iter = table_filters.find(log.table_);
+  const AbstractExprRef filter = filter_iter == table_filters.end() ? nullptr : filter_iter->second;
+  /** Estimated number of rows(joined, if any) the where clause accepts. */
+  const TableStats *stats = StatsOf(log.table_);
+  size_t est_rows = log.table_.empty() ? 0 : NumRows(log.table_);
+  if (static_cast<bool>(stats)) {
+    est_rows = static_cast<size_t>(static_cast<double>(est_rows) 
+                                   * stats->Selectivity(log.joins_.empty() ? log.where_ : filter));
+  }
+
+  AbstractExecutorRef res = nullptr;
+  /** Index scan, if an index narrows the where clause or orders the rows. */
+  bool sorted_by_index = false;
+  size_t probed_subquery;
+  bool filtered_by_index;
+  AbstractExecutorRef index_scan = PlanIndexScan(log, is_agg, &sorted_by_index, &probed_subquery, 
+                                                 &filtered_by_index);
+  // workers evaluate the filter and projections on their threads while the destination appends to variables
+  // on this one: the variable manager is not thread safe, keep such scans serial.
+  std::vector<std::string> variables;
+  if (static_cast<bool>(filter)) { findVariables(filter, variables); }
+  for (const auto &expr : log.columns_) { findVariables(expr, variables); }
+  const size_t scan_threads = log.table_.empty() || !log.joins_.empty() || static_cast<bool>(index_scan) 
+                              || !log.destination_.empty() || !variables.empty()
+                            ? 1 : ScanThreads(log.table_);
+  // workers can project too, if nothing in between needs the columns of the table.
+  const bool project_in_workers = !is_agg && log.order_by_.empty() && semi_keys.empty() && !log.columns_.empty();
+
+  /** Columns the query reads: scans materialize only these if rows are copied above(pointing to rows is free). */
+  const std::vector<std::string> used = usedColumns(log);
+  // order bys are the group bys: sort the rows and aggregate the sorted groups as a stream, if the table is
+  // clustered on them(cheap to sort), or the statistics say there are too many groups to hash the rows and sort
+  // the groups instead. Without statistics, the rows are hashed.
+  const size_t est_groups = is_agg ? EstimateGroups(log) : static_cast<size_t>(-1);
+  const bool sort_then_stream = is_agg && !is_topk && !log.group_by_.empty() && orderByGroupBy(log)
+                             && (ClusteredOnGroupBy(log) || (est_groups != static_cast<size_t>(-1)
+                                                             && est_groups * SORT_GROUPS_MIN_RATIO > est_rows));
+  // columns of joined tables are copied into joined rows.
+  bool prune = !log.columns_.empty() && !log.joins_.empty();
+  if (!log.columns_.empty() && log.joins_.empty() && !log.table_.empty()) {
+    // rows are copied by the gather, sort and parallel aggregation.
+    prune = (scan_threads > 1 && !project_in_workers) || (!is_agg && !log.order_by_.empty())
+         || (is_agg && !is_topk && (sort_then_stream || (!clustered_agg && AggThreads(log.table_) > 1)));
+  }
+
+  if (scan_threads > 1) {
+    /** Morsel-driven parallel scan: each worker runs scan(with the filter pushed down)(-> projection). */
+    const Schema *schema_ptr = &projection_schema;
+    VariableManager *var_mgn = var_mgn_;
+    const std::vector<AbstractExprRef> &columns = log.columns_;
+    auto make_pipeline = [filter, project_in_workers, prune, schema_ptr, var_mgn, &columns, &used]
+                         (AbstractExecutorRef scan) {
+      AbstractExecutorRef pipeline = scan;
+      if (static_cast<bool>(filter)) {
+        std::dynamic_pointer_cast<SeqScanExecutor>(scan)->PushPredicate(filter, var_mgn);
+      }
+      if (prune) { pruneScan(scan, used); }
+      if (project_in_workers) {
+        pipeline = std::make_shared<ProjectionExecutor>(ProjectionExecutor(schema_ptr, var_mgn, columns, pipeline));
+      }
+      return pipeline;
+    };
+    // keep the order of the table, unless it is sorted or hashed above.
+    const bool keep_order = clustered_agg || (!is_agg && log.order_by_.empty());
+    res = std::make_shared<GatherExecutor>(GatherExecutor(log.table_, table_mgn_, scan_threads, keep_order, 
+                                                          make_pipeline));
+  } else if (static_cast<bool>(index_scan)) {
+    /** Index scan executor, the filter checks the rest of the where clause. */
+    res = index_scan;
+    if (static_cast<bool>(filter) && !filtered_by_index) {
+      res = std::make_shared<FilterExecutor>(FilterExecutor(filter, res, var_mgn_));
+    }
+  } else if (!log.table_.empty()) {
+    /** Sequential scan executor */
+    // columns of joined tables are qualified by their table names.
+    /**
+     * Join order: greedy left-deep on estimated sizes. Columns above the joins are found by name, the
+     * projection puts them back in the order of the query.
+     */
+    std::string first;
+    const std::vector<JoinClause> joins = OrderJoins(log, table_filters, &first);
+    res = std::make_shared<SeqScanExecutor>(SeqScanExecutor(first, table_mgn_, !joins.empty()));
+
+    /** The filter of the table is evaluated by the scan on rows in the table. */
+    auto first_filter = table_filters.find(first);
+    if (first_filter != table_filters.end()) {
+      std::dynamic_pointer_cast<SeqScanExecutor>(res)->PushPredicate(first_filter->second, var_mgn_);
+    }
+    if (first != log.table_) { est_rows = FilteredRows(first, table_filters); }
+    if (joins.empty() && prune) { pruneScan(res, used); }
+
+    /** Join executors, left-deep. */
+    for (size_t i = 0; i < joins.size(); ++i) {
+      res = PlanJoin(log, joins[i], i == 0 ? first : "", res, &est_rows, prune ? used : std::vector<std::string>(), 
+                     table_filters, &join_filter);
+    }
+
+    /** Filter executor, for conjuncts reading more than one table(or tables an index join reads directly). */
+    if (static_cast<bool>(join_filter)) {
+      res = std::make_shared<FilterExecutor>(FilterExecutor(join_filter, res, var_mgn_));
+    }
+  }
+
+  /** Semi join executors */
+  for (size_t i = 0; i < semi_keys.size(); ++i) {
+    // the index scan found the rows whose keys are in the subquery.
+    if (semi_subqueries[i] == probed_subquery && !semi_anti[i]) { continue; }
+    AbstractExecutorRef subquery = subquery_execs.at(semi_subqueries[i]);
+    res = std::make_shared<SemiJoinExecutor>(SemiJoinExecutor(semi_keys[i], res, subquery, var_mgn_, 
+                                                              semi_anti[i]));
   }
 
   /** Aggregate executor */
-  // bool is_agg = false;
-  if (!log.group_by_.empty()) {
-    // is_agg = true;
-    res = std::make_shared<AggExecutor>(AggExecutor(log.columns_, log.group_by_, 
-                                                    log.order_by_, log.having_, var_mgn_, res));
+  const size_t groups = is_agg ? std::min(est_groups, est_rows) : est_rows;
+  if (is_topk) {
+    res = std::make_shared<TopKExecutor>(TopKExecutor(log.columns_[0], var_mgn_, res));
+  } else if (is_agg) {
+    if (log.group_by_.empty() && AggThreads(log.table_) == 1) {
+      // a single group, nothing to hash.
+      res = std::make_shared<StreamAggExecutor>(StreamAggExecutor(log.columns_, log.group_by_, log.order_by_,
+                                                                  log.having_, var_mgn_, res));
+    } else if (sort_then_stream) {
+      // sort first, then aggregate the sorted groups as a stream.
+      res = std::make_shared<SortExecutor>(SortExecutor(log.order_by_, log.order_by_type_, res));
+      res = std::make_shared<StreamAggExecutor>(StreamAggExecutor(log.columns_, log.group_by_, log.order_by_,
+                                                                  log.having_, var_mgn_, res));
+      ordered_by_agg = true;
+    } else if (clustered_agg) {
+      res = std::make_shared<StreamAggExecutor>(StreamAggExecutor(log.columns_, log.group_by_, log.order_by_,
+                                                                  log.having_, var_mgn_, res));
+    } else {
+      res = std::make_shared<AggExecutor>(AggExecutor(log.columns_, log.group_by_, log.order_by_, log.having_, 
+                                                      var_mgn_, res, AggThreads(log.table_)));
+    }
     if (static_cast<bool>(log.having_)) {
       res = std::make_shared<FilterExecutor>(FilterExecutor(log.having_, res, var_mgn_));
     }
   }
 
-  /** Sort executor */
-  if (!log.order_by_.empty()) {
+  /** Sort executor, or Top-N executor if the limit keeps few of the rows. */
+  if (!log.order_by_.empty() && !ordered_by_agg && !sorted_by_index) {
     // std::vector<AbstractExprRef> order_by = is_agg ? aggsAsColumns(log.order_by_) : log.order_by_;
-    res = std::make_shared<SortExecutor>(SortExecutor(log.order_by_, log.order_by_type_, res));
+    const size_t kept = log.limit_ == static_cast<size_t>(-1) ? log.limit_ : log.limit_ + log.offset_;
+    if (kept <= TOP_N_MAX_ROWS && kept * TOP_N_MIN_RATIO <= groups) {
+      res = std::make_shared<TopNExecutor>(TopNExecutor(log.order_by_, log.order_by_type_, kept, res));
+    } else {
+      res = std::make_shared<SortExecutor>(SortExecutor(log.order_by_, log.order_by_type_, res));
+    }
   }
 
   /** Limit executor */
@@ -56,7 +1048,7 @@ auto Planner::GetExecutors(const ParserLog &log) -> AbstractExecutorRef {
   }
 
   /** Projection executor */
-  if (!log.columns_.empty()) {
+  if (!log.columns_.empty() && !is_topk && !(scan_threads > 1 && project_in_workers)) {
     res = std::make_shared<ProjectionExecutor>(ProjectionExecutor(&projection_schema, var_mgn_, 
                                                                   log.columns_, res));
   }
@@ -9,24 +9,177 @@
 
 #include "executor.h"
 #include "Parser.h"
+#include "stats.h"
 #include "variable_manager.h"
 
 namespace cql {
 
+/** Aggregate in parallel if the table scanned has at least this many rows. */
+const size_t PARALLEL_AGG_MIN_ROWS = 100000;
+/** Scan(and filter, project) with a pool of workers if the table has at least this many rows. */
+const size_t PARALLEL_SCAN_MIN_ROWS = 100000;
+/** Look up a sorted(or indexed) table for each outer tuple if the table has this many times the outer rows. */
+const size_t INDEX_JOIN_MIN_RATIO = 64;
+/** Sort-merge join(sorts spill to disk) if both inputs have at least this many rows. */
+const size_t MERGE_JOIN_MIN_ROWS = 1000000;
+/** Scan instead of probing an index if the statistics say the probe finds more than this fraction of rows. */
+const double INDEX_SCAN_MAX_SELECTIVITY = 0.2;
+/** Hash the rows and sort the groups(instead of sorting the rows) if there are this many times fewer groups. */
+const size_t SORT_GROUPS_MIN_RATIO = 16;
+/** Keep the first rows in a heap instead of sorting all rows, if they are this many times fewer. */
+const size_t TOP_N_MIN_RATIO = 8;
+/** A heap of the first rows has at most this many rows(a sort can spill to disk). */
+const size_t TOP_N_MAX_ROWS = 100000;
+
 class Planner {
  private:
   /** Table manager to use */
   std::unordered_map<std::string, TableInfo> *table_mgn_{nullptr};
   /** Variable manager to use */
   VariableManager *var_mgn_{nullptr};
+  /** adaptive indexing: range predicates on Float columns crack copies of them. */
+  bool cracking_{false};
+
+  /**
+   * @return number of rows of a table, 0 if not loaded.
+   */
+  auto NumRows(const std::string &table) const -> size_t;
+
+  /**
+   * @return statistics of a table, nullptr if not analyzed(or not loaded).
+   */
+  auto StatsOf(const std::string &table) const -> const TableStats *;
+
+  /**
+   * @return estimated number of groups of a query, -1 if unknown.
+   */
+  auto EstimateGroups(const ParserLog &log) const -> size_t;
+
+  /**
+   * @return number of threads an aggregate executor over the table should use.
+   */
+  auto AggThreads(const std::string &table) const -> size_t;
+
+  /**
+   * @return number of workers a scan over the table should use.
+   */
+  auto ScanThreads(const std::string &table) const -> size_t;
+
+  /**
+   * @return columns of a table the keys are, empty if any key is not a plain column.
+   * @param schema: output schema of the scan over the table.
+   */
+  auto KeyColumns(const Schema *schema, const std::vector<AbstractExprRef> &keys) const -> std::vector<size_t>;
+
+  /**
+   * @return index of a column in the table of a query(selected from or joined) it belongs to, -1 if
+   * no table or more than one has it.
+   * @param name: 'a.x' for column x of table a, 'x' for that of the only table with it.
+   * @param table[out] the table.
+   */
+  auto ResolveColumn(const ParserLog &log, const std::string &name, std::string *table) const -> size_t;
+
+  /**
+   * @return false if a column of an expression belongs to no table of a query, or cannot be told apart.
+   * @param tables[out] the tables the expression reads.
+   */
+  auto ReadTables(const ParserLog &log, const AbstractExprRef &expr, std::vector<std::string> *tables) const -> bool;
+
+  /**
+   * @return the table of a query(selected from or joined) all columns an expression reads belong to;
+   * empty if they belong to more than one table, to none, or a column cannot be told apart.
+   */
+  auto OwnerTable(const ParserLog &log, const AbstractExprRef &expr) const -> std::string;
+
+  /**
+   * @return estimated number of rows of a table its filter accepts.
+   */
+  auto FilteredRows(const std::string &table, const std::unordered_map<std::string, AbstractExprRef> &filters) const
+    -> size_t;
+
+  /**
+   * @return estimated number of rows of a join of a query: with statistics of a key, |L||R| / max distinct keys
+   * (each key of the side with fewer keys matches rows / distinct rows of the other); else max(|L|, |R|), as
+   * most joins are on a foreign key.
+   * @param conjuncts: of the join condition; the first equality between columns of two tables with statistics
+   * is the key.
+   */
+  auto EstimateJoinRows(const ParserLog &log, const std::vector<AbstractExprRef> &conjuncts, size_t left_rows,
+                        size_t right_rows) const -> size_t;
+
+  /**
+   * @brief order the joins of a query greedily: start from the smallest table, then join the table joined
+   * on those before giving the smallest estimated result(|L||R| / max distinct keys, or max(|L|, |R|)).
+   * Each join is on the conjuncts of all join conditions reading only tables joined so far.
+   * The order of the query is kept without a select list, or if a table is joined with itself or on no other.
+   * @param filters: filters of the tables, by table.
+   * @param first[out] the table joined first.
+   * @return the joins of the other tables, in order.
+   */
+  auto OrderJoins(const ParserLog &log, const std::unordered_map<std::string, AbstractExprRef> &filters, 
+                  std::string *first) const -> std::vector<JoinClause>;
+
+  /**
+   * @brief choose a join strategy for a join.
+   * @param left_name: table of the left input, empty if it is a join.
+   * @param left: executor of the tables joined before.
+   * @param left_rows[in/out] estimated number of rows of left, then of the join.
+   * @param used: names of the columns the query reads, the scans of the join materialize only these.
+   * @param filters: conjuncts of the where clause reading only one table, by table; pushed into its scan.
+   * @param above[in/out] filter above the joins, and-ed with the filters of tables an index join reads directly.
+   */
+  auto PlanJoin(const ParserLog &log, const JoinClause &join, const std::string &left_name, AbstractExecutorRef left,
+                size_t *left_rows, const std::vector<std::string> &used,
+                const std::unordered_map<std::string, AbstractExprRef> &filters, AbstractExprRef *above) const
+    -> AbstractExecutorRef;
+
+  /**
+   * @brief plan an index scan over the table of a query without joins.
+   * @param sorted[out] true if the scan emits rows in the order of the order by.
+   * @param probed_subquery[out] the subquery of `<column> in (select ...)` the scan looks up, or -1.
+   * @param filtered[out] true if the scan emits only rows the where clause accepts.
+   * @return nullptr if no index helps.
+   */
+  auto PlanIndexScan(const ParserLog &log, bool is_agg, bool *sorted, size_t *probed_subquery, bool *filtered) const
+    -> AbstractExecutorRef;
+
+  /**
+   * @brief in cracking mode, add cracker indexes on the Float columns the where clause
+   * of a statement ranges over, unless they have B+tree indexes.
+   */
+  void AddCrackers(const ParserLog &log) const;
+
+  /**
+   * @brief materialize the columns a query reads from its lazily loaded tables.
+   */
+  void LoadColumns(const ParserLog &log);
+
+  /**
+   * @return true if the table selected from is clustered on the group bys.
+   */
+  auto ClusteredOnGroupBy(const ParserLog &log) const -> bool;
 
  public:
   Planner() = default;
-  Planner(std::unordered_map<std::string, TableInfo> *tb_mgn, VariableManager *var_mgn):
-    table_mgn_(tb_mgn), var_mgn_(var_mgn) {}
+  Planner(std::unordered_map<std::string, TableInfo> *tb_mgn, VariableManager *var_mgn, bool cracking = false):
+    table_mgn_(tb_mgn), var_mgn_(var_mgn), cracking_(cracking) {}
   ~Planner() = default;
 
   auto GetExecutors(const ParserLog &log) -> AbstractExecutorRef;
+
+  /**
+   * @brief find rows of the table of a statement(update, delete) its where clause may accept, by an index.
+   * @param rows[out] ascending row ids.
+   * @return false if no index applies, all rows have to be checked.
+   */
+  auto IndexedRows(const ParserLog &log, std::vector<size_t> *rows) const -> bool;
+
+  /**
+   * @brief plan the subqueries of a statement, so that its
+   * expressions can probe them(they run on first probe).
+   * @return the executor of each subquery, by index.
+   */
+  auto PlanSubqueries(const ParserLog &log) -> std::unordered_map<size_t, AbstractExecutorRef>;
 };
 
 }  // namespace cql
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include <stdexcept>
+
+#include "posting.h"
+
+namespace cql {
+
+void PostingList::Cursor::Next() {
+  const std::vector<uint8_t> &bytes = list_->bytes_;
+  if (pos_ == bytes.size()) {
+    valid_ = false;
+    return;
+  }
+  size_t gap = 0;
+  for (size_t shift = 0; ; shift += 7) {
+    const uint8_t byte = bytes[pos_++];
+    gap |= static_cast<size_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) { break; }
+  }
+  // the first row is written as is.
+  row_ = valid_ ? row_ + gap : gap;
+  valid_ = true;
+}
+
+void PostingList::Cursor::SkipTo(size_t row) {
+  while (valid_ && row_ < row) { Next(); }
+}
+
+void PostingList::Append(size_t row) {
+  if (size_ != 0 && row <= last_) {
+    throw std::domain_error("appending rows to a posting list out of order?? Impossible!");
+  }
+  size_t gap = size_ == 0 ? row : row - last_;
+  while (gap >= 0x80) {
+    bytes_.push_back(static_cast<uint8_t>(gap | 0x80));
+    gap >>= 7;
+  }
+  bytes_.push_back(static_cast<uint8_t>(gap));
+  last_ = row;
+  ++size_;
+}
+
+void PostingList::Extend(const PostingList &other) {
+  if (other.isEmpty()) { return; }
+  // the first row of other is not a gap, write it again as a gap from last_.
+  size_t first_bytes = 0;
+  while ((other.bytes_[first_bytes] & 0x80) != 0) { ++first_bytes; }
+  Append(Cursor(&other).getRow());
+  bytes_.insert(bytes_.end(), other.bytes_.begin() + first_bytes + 1, other.bytes_.end());
+  size_ += other.size_ - 1;
+  last_ = other.last_;
+}
+
+void PostingList::Decode(std::vector<size_t> *rows) const {
+  rows->reserve(rows->size() + size_);
+  for (Cursor cursor(this); cursor.isValid(); cursor.Next()) { rows->push_back(cursor.getRow()); }
+}
+
+void PostingList::Encode(const std::vector<size_t> &rows) {
+  bytes_.clear();
+  size_ = 0;
+  last_ = 0;
+  for (size_t row : rows) { Append(row); }
+  bytes_.shrink_to_fit();
+}
+
+}  // namespace cql
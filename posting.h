@@ -0,0 +1,74 @@
+/*****************************************************
+ * File: posting.h
+ * Author: Fudanyrd (email: yangrundong7@gmail.com)
+ *
+ * A posting list: ascending row ids compressed as the
+ * gaps between them, each written as a varint(7 bits
+ * a byte, the high bit set if more bytes follow), so
+ * that dense lists take about a byte a row.
+ *****************************************************/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace cql {
+
+class PostingList {
+ private:
+  std::vector<uint8_t> bytes_;
+  /** number of rows. */
+  size_t size_{0U};
+  /** the last row, if any. */
+  size_t last_{0U};
+
+ public:
+  /** reads the rows of a list in order. */
+  class Cursor {
+   private:
+    const PostingList *list_;
+    size_t pos_{0U};
+    size_t row_{0U};
+    bool valid_{false};
+
+   public:
+    explicit Cursor(const PostingList *list): list_(list) { Next(); }
+
+    auto isValid() const -> bool { return valid_; }
+    auto getRow() const -> size_t { return row_; }
+    /** @brief move to the next row. */
+    void Next();
+    /** @brief move to the first row no less than row. */
+    void SkipTo(size_t row);
+  };
+
+  auto getSize() const -> size_t { return size_; }
+  auto isEmpty() const -> bool { return size_ == 0; }
+  auto getLast() const -> size_t { return last_; }
+  /** @return bytes of the compressed rows. */
+  auto getBytes() const -> size_t { return bytes_.size(); }
+
+  /**
+   * @brief append a row.
+   * @param row: greater than the last row.
+   */
+  void Append(size_t row);
+
+  /**
+   * @brief append the rows of another list, copying its bytes but the first row.
+   * @param other: its first row greater than the last row.
+   */
+  void Extend(const PostingList &other);
+
+  /**
+   * @brief append the rows, ascending.
+   */
+  void Decode(std::vector<size_t> *rows) const;
+
+  /**
+   * @brief rebuild the list from ascending rows.
+   */
+  void Encode(const std::vector<size_t> &rows);
+};
+
+}  // namespace cql
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <iostream>
+#include "executor.h"
+
+using namespace std;  using namespace cql;
+
+/** @return the columns of all tuples of an executor read by NextRef, one "v1,v2,..." per tuple, sorted. */
+static auto collect(const AbstractExecutorRef &exec, const vector<string> &columns) -> vector<string> {
+  vector<size_t> cols;
+  for (const auto &name : columns) { cols.push_back(exec->GetOutputSchema()->getColumnIdx(name)); }
+  vector<string> res;
+  exec->Init();
+  const Tuple *tuple;
+  while (exec->NextRef(&tuple)) {
+    string row;
+    for (size_t col : cols) { row += DataBox::toString(tuple->getColumnData(col)) + ','; }
+    res.push_back(row);
+  }
+  sort(res.begin(), res.end());
+  return res;
+}
+
+auto main(int argc, char **argv) -> int {
+  Table a("id:float,g:float,name:char");
+  Table b("uid:float,price:float");
+  for (size_t i = 0; i < 3000; ++i) {
+    a.insertTuple({DataBox(static_cast<double>(i)), DataBox(static_cast<double>(i % 7)), 
+                   DataBox(TypeId::Char, "n" + to_string(i))});
+  }
+  for (size_t i = 0; i < 9000; ++i) {
+    b.insertTuple({DataBox(static_cast<double>(i % 3000)), DataBox(static_cast<double>(i % 11))});
+  }
+  unordered_map<string, TableInfo> tables;
+  tables["a"] = {&a};
+  tables["b"] = {&b};
+  VariableManager var_mgn;
+  const AbstractExprRef on = toExprRef({"#a.id", "=", "#b.uid"});
+  const vector<string> columns = {"a.id", "b.price"};
+
+  // the where clause above the join, and its conjuncts pushed into the scans(pruned to the columns read).
+  AbstractExecutorRef above = make_shared<FilterExecutor>(
+    toExprRef({"#a.g", "=", "3", "and", "#b.price", ">", "5"}), 
+    make_shared<HashJoinExecutor>(make_shared<SeqScanExecutor>("a", &tables, true), 
+                                  make_shared<SeqScanExecutor>("b", &tables, true), on, &var_mgn), 
+    &var_mgn);
+  auto scan_a = make_shared<SeqScanExecutor>("a", &tables, true);
+  auto scan_b = make_shared<SeqScanExecutor>("b", &tables, true);
+  scan_a->PushPredicate(toExprRef({"#g", "=", "3"}), &var_mgn);
+  scan_a->PushColumns({0});
+  scan_b->PushPredicate(toExprRef({"#price", ">", "5"}), &var_mgn);
+  AbstractExecutorRef pushed = make_shared<HashJoinExecutor>(scan_a, scan_b, on, &var_mgn, true);
+  const vector<string> expect = collect(above, columns);
+  cout << "joined rows = " << expect.size() << ", pushed down the same: " << (collect(pushed, columns) == expect)
+       << endl;  // expect 585(429 ids, 5 of 11 prices of their 3 rows of b), 1.
+
+  // a stream aggregate reads tuples of a pruned scan by reference; #k = i / 10 is ascending.
+  Table c("k:float,pad:char,v:float");
+  for (size_t i = 0; i < 1000; ++i) {
+    c.insertTuple({DataBox(static_cast<double>(i / 10)), DataBox(TypeId::Char, "x"), DataBox(static_cast<double>(i))});
+  }
+  tables["c"] = {&c};
+  auto scan_c = make_shared<SeqScanExecutor>("c", &tables);
+  scan_c->PushColumns({0, 2});
+  const vector<AbstractExprRef> group_by = {toExprRef({"#k"})};
+  AbstractExecutorRef agg = make_shared<StreamAggExecutor>(
+    vector<AbstractExprRef>{toExprRef({"#k"}), toExprRef({"sum", "(", "#v", ")"})}, group_by, 
+    vector<AbstractExprRef>(), nullptr, &var_mgn, scan_c);
+  agg->Init();
+  size_t groups = 0;
+  bool sums_ok = true;
+  const Tuple *tuple;
+  while (agg->NextRef(&tuple)) {
+    const double k = tuple->getColumnData(0).getFloatValue();
+    sums_ok = sums_ok && tuple->getColumnData(1).getFloatValue() == 100 * k + 45;
+    ++groups;
+  }
+  cout << "groups = " << groups << ", sums ok: " << sums_ok << endl;  // expect 100, 1.
+  return 0;
+}
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
 #include "schema.h"
 
 namespace cql {
@@ -30,6 +34,45 @@ void Schema::printTo(std::ostream &os) const {
   os << std::endl;
 }
 
+auto Schema::getColumnIdx(const std::string &name) const -> size_t {
+  const size_t not_found = static_cast<size_t>(-1);
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    if (columns_[i].second == name) { return i; }
+  }
+
+  // 'a.x' matches column 'x' of a table's own schema; once columns are qualified(joined), 'b.x' is not 'a.x'.
+  size_t dot = name.rfind('.');
+  if (dot != std::string::npos) {
+    for (const auto &column : columns_) {
+      const size_t col_dot = column.second.find('.');
+      if (col_dot != std::string::npos && col_dot > 0 
+          && std::all_of(column.second.begin(), column.second.begin() + col_dot, 
+                         [](char c) -> bool { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; })) {
+        return not_found;
+      }
+    }
+    const std::string unqualified = name.substr(dot + 1);
+    for (size_t i = 0; i < columns_.size(); ++i) {
+      if (columns_[i].second == unqualified) { return i; }
+    }
+    return not_found;
+  }
+
+  // 'x' matches the only column '<table>.x'.
+  const std::string suffix = "." + name;
+  size_t res = not_found;
+  for (size_t i = 0; i < columns_.size(); ++i) {
+    const std::string &col = columns_[i].second;
+    if (col.size() > suffix.size() && col.compare(col.size() - suffix.size(), suffix.size(), suffix) == 0) {
+      if (res != not_found) {
+        throw std::domain_error(("column name " + name + " is ambiguous?? Impossible!").c_str());
+      }
+      res = i;
+    }
+  }
+  return res;
+}
+
 Schema::Schema(const std::string &header) {
   // split the header by commas.
   auto columns = Split(header, ',');
@@ -52,6 +52,16 @@ class Schema {
    */
   auto getNumCols(void) const -> size_t { return columns_.size(); }
 
+  /**
+   * @brief find a column by name. Columns of joined tables are qualified as
+   * 'table.col'; a name matches a qualified column if it is its only match
+   * by the unqualified part, and a qualified name matches an unqualified column
+   * only if no column is qualified.
+   * @return index of the column, static_cast<size_t>(-1) if not found.
+   * @throws std::domain_error if the name is ambiguous.
+   */
+  auto getColumnIdx(const std::string &name) const -> size_t;
+
   /**
    * @brief print the schema to the given output stream.
    */
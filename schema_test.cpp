@@ -7,6 +7,13 @@ auto main(int argc, char **argv) -> int {
   cql::Schema schema(header);
   schema.printTo(cout);
 
+  // a qualified name matches an unqualified column, but not a column qualified by another table.
+  cql::Schema joined;
+  joined.AppendCol(cql::TypeId::Float, "a.x");
+  joined.AppendCol(cql::TypeId::Float, "b.y");
+  cout << schema.getColumnIdx("t.c") << ' ' << joined.getColumnIdx("y") << ' ' 
+       << (joined.getColumnIdx("b.x") == static_cast<size_t>(-1)) << endl;  // expect 2 1 1
+
   while (getline(cin, header)) {
     cql::Schema sch(header);
     sch.printTo(cout);
@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "sketch.h"
+
+namespace cql {
+
+/************************************************
+ *                HyperLogLog
+ ************************************************/
+void HyperLogLog::Update(const DataBox &val) {
+  if (val.getType() == TypeId::INVALID) { return; }
+  const uint64_t hash = DataBox::Hash(val);
+  // the first HLL_PRECISION bits choose the register,
+  // the position of the first 1 in the rest is the rank.
+  const size_t idx = static_cast<size_t>(hash >> (64 - HLL_PRECISION));
+  const uint64_t rest = hash << HLL_PRECISION;
+  uint8_t rank = 1;
+  while (rank <= 64 - HLL_PRECISION && (rest & (1ULL << (64 - rank))) == 0) { ++rank; }
+  registers_[idx] = std::max(registers_[idx], rank);
+}
+
+void HyperLogLog::Merge(const AggregateSketch &that) {
+  const HyperLogLog &other = dynamic_cast<const HyperLogLog &>(that);
+  for (size_t i = 0; i < registers_.size(); ++i) {
+    registers_[i] = std::max(registers_[i], other.registers_[i]);
+  }
+}
+
+auto HyperLogLog::Result() const -> DataBox {
+  const double m = static_cast<double>(registers_.size());
+  double sum = 0.0;
+  size_t zeros = 0;
+  for (uint8_t reg : registers_) {
+    sum += ldexp(1.0, -static_cast<int>(reg));
+    if (reg == 0) { ++zeros; }
+  }
+  const double alpha = 0.7213 / (1.0 + 1.079 / m);
+  double estimate = alpha * m * m / sum;
+  if (estimate <= 2.5 * m && zeros != 0) {
+    // small range correction: linear counting.
+    estimate = m * log(m / static_cast<double>(zeros));
+  }
+  return DataBox(std::round(estimate));
+}
+
+/************************************************
+ *                 KllSketch
+ ************************************************/
+KllSketch::KllSketch(double quantile, size_t k): quantile_(quantile), k_(k) {
+  AddLevel();
+}
+
+auto KllSketch::Capacity(size_t level) const -> size_t {
+  // the top level has capacity k, each level below 2/3 of the one above.
+  const size_t depth = levels_.size() - 1 - level;
+  const size_t cap = static_cast<size_t>(ceil(static_cast<double>(k_) * pow(2.0 / 3.0, depth)));
+  return std::max(cap, static_cast<size_t>(2));
+}
+
+void KllSketch::AddLevel() {
+  levels_.emplace_back();
+  max_retained_ = 0;
+  for (size_t h = 0; h < levels_.size(); ++h) {
+    max_retained_ += Capacity(h);
+  }
+}
+
+void KllSketch::Compress() {
+  while (num_retained_ > max_retained_) {
+    size_t h = 0;
+    while (levels_[h].size() < Capacity(h)) { ++h; }
+    if (h + 1 == levels_.size()) { AddLevel(); }
+
+    std::vector<double> &level = levels_[h];
+    std::sort(level.begin(), level.end());
+    // an odd value out stays at this level.
+    double odd = 0.0;
+    const bool has_odd = level.size() % 2 == 1;
+    if (has_odd) {
+      odd = level.back();
+      level.pop_back();
+    }
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 7;
+    random_ ^= random_ << 17;
+    const size_t offset = random_ & 1;
+    std::vector<double> &upper = levels_[h + 1];
+    for (size_t i = offset; i < level.size(); i += 2) {
+      upper.push_back(level[i]);
+    }
+    num_retained_ -= level.size() / 2;
+    level.clear();
+    if (has_odd) { level.push_back(odd); }
+  }
+}
+
+void KllSketch::Update(const DataBox &val) {
+  if (val.getType() == TypeId::INVALID) { return; }
+  levels_[0].push_back(DataBox::toFloat(val).getFloatValue());
+  ++num_retained_;
+  ++count_;
+  if (num_retained_ > max_retained_) { Compress(); }
+}
+
+void KllSketch::Merge(const AggregateSketch &that) {
+  const KllSketch &other = dynamic_cast<const KllSketch &>(that);
+  while (levels_.size() < other.levels_.size()) { AddLevel(); }
+  for (size_t h = 0; h < other.levels_.size(); ++h) {
+    levels_[h].insert(levels_[h].end(), other.levels_[h].begin(), other.levels_[h].end());
+  }
+  num_retained_ += other.num_retained_;
+  count_ += other.count_;
+  Compress();
+}
+
+auto KllSketch::Result() const -> DataBox {
+  if (count_ == 0) { return DataBox(TypeId::INVALID, ""); }
+  // (value, weight) of every retained value.
+  std::vector<std::pair<double, uint64_t>> items;
+  items.reserve(num_retained_);
+  uint64_t total = 0;
+  for (size_t h = 0; h < levels_.size(); ++h) {
+    for (double val : levels_[h]) {
+      items.push_back({val, 1ULL << h});
+      total += 1ULL << h;
+    }
+  }
+  std::sort(items.begin(), items.end());
+
+  // smallest value whose rank reaches the quantile.
+  const double target = quantile_ * static_cast<double>(total);
+  uint64_t rank = 0;
+  for (const auto &item : items) {
+    rank += item.second;
+    if (static_cast<double>(rank) >= target) { return DataBox(item.first); }
+  }
+  return DataBox(items.back().first);
+}
+
+/************************************************
+ *               ExactQuantile
+ ************************************************/
+void ExactQuantile::Update(const DataBox &val) {
+  if (val.getType() == TypeId::INVALID) { return; }
+  values_.push_back(DataBox::toFloat(val).getFloatValue());
+}
+
+void ExactQuantile::Merge(const AggregateSketch &that) {
+  const ExactQuantile &other = dynamic_cast<const ExactQuantile &>(that);
+  values_.insert(values_.end(), other.values_.begin(), other.values_.end());
+}
+
+auto ExactQuantile::Result() const -> DataBox {
+  if (values_.empty()) { return DataBox(TypeId::INVALID, ""); }
+  const double pos = quantile_ * static_cast<double>(values_.size() - 1);
+  const size_t lo = static_cast<size_t>(floor(pos));
+  std::nth_element(values_.begin(), values_.begin() + lo, values_.end());
+  const double lower = values_[lo];
+  if (lo + 1 == values_.size() || pos == static_cast<double>(lo)) { return DataBox(lower); }
+  // values after lo are no less than it, the next value is their minimum.
+  const double upper = *std::min_element(values_.begin() + lo + 1, values_.end());
+  return DataBox(lower + (pos - static_cast<double>(lo)) * (upper - lower));
+}
+
+/************************************************
+ *                SpaceSaving
+ ************************************************/
+SpaceSaving::SpaceSaving(size_t k)
+  : k_(k), capacity_(std::max(k * SPACE_SAVING_COUNTERS_PER_K, SPACE_SAVING_MIN_COUNTERS)) {
+  heap_.reserve(capacity_);
+}
+
+void SpaceSaving::SiftDown(size_t pos) {
+  while (true) {
+    size_t smallest = pos;
+    const size_t left = 2 * pos + 1, right = 2 * pos + 2;
+    if (left < heap_.size() && heap_[left].count_ < heap_[smallest].count_) { smallest = left; }
+    if (right < heap_.size() && heap_[right].count_ < heap_[smallest].count_) { smallest = right; }
+    if (smallest == pos) { return; }
+    std::swap(heap_[pos], heap_[smallest]);
+    index_[heap_[pos].value_] = pos;
+    index_[heap_[smallest].value_] = smallest;
+    pos = smallest;
+  }
+}
+
+void SpaceSaving::Rebuild() {
+  index_.clear();
+  for (size_t i = 0; i < heap_.size(); ++i) {
+    index_[heap_[i].value_] = i;
+  }
+  for (size_t i = heap_.size() / 2; i > 0; --i) {
+    SiftDown(i - 1);
+  }
+}
+
+void SpaceSaving::Update(const DataBox &val) {
+  if (val.getType() == TypeId::INVALID) { return; }
+  total_ += 1.0;
+  auto iter = index_.find(val);
+  if (iter != index_.end()) {
+    // counts only grow, so the counter can only move down.
+    size_t pos = iter->second;
+    heap_[pos].count_ += 1.0;
+    SiftDown(pos);
+    return;
+  }
+
+  if (heap_.size() < capacity_) {
+    // a free counter: append and sift up.
+    size_t pos = heap_.size();
+    heap_.push_back(Counter{val, 1.0, 0.0});
+    while (pos > 0 && heap_[(pos - 1) / 2].count_ > heap_[pos].count_) {
+      std::swap(heap_[pos], heap_[(pos - 1) / 2]);
+      index_[heap_[pos].value_] = pos;
+      pos = (pos - 1) / 2;
+    }
+    index_[heap_[pos].value_] = pos;
+    return;
+  }
+
+  // take over the counter of the least frequent value.
+  Counter &victim = heap_[0];
+  index_.erase(victim.value_);
+  victim.value_ = val;
+  victim.error_ = victim.count_;
+  victim.count_ += 1.0;
+  index_[val] = 0;
+  SiftDown(0);
+}
+
+void SpaceSaving::Merge(const AggregateSketch &that) {
+  const SpaceSaving &other = dynamic_cast<const SpaceSaving &>(that);
+  // a value missing from a full summary may have occurred up to its minimum count times.
+  const double min_this = heap_.size() == capacity_ ? heap_[0].count_ : 0.0;
+  const double min_other = other.heap_.size() == other.capacity_ ? other.heap_[0].count_ : 0.0;
+
+  std::vector<Counter> merged;
+  merged.reserve(heap_.size() + other.heap_.size());
+  for (const Counter &counter : heap_) {
+    auto iter = other.index_.find(counter.value_);
+    if (iter != other.index_.end()) {
+      const Counter &match = other.heap_[iter->second];
+      merged.push_back(Counter{counter.value_, counter.count_ + match.count_, counter.error_ + match.error_});
+    } else {
+      merged.push_back(Counter{counter.value_, counter.count_ + min_other, counter.error_ + min_other});
+    }
+  }
+  for (const Counter &counter : other.heap_) {
+    if (index_.find(counter.value_) == index_.end()) {
+      merged.push_back(Counter{counter.value_, counter.count_ + min_this, counter.error_ + min_this});
+    }
+  }
+
+  // keep the capacity_ largest counters.
+  if (merged.size() > capacity_) {
+    std::nth_element(merged.begin(), merged.begin() + capacity_, merged.end(),
+                     [](const Counter &c1, const Counter &c2) { return c1.count_ > c2.count_; });
+    merged.resize(capacity_);
+  }
+  heap_.swap(merged);
+  total_ += other.total_;
+  Rebuild();
+}
+
+auto SpaceSaving::getTopK() const -> std::vector<Counter> {
+  std::vector<Counter> res(heap_);
+  std::sort(res.begin(), res.end(), [](const Counter &c1, const Counter &c2) {
+    // ties: the one with smaller error is more certain.
+    return c1.count_ > c2.count_ || (c1.count_ == c2.count_ && c1.error_ < c2.error_);
+  });
+  if (res.size() > k_) { res.resize(k_); }
+  return res;
+}
+
+auto SpaceSaving::Result() const -> DataBox {
+  std::string res;
+  for (const Counter &counter : getTopK()) {
+    if (!res.empty()) { res += ','; }
+    res += DataBox::toString(counter.value_) + ':' + DataBox::toString(DataBox(counter.count_));
+  }
+  return DataBox(TypeId::Char, res);
+}
+
+}  // namespace cql
@@ -0,0 +1,193 @@
+/*****************************************************
+ * File: sketch.h
+ * Author: Fudanyrd (email: yangrundong7@gmail.com)
+ *
+ * Mergeable summaries of a stream of values, kept in
+ * the states of aggregates that need more than a scalar:
+ * (1) HyperLogLog for approximate distinct count;
+ * (2) KLL sketch for approximate quantiles;
+ * (3) the values themselves for exact quantiles;
+ * (4) Space-Saving counters for heavy hitters.
+ *****************************************************/
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "type.h"
+
+namespace cql {
+
+/**
+ * Interface of a sketch kept in an aggregate state.
+ */
+class AggregateSketch {
+ public:
+  virtual ~AggregateSketch() = default;
+
+  /**
+   * @brief fold one value into the sketch. NULLs are ignored.
+   */
+  virtual void Update(const DataBox &val) = 0;
+
+  /**
+   * @brief fold another sketch of the same kind(and parameters) into this one.
+   */
+  virtual void Merge(const AggregateSketch &that) = 0;
+
+  /**
+   * @return the estimate the sketch answers.
+   */
+  virtual auto Result() const -> DataBox = 0;
+};
+
+typedef std::shared_ptr<AggregateSketch> AggregateSketchRef;
+
+/** log2 of the number of HyperLogLog registers(standard error ~1.6%). */
+const size_t HLL_PRECISION = 12;
+
+/**
+ * HyperLogLog distinct counter over DataBox::Hash.
+ * Uses 2^HLL_PRECISION one-byte registers no matter how many values.
+ */
+class HyperLogLog: public AggregateSketch {
+ private:
+  std::vector<uint8_t> registers_;
+
+ public:
+  HyperLogLog(): registers_(static_cast<size_t>(1) << HLL_PRECISION, 0) {}
+
+  void Update(const DataBox &val) override;
+  void Merge(const AggregateSketch &that) override;
+
+  /**
+   * @return estimated number of distinct non-null values.
+   */
+  auto Result() const -> DataBox override;
+};
+
+/** accuracy parameter of the KLL sketch(rank error ~1.7%). */
+const size_t KLL_DEFAULT_K = 200;
+
+/**
+ * KLL quantile sketch(Karnin, Lang, Liberty) over numeric values.
+ * Level h holds values of weight 2^h; when the sketch is full, the
+ * lowest full level is sorted and every other value is promoted.
+ * Memory is O(k) values no matter how many values are folded in.
+ */
+class KllSketch: public AggregateSketch {
+ private:
+  /** rank of the quantile to answer, in [0, 1]. */
+  double quantile_;
+  size_t k_;
+  /** levels_[h] holds values of weight 2^h. */
+  std::vector<std::vector<double>> levels_;
+  /** number of values folded in. */
+  uint64_t count_{0U};
+  /** number of values kept in all levels. */
+  size_t num_retained_{0U};
+  /** sum of the capacity of all levels. */
+  size_t max_retained_{0U};
+  /** state of the xorshift generator choosing which half to promote. */
+  uint64_t random_{0x2545f4914f6cdd1dULL};
+
+  /** @return maximum number of values at a level. */
+  auto Capacity(size_t level) const -> size_t;
+  /** @brief add an empty top level. */
+  void AddLevel();
+  /** @brief compress levels until the sketch fits its capacity. */
+  void Compress();
+
+ public:
+  explicit KllSketch(double quantile, size_t k = KLL_DEFAULT_K);
+
+  void Update(const DataBox &val) override;
+  void Merge(const AggregateSketch &that) override;
+
+  /**
+   * @return estimated quantile of the non-null values, NULL if there is none.
+   */
+  auto Result() const -> DataBox override;
+};
+
+/**
+ * Exact quantile: keeps every value of the group, and selects the
+ * answer in linear time(std::nth_element) instead of sorting.
+ */
+class ExactQuantile: public AggregateSketch {
+ private:
+  /** rank of the quantile to answer, in [0, 1]. */
+  double quantile_;
+  /** reordered by selection in Result. */
+  mutable std::vector<double> values_;
+
+ public:
+  explicit ExactQuantile(double quantile): quantile_(quantile) {}
+
+  void Update(const DataBox &val) override;
+  void Merge(const AggregateSketch &that) override;
+
+  /**
+   * @return the quantile of the non-null values, interpolated linearly
+   * between the two closest values; NULL if there is none.
+   */
+  auto Result() const -> DataBox override;
+};
+
+/** number of Space-Saving counters kept for each of the k heavy hitters asked. */
+const size_t SPACE_SAVING_COUNTERS_PER_K = 4;
+/** keep at least this many counters, so that a small k still has tight error bounds. */
+const size_t SPACE_SAVING_MIN_COUNTERS = 64;
+
+/**
+ * Space-Saving heavy hitters(Metwally, Agrawal, El Abbadi).
+ * Keeps m counters in a min-heap on count; a value without counter
+ * takes over the smallest one and inherits its count as error, so that
+ *   count - error <= true frequency <= count, and error <= n / m.
+ */
+class SpaceSaving: public AggregateSketch {
+ public:
+  struct Counter {
+    DataBox value_;
+    double count_;   // upper bound of the frequency.
+    double error_;   // count_ - error_ is a lower bound of the frequency.
+  };
+
+ private:
+  /** number of heavy hitters to answer. */
+  size_t k_;
+  /** maximum number of counters. */
+  size_t capacity_;
+  /** min-heap on count_. */
+  std::vector<Counter> heap_;
+  /** position of each value in heap_. */
+  std::unordered_map<DataBox, size_t, BoxHash, BoxEqual> index_;
+  /** number of values folded in. */
+  double total_{0.0};
+
+  /** @brief move the counter at pos down until the heap is valid. */
+  void SiftDown(size_t pos);
+  /** @brief rebuild heap and index from counters in heap_. */
+  void Rebuild();
+
+ public:
+  explicit SpaceSaving(size_t k);
+
+  void Update(const DataBox &val) override;
+  void Merge(const AggregateSketch &that) override;
+
+  /**
+   * @return the top k counters, most frequent first.
+   */
+  auto getTopK() const -> std::vector<Counter>;
+
+  /**
+   * @return the top k as a string 'value:count,value:count,...'.
+   */
+  auto Result() const -> DataBox override;
+};
+
+}  // namespace cql
@@ -0,0 +1,60 @@
+#include <iostream>
+#include "sketch.h"
+
+using namespace std;  using namespace cql;
+
+auto main(int argc, char **argv) -> int {
+  // 100000 values with 30000 distinct; two halves merged like the parallel aggregation does.
+  HyperLogLog hll1, hll2;
+  KllSketch kll1(0.5), kll2(0.5);
+  for (int i = 0; i < 100000; ++i) {
+    DataBox box(static_cast<double>(i % 30000));
+    if (i % 2 == 0) {
+      hll1.Update(box);
+      kll1.Update(box);
+    } else {
+      hll2.Update(box);
+      kll2.Update(box);
+    }
+  }
+  hll1.Update(DataBox(TypeId::INVALID, ""));  // NULLs are ignored.
+  hll1.Merge(hll2);
+  kll1.Merge(kll2);
+
+  cout << "approx_count_distinct = ";  // expect about 30000.
+  hll1.Result().printTo(cout);
+  cout << endl << "approx_quantile(0.5) = ";  // expect about 13333.
+  kll1.Result().printTo(cout);
+  cout << endl;
+
+  // small inputs are answered (almost) exactly.
+  HyperLogLog small;
+  for (int i = 0; i < 10; ++i) { small.Update(DataBox(TypeId::Char, i % 2 == 0 ? "a" : "b")); }
+  cout << "distinct of {a, b} = ";  // expect 2.
+  small.Result().printTo(cout);
+  cout << endl;
+
+  // exact quantiles interpolate between the two closest values.
+  ExactQuantile median(0.5), p90(0.9);
+  for (double v : {7.0, 1.0, 3.0, 9.0}) {
+    median.Update(DataBox(v));
+    p90.Update(DataBox(v));
+  }
+  cout << "median of {7, 1, 3, 9} = ";  // expect 5.
+  median.Result().printTo(cout);
+  cout << endl << "percentile 0.9 of {7, 1, 3, 9} = ";  // expect 8.4.
+  p90.Result().printTo(cout);
+  cout << endl;
+
+  // even i gives i % 10(2000 times each), odd i a unique value; merged from two halves.
+  SpaceSaving top1(3), top2(3);
+  for (int i = 0; i < 20000; ++i) {
+    DataBox box(static_cast<double>(i % 2 == 0 ? i % 10 : 100 + i));
+    (i < 10000 ? top1 : top2).Update(box);
+  }
+  top1.Merge(top2);
+  cout << "topk(3) = ";  // expect three of 0, 2, 4, 6, 8 with count 2000.
+  top1.Result().printTo(cout);
+  cout << endl;
+  return 0;
+}
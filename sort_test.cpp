@@ -0,0 +1,42 @@
+#include <iostream>
+#include "executor.h"
+
+using namespace std;  using namespace cql;
+
+auto main(int argc, char **argv) -> int {
+  // #k = (i * 7919) % 20000 is a permutation, #v has 10 rows of each value.
+  Table table("k:float,v:float");
+  for (size_t i = 0; i < 20000; ++i) {
+    table.insertTuple({DataBox(static_cast<double>((i * 7919) % 20000)), DataBox(static_cast<double>(i % 2000))});
+  }
+  unordered_map<string, TableInfo> tables;
+  tables["t"] = {&table};
+
+  // a budget of 64 KiB spills sorted runs to disk, merged while reading.
+  vector<AbstractExprRef> order_by = {toExprRef({"#v"}), toExprRef({"#k"})};
+  vector<OrderByType> order_by_type = {OrderByType::ASC, OrderByType::DESC};
+  auto sort = make_shared<SortExecutor>(order_by, order_by_type, make_shared<SeqScanExecutor>("t", &tables), 
+                                        static_cast<size_t>(64) << 10);
+  for (int pass = 0; pass < 2; ++pass) {
+    sort->Init();
+    vector<bool> seen(20000, false);
+    size_t rows = 0;
+    bool ordered = true;
+    double prev_v = -1, prev_k = 0;
+    const Tuple *tuple;
+    while (sort->NextRef(&tuple)) {
+      const double k = tuple->getColumnData(0).getFloatValue();
+      const double v = tuple->getColumnData(1).getFloatValue();
+      ordered = ordered && (v > prev_v || (v == prev_v && k < prev_k));
+      prev_v = v;
+      prev_k = k;
+      seen[static_cast<size_t>(k)] = true;
+      ++rows;
+    }
+    size_t missing = 0;
+    for (bool found : seen) { missing += found ? 0 : 1; }
+    cout << "runs > 4: " << (sort->getNumRuns() > 4) << ", rows = " << rows << ", missing = " << missing 
+         << (ordered ? ", ordered" : ", unordered") << endl;  // expect 1, 20000, 0, ordered; twice.
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "spill_file.h"
+
+namespace cql {
+
+/**
+ * @brief append raw bytes of a value to the buffer.
+ */
+template <typename T>
+static void putValue(std::string &buf, const T &val) {
+  buf.append(reinterpret_cast<const char *>(&val), sizeof(T));
+}
+
+/**
+ * @brief read a value from the file.
+ * @return false if reaching the end of file.
+ */
+template <typename T>
+static auto getValue(FILE *file, T *val) -> bool {
+  return fread(val, sizeof(T), 1, file) == 1;
+}
+
+SpillFile::SpillFile() {
+  file_ = tmpfile();
+  if (!static_cast<bool>(file_)) {
+    throw std::domain_error("cannot create temporary file for spilling?? Impossible!");
+  }
+}
+
+SpillFile::~SpillFile() {
+  if (static_cast<bool>(file_)) {
+    fclose(file_);
+  }
+}
+
+void SpillFile::Append(const Tuple &tuple) {
+  buffer_.clear();
+  const std::vector<DataBox> &data = tuple.getData();
+  putValue(buffer_, static_cast<uint32_t>(data.size()));
+  for (const auto &box : data) {
+    putValue(buffer_, static_cast<uint8_t>(box.getType()));
+    switch (box.getType()) {
+      case TypeId::Float:
+        putValue(buffer_, box.getFloatValue());
+        break;
+      case TypeId::Bool:
+        putValue(buffer_, static_cast<uint8_t>(box.getBoolValue()));
+        break;
+      case TypeId::Char: {
+        const std::string &str = box.getStrValue();
+        putValue(buffer_, static_cast<uint32_t>(str.size()));
+        buffer_ += str;
+        break;
+      }
+      case TypeId::INVALID:
+        break;
+    }
+  }
+
+  if (fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+    throw std::domain_error("cannot write to spill file(disk full?)?? Impossible!");
+  }
+  num_bytes_ += buffer_.size();
+  ++num_tuples_;
+}
+
+void SpillFile::Rewind() {
+  fflush(file_);
+  rewind(file_);
+}
+
+auto SpillFile::Read(Tuple *tuple, const Schema *schema) -> bool {
+  uint32_t cols;
+  if (!getValue(file_, &cols)) { return false; }
+
+  std::vector<DataBox> data;
+  data.reserve(cols);
+  for (uint32_t i = 0; i < cols; ++i) {
+    uint8_t tag;
+    cqlAssert(getValue(file_, &tag), "spill file is truncated");
+    switch (static_cast<TypeId>(tag)) {
+      case TypeId::Float: {
+        double val;
+        cqlAssert(getValue(file_, &val), "spill file is truncated");
+        data.push_back(DataBox(val));
+        break;
+      }
+      case TypeId::Bool: {
+        uint8_t val;
+        cqlAssert(getValue(file_, &val), "spill file is truncated");
+        data.push_back(DataBox(static_cast<bool>(val)));
+        break;
+      }
+      case TypeId::Char: {
+        uint32_t len;
+        cqlAssert(getValue(file_, &len), "spill file is truncated");
+        buffer_.resize(len);
+        cqlAssert(len == 0 || fread(&buffer_[0], 1, len, file_) == len, "spill file is truncated");
+        data.push_back(DataBox(TypeId::Char, buffer_));
+        break;
+      }
+      default:
+        data.push_back(DataBox(TypeId::INVALID, ""));
+        break;
+    }
+  }
+
+  *tuple = Tuple(schema, std::move(data));
+  return true;
+}
+
+}  // namespace cql
@@ -0,0 +1,75 @@
+/*****************************************************
+ * File: spill_file.h
+ * Author: Fudanyrd (email: yangrundong7@gmail.com)
+ *
+ * Temporary on-disk storage for tuples that do not
+ * fit into the memory budget of an executor.
+ *
+ * Row format(all integers in native byte order):
+ *   u32 number of columns, then for each column
+ *   u8 type tag followed by the payload:
+ *     Float: 8 bytes double
+ *     Bool:  1 byte
+ *     Char:  u32 length + raw bytes
+ *     INVALID: nothing
+ *****************************************************/
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+#include "schema.h"
+#include "tuple.h"
+
+namespace cql {
+
+class SpillFile {
+ private:
+  /** anonymous temporary file, removed when closed. */
+  FILE *file_{nullptr};
+  /** number of tuples written. */
+  size_t num_tuples_{0U};
+  /** number of bytes written. */
+  size_t num_bytes_{0U};
+  /** reuse the buffer when encoding/decoding a row. */
+  std::string buffer_;
+
+ public:
+  /**
+   * @brief create an empty spill file.
+   * @throws std::domain_error if no temporary file can be created.
+   */
+  SpillFile();
+  // disallow copy.
+  SpillFile(const SpillFile &that) = delete;
+  ~SpillFile();
+
+  /**
+   * @brief append a tuple to the end of the file.
+   */
+  void Append(const Tuple &tuple);
+
+  /**
+   * @brief flush the written tuples and start reading from the beginning.
+   */
+  void Rewind();
+
+  /**
+   * @param tuple[out] the next tuple in the file.
+   * @param schema: schema of the tuple read.
+   * @return false if reaching the end of file.
+   */
+  auto Read(Tuple *tuple, const Schema *schema) -> bool;
+
+  /**
+   * @return number of tuples in the file.
+   */
+  auto getNumTuples() const -> size_t { return num_tuples_; }
+
+  /**
+   * @return number of bytes in the file.
+   */
+  auto getNumBytes() const -> size_t { return num_bytes_; }
+};
+
+}  // namespace cql
@@ -0,0 +1,25 @@
+#include <iostream>
+#include "spill_file.h"
+
+using namespace std;  using namespace cql;
+
+auto main(int argc, char **argv) -> int {
+  Schema schema("name:char,age:float,ok:bool");
+  SpillFile file;
+  string temp;
+  Tuple tuple(&schema);
+
+  // spill every line read, then read them back.
+  while (getline(cin, temp)) {
+    tuple.load(temp);
+    file.Append(tuple);
+  }
+  cout << file.getNumTuples() << " tuple(s), " << file.getNumBytes() << " byte(s)" << endl;
+
+  file.Rewind();
+  while (file.Read(&tuple, &schema)) {
+    tuple.dump(cout);
+  }
+
+  return 0;
+}
@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cmath>
+
+#include "sketch.h"
+#include "stats.h"
+
+namespace cql {
+
+static auto lessThan(const DataBox &b1, const DataBox &b2) -> bool { return DataBox::LessThan(b1, b2).getBoolValue(); }
+
+/** @return true if no lower bound of the range rejects the value. */
+static auto aboveLo(const ColumnRange &range, const DataBox &val) -> bool {
+  if (range.lo_.getType() == TypeId::INVALID) { return true; }
+  return range.lo_inclusive_ ? !lessThan(val, range.lo_) : lessThan(range.lo_, val);
+}
+
+/** @return true if no upper bound of the range rejects the value. */
+static auto belowHi(const ColumnRange &range, const DataBox &val) -> bool {
+  if (range.hi_.getType() == TypeId::INVALID) { return true; }
+  return range.hi_inclusive_ ? !lessThan(range.hi_, val) : lessThan(val, range.hi_);
+}
+
+/** @return estimated fraction of the values of a bucket from lo to hi(not equal) in the range. */
+static auto bucketFraction(const ColumnRange &range, const DataBox &lo, const DataBox &hi) -> double {
+  if (aboveLo(range, lo) && belowHi(range, hi)) { return 1.0; }
+  if (!belowHi(range, lo) || !aboveLo(range, hi)) { return 0.0; }
+  if (lo.getType() != TypeId::Float) { return 0.5; }
+  // numbers: assume the values of the bucket are spread evenly.
+  double from = lo.getFloatValue(), to = hi.getFloatValue();
+  if (range.lo_.getType() != TypeId::INVALID) { from = std::max(from, range.lo_.getFloatValue()); }
+  if (range.hi_.getType() != TypeId::INVALID) { to = std::min(to, range.hi_.getFloatValue()); }
+  return std::max(0.0, to - from) / (hi.getFloatValue() - lo.getFloatValue());
+}
+
+auto TableStats::Analyze(const Table &table) -> std::shared_ptr<TableStats> {
+  auto stats = std::make_shared<TableStats>();
+  const Schema *schema = table.getSchema();
+  const std::vector<Tuple> &tuples = table.getTuples();
+  const size_t num_cols = schema->getNumCols();
+  stats->schema_ = schema;
+  stats->columns_.resize(num_cols);
+  std::vector<HyperLogLog> sketches(num_cols);
+  std::vector<std::vector<DataBox>> samples(num_cols);
+  const size_t stride = std::max(static_cast<size_t>(1), tuples.size() / STATS_SAMPLE_ROWS);
+
+  for (size_t row = 0; row < tuples.size(); ++row) {
+    if (tuples[row].isDeleted()) { continue; }
+    ++stats->rows_;
+    for (size_t col = 0; col < num_cols; ++col) {
+      ColumnStats &column = stats->columns_[col];
+      const DataBox val = tuples[row].getColumnData(col);
+      if (val.getType() == TypeId::INVALID) {
+        ++column.nulls_;
+        continue;
+      }
+      if (val.getType() != schema->getColumn(col).first) {
+        ++column.mismatched_;
+        continue;
+      }
+      sketches[col].Update(val);
+      if (row % stride == 0) { samples[col].push_back(val); }
+      // min and max, until the histogram is built.
+      if (column.bounds_.empty()) {
+        column.bounds_ = {val, val};
+      } else if (lessThan(val, column.bounds_[0])) {
+        column.bounds_[0] = val;
+      } else if (lessThan(column.bounds_[1], val)) {
+        column.bounds_[1] = val;
+      }
+    }
+  }
+
+  for (size_t col = 0; col < num_cols; ++col) {
+    ColumnStats &column = stats->columns_[col];
+    if (column.bounds_.empty()) { continue; }
+    const size_t values = stats->rows_ - column.nulls_ - column.mismatched_;
+    const double estimate = sketches[col].Result().getFloatValue();
+    column.distinct_ = std::min(values, std::max(static_cast<size_t>(1), static_cast<size_t>(estimate)));
+
+    std::vector<DataBox> &sample = samples[col];
+    if (sample.empty()) { sample = column.bounds_; }
+    std::sort(sample.begin(), sample.end(), lessThan);
+    const DataBox min = column.bounds_[0], max = column.bounds_[1];
+    const size_t buckets = std::min(STATS_BUCKETS, sample.size());
+    column.bounds_.resize(buckets + 1);
+    for (size_t i = 0; i <= buckets; ++i) { column.bounds_[i] = sample[i * (sample.size() - 1) / buckets]; }
+    // values not sampled may be out of the sampled bounds.
+    column.bounds_.front() = min;
+    column.bounds_.back() = max;
+  }
+  return stats;
+}
+
+auto TableStats::ValueFraction(size_t col) const -> double {
+  if (rows_ == 0) { return 0.0; }
+  const ColumnStats &column = columns_[col];
+  return static_cast<double>(rows_ - column.nulls_ - column.mismatched_) / static_cast<double>(rows_);
+}
+
+auto TableStats::HistogramFraction(const ColumnRange &range) const -> double {
+  const std::vector<DataBox> &bounds = columns_[range.col_].bounds_;
+  if (bounds.empty()) { return 0.0; }
+  // the predicate throws on bounds of other types, if there is any row.
+  const TypeId type = schema_->getColumn(range.col_).first;
+  if ((range.lo_.getType() != TypeId::INVALID && range.lo_.getType() != type)
+      || (range.hi_.getType() != TypeId::INVALID && range.hi_.getType() != type)) {
+    return DEFAULT_SELECTIVITY;
+  }
+
+  const size_t buckets = bounds.size() - 1;
+  const bool point = range.lo_.getType() != TypeId::INVALID && range.hi_.getType() != TypeId::INVALID
+                  && range.lo_inclusive_ && range.hi_inclusive_ && DataBox::Identical(range.lo_, range.hi_);
+  if (point) {
+    if (lessThan(range.lo_, bounds.front()) || lessThan(bounds.back(), range.lo_)) { return 0.0; }
+    // a value filling k buckets is frequent, with about k + 1 buckets of rows(half a bucket
+    // at each end of them); the other values share the rest evenly.
+    double frequent = 0.0;
+    size_t num_frequent = 0;
+    for (size_t i = 0; i < buckets; ) {
+      if (!DataBox::Identical(bounds[i], bounds[i + 1])) {
+        ++i;
+        continue;
+      }
+      size_t end = i;
+      while (end < buckets && DataBox::Identical(bounds[end], bounds[end + 1])) { ++end; }
+      const double share = std::min(1.0, static_cast<double>(end - i + 1) / static_cast<double>(buckets));
+      if (DataBox::Identical(bounds[i], range.lo_)) { return share; }
+      frequent += share;
+      ++num_frequent;
+      i = end;
+    }
+    const size_t distinct = columns_[range.col_].distinct_;
+    const size_t others = distinct > num_frequent ? distinct - num_frequent : 1;
+    return std::max(0.0, 1.0 - frequent) / static_cast<double>(others);
+  }
+
+  double fraction = 0.0;
+  for (size_t i = 0; i < buckets; ++i) {
+    if (DataBox::Identical(bounds[i], bounds[i + 1])) {
+      fraction += aboveLo(range, bounds[i]) && belowHi(range, bounds[i]) ? 1.0 : 0.0;
+    } else {
+      fraction += bucketFraction(range, bounds[i], bounds[i + 1]);
+    }
+  }
+  return fraction / static_cast<double>(buckets);
+}
+
+auto TableStats::RangeSelectivity(const ColumnRange &range) const -> double {
+  return ValueFraction(range.col_) * HistogramFraction(range);
+}
+
+auto TableStats::Selectivity(const AbstractExprRef &predicate) const -> double {
+  if (!static_cast<bool>(predicate)) { return 1.0; }
+  auto binary_ptr = dynamic_cast<const BinaryExpr *>(predicate.get());
+  if (static_cast<bool>(binary_ptr) && binary_ptr->optr_type_ == BinaryExprType::And) {
+    // assume the conjuncts are independent.
+    return Selectivity(binary_ptr->left_child_) * Selectivity(binary_ptr->right_child_);
+  }
+  if (static_cast<bool>(binary_ptr) && binary_ptr->optr_type_ == BinaryExprType::Or) {
+    const double left = Selectivity(binary_ptr->left_child_), right = Selectivity(binary_ptr->right_child_);
+    return left + right - left * right;
+  }
+  auto unary_ptr = dynamic_cast<const UnaryExpr *>(predicate.get());
+  if (static_cast<bool>(unary_ptr) && unary_ptr->optr_type_ == UnaryExprType::Not) {
+    return 1.0 - Selectivity(unary_ptr->child_);
+  }
+  auto col_ptr = dynamic_cast<const ColumnExpr *>(predicate.get());
+  if (static_cast<bool>(col_ptr)) {
+    // a boolean column is the predicate `<column> = true`.
+    ColumnRange range;
+    range.col_ = schema_->getColumnIdx(col_ptr->column_name_);
+    if (range.col_ == static_cast<size_t>(-1) || schema_->getColumn(range.col_).first != TypeId::Bool) {
+      return DEFAULT_SELECTIVITY;
+    }
+    range.lo_ = range.hi_ = DataBox(true);
+    return RangeSelectivity(range);
+  }
+
+  // `<column> op <const>`, op being one of = < <= > >= startswith.
+  std::vector<ColumnRange> ranges;
+  findColumnRanges(predicate, schema_, &ranges);
+  if (ranges.size() == 1) { return RangeSelectivity(ranges[0]); }
+  if (!static_cast<bool>(binary_ptr)) { return DEFAULT_SELECTIVITY; }
+  col_ptr = dynamic_cast<const ColumnExpr *>(binary_ptr->left_child_.get());
+  auto const_ptr = dynamic_cast<const ConstExpr *>(binary_ptr->right_child_.get());
+  if (binary_ptr->optr_type_ == BinaryExprType::NotEqualTo && !static_cast<bool>(col_ptr)) {
+    col_ptr = dynamic_cast<const ColumnExpr *>(binary_ptr->right_child_.get());
+    const_ptr = dynamic_cast<const ConstExpr *>(binary_ptr->left_child_.get());
+  }
+  const size_t col = static_cast<bool>(col_ptr) ? schema_->getColumnIdx(col_ptr->column_name_)
+                                                : static_cast<size_t>(-1);
+  if (col == static_cast<size_t>(-1)) { return DEFAULT_SELECTIVITY; }
+  if (binary_ptr->optr_type_ == BinaryExprType::NotEqualTo && static_cast<bool>(const_ptr)) {
+    ColumnRange range;
+    range.col_ = col;
+    range.lo_ = range.hi_ = const_ptr->data_;
+    return std::max(0.0, ValueFraction(col) - RangeSelectivity(range));
+  }
+  if (binary_ptr->optr_type_ == BinaryExprType::Like || binary_ptr->optr_type_ == BinaryExprType::Contains) {
+    return ValueFraction(col) * MATCH_SELECTIVITY;
+  }
+  return DEFAULT_SELECTIVITY;
+}
+
+void TableStats::printTo(std::ostream &os) const {
+  os << rows_ << " rows" << std::endl;
+  for (size_t col = 0; col < columns_.size(); ++col) {
+    const ColumnStats &column = columns_[col];
+    os << '#' << schema_->getColumn(col).second << ": " << column.nulls_ << " nulls, ~" << column.distinct_
+       << " distinct";
+    if (column.mismatched_ != 0) { os << ", " << column.mismatched_ << " mismatched"; }
+    if (!column.bounds_.empty()) {
+      os << ", min ";
+      column.bounds_.front().printTo(os);
+      os << ", median ";
+      column.bounds_[column.bounds_.size() / 2].printTo(os);
+      os << ", max ";
+      column.bounds_.back().printTo(os);
+    }
+    os << std::endl;
+  }
+}
+
+}  // namespace cql
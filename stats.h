@@ -0,0 +1,91 @@
+/*****************************************************
+ * File: stats.h
+ * Author: Fudanyrd (email: yangrundong7@gmail.com)
+ *
+ * Statistics of a table collected by `analyze`: the
+ * number of rows, and for each column the number of
+ * NULLs, an estimate of distinct values(HyperLogLog)
+ * and an equi-depth histogram of a sample of rows.
+ * The planner estimates from them how many rows a
+ * predicate accepts, a join yields, or groups are.
+ *****************************************************/
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "expr.h"
+#include "expr_util.h"
+#include "schema.h"
+#include "table.h"
+#include "type.h"
+#include "zone_map.h"
+
+namespace cql {
+
+/** number of buckets of the histogram of a column. */
+const size_t STATS_BUCKETS = 64;
+/** histograms are built from about this many rows, evenly spaced in the table. */
+const size_t STATS_SAMPLE_ROWS = 30000;
+/** fraction of rows a predicate the statistics know nothing about accepts. */
+const double DEFAULT_SELECTIVITY = 1.0 / 3;
+/** fraction of strings like/contains accept. */
+const double MATCH_SELECTIVITY = 0.1;
+
+/** Statistics of a column. */
+struct ColumnStats {
+  size_t nulls_{0U};        // number of NULLs.
+  size_t mismatched_{0U};   // number of values not of the type of the column.
+  size_t distinct_{0U};     // estimated number of distinct values of the type.
+  /**
+   * equi-depth histogram of the values of the type: bucket i is from bounds_[i] to bounds_[i + 1],
+   * all buckets hold about as many values. The first(last) bound is the min(max). Empty if no value.
+   */
+  std::vector<DataBox> bounds_;
+};
+
+class TableStats {
+ private:
+  /** schema of the table analyzed. */
+  const Schema *schema_{nullptr};
+  /** number of rows(not deleted) when analyzed. */
+  size_t rows_{0U};
+  std::vector<ColumnStats> columns_;
+
+  /**
+   * @return fraction of rows whose value of the column is of its type.
+   */
+  auto ValueFraction(size_t col) const -> double;
+
+  /**
+   * @return estimated fraction of the values of the type of a column in the range.
+   */
+  auto HistogramFraction(const ColumnRange &range) const -> double;
+
+ public:
+  /**
+   * @brief collect statistics of a table, all its columns materialized.
+   */
+  static auto Analyze(const Table &table) -> std::shared_ptr<TableStats>;
+
+  auto getRows() const -> size_t { return rows_; }
+  auto getColumn(size_t col) const -> const ColumnStats & { return columns_[col]; }
+
+  /**
+   * @return estimated fraction of rows with values of a column in the range.
+   */
+  auto RangeSelectivity(const ColumnRange &range) const -> double;
+
+  /**
+   * @return estimated fraction of rows a predicate over the table accepts.
+   */
+  auto Selectivity(const AbstractExprRef &predicate) const -> double;
+
+  /**
+   * @brief print the statistics, a line for each column.
+   */
+  void printTo(std::ostream &os) const;
+};
+
+}  // namespace cql
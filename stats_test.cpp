@@ -0,0 +1,48 @@
+#include <cmath>
+#include <iostream>
+#include "stats.h"
+
+using namespace std;  using namespace cql;
+
+/** @return the selectivity rounded to 2 digits. */
+static auto rounded(double selectivity) -> double { return std::round(selectivity * 100) / 100; }
+
+auto main(int argc, char **argv) -> int {
+  // #grp is 'hot' in half of the rows, one of 100 others in the rest; #flag is NULL in a tenth.
+  Table table("id:float,grp:char,flag:bool");
+  for (size_t i = 0; i < 100000; ++i) {
+    DataBox grp = i % 2 == 0 ? DataBox(TypeId::Char, "hot") : DataBox(TypeId::Char, "g" + to_string(i % 100));
+    DataBox flag = i % 10 == 0 ? DataBox(TypeId::INVALID, "") : DataBox(i % 4 == 1);
+    table.insertTuple({DataBox(static_cast<double>(i)), grp, flag});
+  }
+  for (size_t i = 0; i < 100; ++i) { table.deleteTuple(i); }
+  auto stats = TableStats::Analyze(table);
+  cout << "rows = " << stats->getRows() << endl;  // expect 99900.
+  cout << "nulls of #flag = " << stats->getColumn(2).nulls_ << endl;  // expect 9990.
+  const size_t distinct = stats->getColumn(0).distinct_;
+  cout << "distinct #id within 5%: " << (distinct > 94905 && distinct < 104895) << endl;  // expect 1.
+  cout << "distinct #grp = " << stats->getColumn(1).distinct_ << endl;  // expect 51.
+
+  ColumnRange range;
+  range.col_ = 0;
+  range.lo_ = DataBox(10000.0);
+  range.hi_ = DataBox(35000.0);
+  range.hi_inclusive_ = false;
+  cout << "#id in [10000, 35000): " << rounded(stats->RangeSelectivity(range)) << endl;  // expect 0.25.
+  range.col_ = 1;
+  range.lo_ = range.hi_ = DataBox(TypeId::Char, "hot");
+  range.hi_inclusive_ = true;
+  cout << "#grp = 'hot': " << rounded(stats->RangeSelectivity(range)) << endl;  // expect 0.5.
+  range.lo_ = range.hi_ = DataBox(TypeId::Char, "g7");
+  cout << "#grp = 'g7': " << rounded(stats->RangeSelectivity(range)) << endl;  // expect 0.01.
+  range.lo_ = range.hi_ = DataBox(TypeId::Char, "zzz");
+  cout << "#grp = 'zzz': " << rounded(stats->RangeSelectivity(range)) << endl;  // expect 0.
+
+  cout << "#flag: " << rounded(stats->Selectivity(toExprRef({"#flag"}))) << endl;  // expect 0.25.
+  cout << "#id < 50000 and #flag: "
+       << rounded(stats->Selectivity(toExprRef({"#id", "<", "50000", "and", "#flag"}))) << endl;  // expect 0.13.
+  cout << "#id >= 90000 or #id < 10000: "
+       << rounded(stats->Selectivity(toExprRef({"#id", ">=", "90000", "or", "#id", "<", "10000"})))
+       << endl;  // expect 0.19.
+  return 0;
+}
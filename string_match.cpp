@@ -0,0 +1,147 @@
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "string_match.h"
+
+namespace cql {
+
+/** @return true if the needle starts at hay[i], given its first and last bytes match. */
+static inline auto verify(const char *hay, size_t i, const char *needle, size_t m) -> bool {
+  return m <= 2 || std::memcmp(hay + i + 1, needle + 1, m - 2) == 0;
+}
+
+auto findSubstring(const char *hay, size_t n, const char *needle, size_t m) -> size_t {
+  if (m == 0) { return 0; }
+  if (m > n) { return n; }
+  if (m == 1) {
+    const void *found = std::memchr(hay, needle[0], n);
+    return found == nullptr ? n : static_cast<size_t>(static_cast<const char *>(found) - hay);
+  }
+
+  // candidates are starts i <= last.
+  const size_t last = n - m;
+  size_t i = 0;
+#if defined(__AVX2__)
+  const __m256i first32 = _mm256_set1_epi8(needle[0]);
+  const __m256i tail32 = _mm256_set1_epi8(needle[m - 1]);
+  for (; i + 32 <= last + 1; i += 32) {
+    const __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hay + i));
+    const __m256i block_tail = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hay + i + m - 1));
+    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+      _mm256_and_si256(_mm256_cmpeq_epi8(first32, block_first), _mm256_cmpeq_epi8(tail32, block_tail))));
+    for (; mask != 0; mask &= mask - 1) {
+      const size_t pos = i + __builtin_ctz(mask);
+      if (verify(hay, pos, needle, m)) { return pos; }
+    }
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i first16 = _mm_set1_epi8(needle[0]);
+  const __m128i tail16 = _mm_set1_epi8(needle[m - 1]);
+  for (; i + 16 <= last + 1; i += 16) {
+    const __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i));
+    const __m128i block_tail = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i + m - 1));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+      _mm_and_si128(_mm_cmpeq_epi8(first16, block_first), _mm_cmpeq_epi8(tail16, block_tail))));
+    for (; mask != 0; mask &= mask - 1) {
+      const size_t pos = i + __builtin_ctz(mask);
+      if (verify(hay, pos, needle, m)) { return pos; }
+    }
+  }
+#endif
+  // the rest(or all, without SIMD).
+  for (; i <= last; ++i) {
+    if (hay[i] == needle[0] && hay[i + m - 1] == needle[m - 1] && verify(hay, i, needle, m)) { return i; }
+  }
+  return n;
+}
+
+StringMatcher::StringMatcher(MatchType type, const std::string &pattern): type_(type), pattern_(pattern) {
+  if (type_ != MatchType::Like) { return; }
+  // NOTE: there is no escape character, '%' and '_' are always wildcards.
+  Segment segment;
+  for (char ch : pattern_) {
+    if (ch == '%') {
+      exact_ = false;
+      if (!segment.str_.empty()) { segments_.push_back(segment); }
+      segment = Segment();
+      continue;
+    }
+    segment.str_.push_back(ch);
+    segment.wildcard_ = segment.wildcard_ || ch == '_';
+  }
+  if (!segment.str_.empty() || exact_) { segments_.push_back(segment); }
+  anchor_front_ = pattern_.empty() || pattern_.front() != '%';
+  anchor_back_ = pattern_.empty() || pattern_.back() != '%';
+}
+
+auto StringMatcher::MatchAt(const std::string &text, size_t pos, const Segment &segment) -> bool {
+  if (!segment.wildcard_) {
+    return std::memcmp(text.data() + pos, segment.str_.data(), segment.str_.size()) == 0;
+  }
+  for (size_t i = 0; i < segment.str_.size(); ++i) {
+    if (segment.str_[i] != '_' && segment.str_[i] != text[pos + i]) { return false; }
+  }
+  return true;
+}
+
+auto StringMatcher::Search(const std::string &text, size_t pos, size_t end, const Segment &segment) -> size_t {
+  const size_t m = segment.str_.size();
+  if (end < pos || end - pos < m) { return std::string::npos; }
+  if (!segment.wildcard_) {
+    const size_t found = findSubstring(text.data() + pos, end - pos, segment.str_.data(), m);
+    return found == end - pos ? std::string::npos : pos + found;
+  }
+  for (size_t i = pos; i + m <= end; ++i) {
+    if (MatchAt(text, i, segment)) { return i; }
+  }
+  return std::string::npos;
+}
+
+auto StringMatcher::MatchLike(const std::string &text) const -> bool {
+  const size_t n = text.size();
+  if (exact_) {
+    return n == segments_[0].str_.size() && MatchAt(text, 0, segments_[0]);
+  }
+
+  size_t first = 0, last = segments_.size();
+  size_t pos = 0, end = n;
+  if (anchor_front_ && first < last) {
+    const Segment &segment = segments_[first++];
+    if (n < segment.str_.size() || !MatchAt(text, 0, segment)) { return false; }
+    pos = segment.str_.size();
+  }
+  if (anchor_back_ && first < last) {
+    const Segment &segment = segments_[--last];
+    if (n - pos < segment.str_.size() || !MatchAt(text, n - segment.str_.size(), segment)) { return false; }
+    end = n - segment.str_.size();
+  }
+  // the leftmost match of each segment leaves the most room for the rest.
+  for (size_t i = first; i < last; ++i) {
+    const size_t found = Search(text, pos, end, segments_[i]);
+    if (found == std::string::npos) { return false; }
+    pos = found + segments_[i].str_.size();
+  }
+  return true;
+}
+
+auto StringMatcher::Matches(const std::string &text) const -> bool {
+  switch (type_) {
+    case MatchType::Like:
+      return MatchLike(text);
+    case MatchType::Contains:
+      return pattern_.empty()
+          || findSubstring(text.data(), text.size(), pattern_.data(), pattern_.size()) != text.size();
+    case MatchType::StartsWith:
+      return text.size() >= pattern_.size() && std::memcmp(text.data(), pattern_.data(), pattern_.size()) == 0;
+  }
+  return false;
+}
+
+}  // namespace cql
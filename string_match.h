@@ -0,0 +1,71 @@
+/*****************************************************
+ * File: string_match.h
+ * Author: Fudanyrd (email: yangrundong7@gmail.com)
+ *
+ * Matching strings against the patterns of like,
+ * contains and startswith. Substrings are searched
+ * for 16(or 32) bytes at a time: positions where both
+ * the first and the last byte of the needle match are
+ * found by SIMD compares, then verified by memcmp.
+ *****************************************************/
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace cql {
+
+enum class MatchType {
+  Like,         // '%' matches any string, '_' any character.
+  Contains,     // the pattern is a substring.
+  StartsWith,   // the pattern is a prefix.
+};
+
+/**
+ * @return position of the first occurrence of needle in hay, n if none.
+ * @param n: length of hay.
+ * @param m: length of needle.
+ */
+auto findSubstring(const char *hay, size_t n, const char *needle, size_t m) -> size_t;
+
+/**
+ * A pattern compiled for matching many strings.
+ */
+class StringMatcher {
+ private:
+  /** a piece of a like pattern between two '%'. */
+  struct Segment {
+    std::string str_;
+    /** has '_', so it cannot be searched for by findSubstring. */
+    bool wildcard_{false};
+  };
+
+  MatchType type_;
+  std::string pattern_;
+  /** like: the pattern split on '%', empty pieces dropped. */
+  std::vector<Segment> segments_;
+  /** like: the first(last) segment is at the start(end) of the string. */
+  bool anchor_front_{true};
+  bool anchor_back_{true};
+  /** like: the pattern has no '%'. */
+  bool exact_{true};
+
+  /** @return true if segment matches text at pos(the text is long enough). */
+  static auto MatchAt(const std::string &text, size_t pos, const Segment &segment) -> bool;
+
+  /** @return first position no less than pos where the segment starts and ends no later than end, npos if none. */
+  static auto Search(const std::string &text, size_t pos, size_t end, const Segment &segment) -> size_t;
+
+  auto MatchLike(const std::string &text) const -> bool;
+
+ public:
+  StringMatcher(MatchType type, const std::string &pattern);
+
+  auto getType() const -> MatchType { return type_; }
+  auto getPattern() const -> const std::string & { return pattern_; }
+
+  /** @return true if text matches the pattern. */
+  auto Matches(const std::string &text) const -> bool;
+};
+
+}  // namespace cql
@@ -0,0 +1,55 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "string_match.h"
+
+using namespace std;  using namespace cql;
+
+/** @return true if text matches a like pattern, by backtracking. */
+static auto likeMatch(const char *text, const char *pattern) -> bool {
+  if (*pattern == '\0') { return *text == '\0'; }
+  if (*pattern == '%') { return likeMatch(text, pattern + 1) || (*text != '\0' && likeMatch(text + 1, pattern)); }
+  return *text != '\0' && (*pattern == '_' || *pattern == *text) && likeMatch(text + 1, pattern + 1);
+}
+
+/** @return a random string of n characters from the first k letters. */
+static auto randomStr(size_t n, int k) -> string {
+  string res;
+  for (size_t i = 0; i < n; ++i) { res.push_back(static_cast<char>('a' + rand() % k)); }
+  return res;
+}
+
+auto main(int argc, char **argv) -> int {
+  // texts longer than 32 bytes go through the SIMD loops, the tail through the scalar one.
+  srand(42);
+  size_t wrong = 0;
+  for (size_t t = 0; t < 20000; ++t) {
+    string hay = randomStr(rand() % 100, 3);
+    string needle = randomStr(rand() % 6, 3);
+    size_t expect = hay.find(needle);
+    if (expect == string::npos) { expect = hay.size(); }
+    wrong += findSubstring(hay.data(), hay.size(), needle.data(), needle.size()) != expect;
+  }
+  cout << "find substring: " << wrong << endl;  // expect 0.
+
+  StringMatcher contains(MatchType::Contains, "needle");
+  StringMatcher starts(MatchType::StartsWith, "hay");
+  string text = string(70, 'h') + "needl" + string(30, 'x') + "needle";
+  cout << "contains: " << contains.Matches(text) << contains.Matches(text.substr(0, text.size() - 1))
+       << endl;  // expect 10.
+  cout << "startswith: " << starts.Matches("haystack") << starts.Matches("ha") << starts.Matches("stack")
+       << endl;  // expect 100.
+
+  const string patterns[] = {"", "%", "%%", "a", "_", "a%", "%a", "%a%", "a%b", "a_b", "%ab%ba%", "_%_", "a%a%a",
+                             "%b_a", "ab%%c", "%_b_%", "abc"};
+  wrong = 0;
+  for (const auto &pattern : patterns) {
+    StringMatcher like(MatchType::Like, pattern);
+    for (size_t t = 0; t < 2000; ++t) {
+      string str = randomStr(rand() % 40, 3);
+      wrong += like.Matches(str) != likeMatch(str.c_str(), pattern.c_str());
+    }
+  }
+  cout << "like: " << wrong << endl;  // expect 0.
+  return 0;
+}
@@ -54,7 +54,13 @@ auto splitBy(const std::vector<std::string> &words, const std::string &separator
   size_t i = begin, j;
   while (i < end) {
     j = i;
-    while (j < end && words[j] != separator) { ++j; }
+    // separators inside parentheses(eg. between arguments of a function) don't split.
+    int depth = 0;
+    while (j < end && (depth > 0 || words[j] != separator)) {
+      if (words[j] == "(") { ++depth; }
+      if (words[j] == ")") { --depth; }
+      ++j;
+    }
     res.push_back({i, j});
     i = j + 1;
   }
@@ -1,12 +1,23 @@
+#include <algorithm>
 #include <fstream>
 #include <stdexcept>
 #include "table.h"
 
 namespace cql {
 
+/** bytes of a .csv file a lazy table reads at once. */
+static const size_t LAZY_BLOCK_SIZE = 1 << 20;
+
 auto Table::load(const std::string &filename) -> size_t {
   // clear initial data.
   tuples_.clear();
+  clustered_.clear();
+  indexes_.clear();
+  stats_.reset();
+  lazy_ = false;
+  filename_.clear();
+  row_offsets_.clear();
+  parsed_.clear();
   std::string header;
   std::fstream fin(filename.c_str());
   if (!fin.is_open()) {
@@ -27,12 +38,211 @@ auto Table::load(const std::string &filename) -> size_t {
     tuples_[count].load(row);
     ++count;
   }
+  zones_.Build(&schema_, tuples_);
 
   // return the number of tuples read from file.
   return count;
 }
 
+auto Table::loadLazy(const std::string &filename) -> size_t {
+  std::string header;
+  std::ifstream fin(filename.c_str(), std::ios::binary);
+  if (!fin.is_open()) {
+    throw std::domain_error("cannot open file");
+  }
+  if (!getline(fin, header)) {
+    throw std::domain_error("cannot fetch header");
+  }
+  schema_ = Schema(header);
+  tuples_.clear();
+  clustered_.clear();
+  indexes_.clear();
+  stats_.reset();
+
+  // rows are lines, like getline: a last line without '\n' counts if not empty.
+  filename_ = filename;
+  data_begin_ = static_cast<size_t>(fin.tellg());
+  row_offsets_.clear();
+  std::vector<char> block(LAZY_BLOCK_SIZE);
+  size_t pos = 0;
+  bool in_row = false;
+  while (fin.read(block.data(), static_cast<std::streamsize>(block.size())) || fin.gcount() > 0) {
+    const size_t bytes = static_cast<size_t>(fin.gcount());
+    for (size_t i = 0; i < bytes; ++i) {
+      if (!in_row) { row_offsets_.push_back(pos + i); }
+      in_row = block[i] != '\n';
+    }
+    pos += bytes;
+  }
+  data_size_ = pos;
+  const size_t count = row_offsets_.size();
+  row_offsets_.push_back(in_row ? pos + 1 : pos);
+  tuples_.assign(count, Tuple(&schema_));
+  zones_.Build(&schema_, tuples_, false);
+  parsed_.assign(schema_.getNumCols(), false);
+  lazy_ = true;
+  if (count == 0) { Materialize(); }
+  return count;
+}
+
+void Table::Materialize(const std::vector<size_t> &cols) {
+  if (!lazy_) { return; }
+  // columns to parse now.
+  std::vector<bool> wanted(parsed_.size(), false);
+  size_t last = 0;
+  bool any = false;
+  for (size_t col : cols) {
+    if (col < parsed_.size() && !parsed_[col]) {
+      wanted[col] = true;
+      last = std::max(last, col);
+      any = true;
+    }
+  }
+  if (!any) { return; }
+
+  std::ifstream fin(filename_.c_str(), std::ios::binary);
+  if (!fin.is_open()) {
+    throw std::domain_error("cannot open file");
+  }
+  fin.seekg(0, std::ios::end);
+  if (static_cast<size_t>(fin.tellg()) != data_begin_ + data_size_) {
+    throw std::domain_error("file of a lazy table changed since loaded?? Impossible!");
+  }
+  const size_t rows = row_offsets_.size() - 1;
+  std::string block;
+  for (size_t first = 0; first < rows;) {
+    // read a block of whole rows(at least one).
+    size_t stop = std::upper_bound(row_offsets_.begin() + first, row_offsets_.end(), 
+                                   row_offsets_[first] + LAZY_BLOCK_SIZE) - row_offsets_.begin() - 1;
+    stop = std::max(stop, first + 1);
+    const size_t base = row_offsets_[first];
+    block.resize(std::min(row_offsets_[stop], data_size_) - base);
+    fin.seekg(static_cast<std::streamoff>(data_begin_ + base));
+    fin.read(&block[0], static_cast<std::streamsize>(block.size()));
+
+    for (size_t row = first; row < stop; ++row) {
+      // fields are split like Tuple::load: empty fields are skipped.
+      size_t pos = row_offsets_[row] - base;
+      const size_t end = row_offsets_[row + 1] - 1 - base;
+      size_t col = 0;
+      while (pos < end && col <= last) {
+        size_t next = pos;
+        while (next < end && block[next] != ',') { ++next; }
+        if (next > pos) {
+          if (wanted[col]) {
+            tuples_[row].fill(col, DataBox(schema_.getColumn(col).first, block.substr(pos, next - pos)));
+          }
+          ++col;
+        }
+        pos = next + 1;
+      }
+    }
+    first = stop;
+  }
+
+  bool all = true;
+  for (size_t col = 0; col < parsed_.size(); ++col) {
+    if (wanted[col]) {
+      parsed_[col] = true;
+      zones_.BuildColumn(tuples_, col);
+    }
+    all = all && parsed_[col];
+  }
+  clustered_.clear();
+  if (all) {
+    lazy_ = false;
+    filename_.clear();
+    std::vector<size_t>().swap(row_offsets_);
+  }
+}
+
+void Table::Materialize() {
+  std::vector<size_t> cols;
+  for (size_t col = 0; col < schema_.getNumCols(); ++col) { cols.push_back(col); }
+  Materialize(cols);
+  lazy_ = false;
+}
+
+void Table::createIndex(const std::string &name, size_t col, IndexType type, bool unique) {
+  for (const auto &index : indexes_) {
+    if (index->getName() == name) {
+      throw std::domain_error(("index " + name + " already exists?? Impossible!").c_str());
+    }
+  }
+  if (col >= schema_.getNumCols()) {
+    throw std::domain_error("indexing a column out of range?? Impossible!");
+  }
+  Materialize({col});
+  switch (type) {
+    case IndexType::BTree:
+      indexes_.push_back(std::make_shared<BTreeIndex>(name, col, schema_.getColumn(col).first, tuples_, unique));
+      break;
+    case IndexType::Hash:
+      indexes_.push_back(std::make_shared<HashIndex>(name, col, schema_.getColumn(col).first, tuples_, unique));
+      break;
+    case IndexType::Bitmap:
+      indexes_.push_back(std::make_shared<BitmapIndex>(name, col, schema_.getColumn(col).first, tuples_, unique));
+      break;
+    case IndexType::Trigram:
+      indexes_.push_back(std::make_shared<TrigramIndex>(name, col, schema_.getColumn(col).first, tuples_, unique));
+      break;
+    case IndexType::Cracker:
+      indexes_.push_back(std::make_shared<CrackerIndex>(name, col, schema_.getColumn(col).first, tuples_, unique));
+      break;
+  }
+}
+
+void Table::dropIndexes(IndexType type) {
+  std::vector<TableIndexRef> kept;
+  for (const auto &index : indexes_) {
+    if (index->getIndexType() != type) { kept.push_back(index); }
+  }
+  indexes_.swap(kept);
+}
+
+auto Table::findIndex(size_t col, IndexType type) const -> const TableIndex * {
+  for (const auto &index : indexes_) {
+    if (index->getColumn() == col && index->getIndexType() == type) { return index.get(); }
+  }
+  return nullptr;
+}
+
+/**
+ * @return -1, 0, 1 if t1 is less than, equal to, greater than t2 on the columns;
+ * 2 if they are not comparable.
+ */
+static auto compareOn(const Tuple &t1, const Tuple &t2, const std::vector<size_t> &cols) -> int {
+  for (size_t col : cols) {
+    DataBox b1 = t1.getColumnData(col);
+    DataBox b2 = t2.getColumnData(col);
+    if (DataBox::Identical(b1, b2)) { continue; }
+    if (b1.getType() != b2.getType() || b1.getType() == TypeId::INVALID) { return 2; }
+    return DataBox::LessThan(b1, b2).getBoolValue() ? -1 : 1;
+  }
+  return 0;
+}
+
+auto Table::SortOrder(const std::vector<size_t> &cols) const -> int {
+  auto iter = clustered_.find(cols);
+  if (iter != clustered_.end()) { return iter->second; }
+
+  bool ascending = true;
+  bool descending = true;
+  for (size_t row = 1; row < tuples_.size() && (ascending || descending); ++row) {
+    int cmp = compareOn(tuples_[row - 1], tuples_[row], cols);
+    if (cmp == 2) { ascending = descending = false; }
+    if (cmp == 1) { ascending = false; }
+    if (cmp == -1) { descending = false; }
+  }
+  int order = (ascending ? ASCENDING : 0) | (descending ? DESCENDING : 0);
+  clustered_[cols] = order;
+  return order;
+}
+
 void Table::dump(std::ostream &os) const {
+  if (lazy_) {
+    throw std::domain_error("dumping a table not fully loaded?? Impossible!");
+  }
   schema_.printTo(os);
   for (const auto &tuple : tuples_) {
     tuple.dump(os);
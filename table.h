@@ -1,22 +1,62 @@
 #pragma once
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
+#include "index.h"
 #include "schema.h"
 #include "tuple.h"
+#include "zone_map.h"
 
 // we assume that a table can fit perfectly into the memory.
 namespace cql {
 
+class TableStats;
+
 // a in-memory table manager
 class Table {
  private:
   Schema schema_;               // schema of the table.
   std::vector<Tuple> tuples_;   // tuples of the table.
+  /** cache of SortOrder(cleared when the table is modified). */
+  mutable std::map<std::vector<size_t>, int> clustered_;
+  /** min/max/null count of columns in each block of rows. */
+  ZoneMap zones_;
+  /** secondary indexes, kept up to date on insert, update and delete. */
+  std::vector<TableIndexRef> indexes_;
+  /**
+   * if lazily loaded, columns are parsed from the .csv file on first access. Only where rows begin is
+   * kept(8 bytes a row, not the text of the file): each materialization reads the file again, in blocks,
+   * and fails if its size changed since.
+   */
+  bool lazy_{false};
+  /** the .csv file, and where its rows(after the header) begin and how many bytes they take. */
+  std::string filename_;
+  size_t data_begin_{0U};
+  size_t data_size_{0U};
+  /** row i is bytes [row_offsets_[i], row_offsets_[i + 1] - 1) of the rows, the last offset is a sentinel. */
+  std::vector<size_t> row_offsets_;
+  /** parsed_[c] is true if column c is parsed from the file. */
+  std::vector<bool> parsed_;
+  /** statistics of the last analyze, nullptr if never analyzed. */
+  std::shared_ptr<const TableStats> stats_;
+
+  /** bits of SortOrder. */
+  static const int ASCENDING = 1;
+  static const int DESCENDING = 2;
+
+  /**
+   * @return the orders the table is sorted in on the columns:
+   * ASCENDING | DESCENDING if all equal, 0 if not sorted.
+   */
+  auto SortOrder(const std::vector<size_t> &cols) const -> int;
 
  public:
-  Table() = default;
-  Table(const Schema &schema): schema_(schema) {} 
-  Table(const std::string &header): schema_({header}) {}
+  Table() { zones_.Build(&schema_, tuples_); }
+  Table(const Schema &schema): schema_(schema) { zones_.Build(&schema_, tuples_); }
+  Table(const std::string &header): schema_({header}) { zones_.Build(&schema_, tuples_); }
   ~Table() = default;
 
   /**
@@ -27,7 +67,30 @@ class Table {
   auto load(const std::string &filename) -> size_t;
 
   /**
-   * @brief dump to a .csv file.
+   * @brief load from a .csv file lazily: only find where rows begin,
+   * a column is parsed when first materialized.
+   * @return number of tuples in the file.
+   */
+  auto loadLazy(const std::string &filename) -> size_t;
+
+  /**
+   * @brief parse the columns from the .csv file, if not yet.
+   * Columns not materialized read as NULL.
+   */
+  void Materialize(const std::vector<size_t> &cols);
+
+  /**
+   * @brief parse all columns, and forget the .csv file.
+   */
+  void Materialize();
+
+  /**
+   * @return true if all columns are parsed.
+   */
+  auto isMaterialized() const -> bool { return !lazy_; }
+
+  /**
+   * @brief dump to a .csv file. All columns must be materialized.
    */
   void dump(std::ostream &os) const;
 
@@ -41,6 +104,21 @@ class Table {
    */
   auto getTuples() const -> const std::vector<Tuple> & { return tuples_; }
 
+  /**
+   * @return statistics of blocks of rows.
+   */
+  auto getZoneMap() const -> const ZoneMap & { return zones_; }
+
+  /**
+   * @return statistics of the last analyze(not updated on insert, update and delete), nullptr if none.
+   */
+  auto getStats() const -> const TableStats * { return stats_.get(); }
+
+  /**
+   * @brief keep the statistics of an analyze.
+   */
+  void setStats(const std::shared_ptr<const TableStats> &stats) { stats_ = stats; }
+
   /**
    * @return number of rows in the table.
    */
@@ -49,19 +127,87 @@ class Table {
   /**
    * @brief insert a tuple into the table.
    */
-  void insertTuple(const std::vector<DataBox> &data) { tuples_.push_back(Tuple(&schema_, data)); }
+  void insertTuple(const std::vector<DataBox> &data) {
+    Tuple tuple(&schema_, data);
+    for (const auto &index : indexes_) {
+      if (!index->Admits(tuple.getColumnData(index->getColumn()))) {
+        throw std::domain_error(("duplicate key in unique index " + index->getName() + "?? Impossible!").c_str());
+      }
+    }
+    tuples_.push_back(std::move(tuple));
+    zones_.Append(tuples_.back());
+    for (const auto &index : indexes_) {
+      index->Insert(tuples_.back().getColumnData(index->getColumn()), tuples_.size() - 1);
+    }
+    clustered_.clear();
+  }
 
   /**
    * @brief delete the tuple on index.
    */
-  auto deleteTuple(size_t idx) -> bool { return tuples_[idx].markDelete(); }
+  auto deleteTuple(size_t idx) -> bool {
+    if (!tuples_[idx].markDelete()) { return false; }
+    zones_.Delete(idx);
+    for (const auto &index : indexes_) {
+      index->Erase(tuples_[idx].getColumnData(index->getColumn()), idx);
+    }
+    return true;
+  }
 
   /**
    * @brief update the column of a tuple.
    */
   auto updateTuple(const DataBox &box, size_t row, size_t col) -> bool {
-    return tuples_[row].update(box, col);
+    clustered_.clear();
+    const DataBox old_val = tuples_[row].getColumnData(col);
+    for (const auto &index : indexes_) {
+      if (index->getColumn() != col || tuples_[row].isDeleted() || DataBox::Identical(old_val, box)) { continue; }
+      if (!index->Admits(box)) {
+        throw std::domain_error(("duplicate key in unique index " + index->getName() + "?? Impossible!").c_str());
+      }
+    }
+    if (!tuples_[row].update(box, col)) { return false; }
+    zones_.Update(row, col, old_val, box);
+    for (const auto &index : indexes_) {
+      if (index->getColumn() != col) { continue; }
+      index->Erase(old_val, row);
+      index->Insert(box, row);
+    }
+    return true;
   }
+
+  /**
+   * @brief build an index on a column.
+   * @param unique: reject rows with a key some row has.
+   * @throw domain_error if the table has an index of the name, or a unique index finds duplicate keys.
+   */
+  void createIndex(const std::string &name, size_t col, IndexType type, bool unique = false);
+
+  /**
+   * @brief drop the indexes of a type.
+   */
+  void dropIndexes(IndexType type);
+
+  /**
+   * @return the indexes of the table.
+   */
+  auto getIndexes() const -> const std::vector<TableIndexRef> & { return indexes_; }
+
+  /**
+   * @return an index of a type on a column, nullptr if none.
+   */
+  auto findIndex(size_t col, IndexType type) const -> const TableIndex *;
+
+  /**
+   * @return true if tuples with equal values on the columns are adjacent,
+   * ie. the table is sorted(ascending or descending) on them.
+   */
+  auto isClusteredOn(const std::vector<size_t> &cols) const -> bool { return SortOrder(cols) != 0; }
+
+  /**
+   * @return true if the table is sorted ascending on the columns.
+   */
+  auto isSortedOn(const std::vector<size_t> &cols) const -> bool { return (SortOrder(cols) & ASCENDING) != 0; }
 };
 
 /** Useful collection of a table information */
@@ -9,5 +9,16 @@ auto main(int argc, char **argv) -> int {
   cout << table.load("test.csv") << endl;
   table.dump(cout);
 
+  // a lazy table reads NULL from columns not materialized.
+  Table lazy;
+  cout << lazy.loadLazy("test.csv") << endl;
+  lazy.Materialize({0});
+  if (lazy.getNumRows() > 0) {
+    lazy.getTuples()[0].getColumnData(0).printTo(cout);
+    cout << endl;
+  }
+  lazy.Materialize();
+  lazy.dump(cout);
+
   return 0;
 }
\ No newline at end of file
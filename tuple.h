@@ -1,5 +1,6 @@
 #pragma once
 #include <iostream>
+#include <utility>
 #include <vector>
 
 #include "schema.h"
@@ -19,6 +20,7 @@ class Tuple {
   Tuple() = default;
   Tuple(const Schema *schema): schema_(schema) {}
   Tuple(const Schema *schema, const std::vector<DataBox> &data): data_(data), schema_(schema) {}
+  Tuple(const Schema *schema, std::vector<DataBox> &&data): data_(std::move(data)), schema_(schema) {}
 
   /**
    * @brief load data from string(displaying a line from .csv files)
@@ -45,6 +47,15 @@ class Tuple {
    */
   auto getSize() const -> size_t { return data_.size(); }
 
+  /**
+   * @return approximate number of bytes occupied by the tuple.
+   */
+  auto getMemorySize() const -> size_t {
+    size_t size = sizeof(Tuple);
+    for (const auto &box : data_) { size += box.getMemorySize(); }
+    return size;
+  }
+
   /**
    * @return the data at a given column, INVALID value if out of range.
    */
@@ -68,6 +79,14 @@ class Tuple {
     */
   auto isDeleted() const -> bool { return is_deleted_; }
 
+  /**
+   * @brief set the value of a column, growing the tuple if it is shorter(columns are loaded lazily).
+   */
+  void fill(size_t col_idx, DataBox &&box) {
+    if (data_.size() <= col_idx) { data_.resize(col_idx + 1); }
+    data_[col_idx] = std::move(box);
+  }
+
   /**
    * Update the value of a column.
    * @param col_idx: column index to update.
@@ -1,4 +1,6 @@
 #include <cmath>
+#include <cstring>
+#include <functional>
 #include <sstream>
 
 #include "type.h"
@@ -119,6 +121,54 @@ auto DataBox::NotEqualTo(const DataBox &b1, const DataBox &b2) -> DataBox {
   }
 }
 
+/**
+ * @brief finalizer of splitmix64, spreads the bits of a 64-bit value.
+ */
+static auto mix64(uint64_t x) -> uint64_t {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+auto DataBox::Hash(const DataBox &b) -> uint64_t {
+  uint64_t bits = 0;
+  switch(b.type_) {
+    case TypeId::Char:
+      bits = std::hash<std::string>()(b.str_dat_);
+      break;
+    case TypeId::Float: {
+      // 0.0 and -0.0 are equal, so they must hash the same.
+      double val = b.float_dat_ == 0.0 ? 0.0 : b.float_dat_;
+      memcpy(&bits, &val, sizeof(bits));
+      break;
+    }
+    case TypeId::Bool:
+      bits = b.real_ ? 1 : 0;
+      break;
+    case TypeId::INVALID:
+      break;
+  }
+  return mix64(bits ^ (static_cast<uint64_t>(b.type_) << 56));
+}
+
+auto DataBox::Identical(const DataBox &b1, const DataBox &b2) -> bool {
+  if (b1.type_ != b2.type_) { return false; }
+  switch(b1.type_) {
+    case TypeId::Char:
+      return b1.str_dat_ == b2.str_dat_;
+    case TypeId::Float:
+      return b1.float_dat_ == b2.float_dat_;
+    case TypeId::Bool:
+      return b1.real_ == b2.real_;
+    case TypeId::INVALID:
+      return true;
+  }
+  return false;
+}
+
 auto DataBox::toStr(const DataBox &b) -> DataBox {
   std::ostringstream oss;  
   oss << b.getFloatValue();
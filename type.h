@@ -1,5 +1,6 @@
 #pragma once
 #include <cmath>
+#include <cstdint>
 #include <ios>
 #include <iostream>
 #include <stdexcept>
@@ -48,9 +49,14 @@ class DataBox {
 
   auto getType() const -> TypeId { return type_; }
   auto getFloatValue() const -> double { return float_dat_; }
-  auto getStrValue() const -> std::string { return str_dat_; }
+  auto getStrValue() const -> const std::string & { return str_dat_; }
   auto getBoolValue() const -> bool { return real_; }
 
+  /**
+   * @return approximate number of bytes occupied by the box.
+   */
+  auto getMemorySize() const -> size_t { return sizeof(DataBox) + str_dat_.size(); }
+
   /**
    * @throws std::domain_error if two boxes hold different types.
    */
@@ -70,6 +76,18 @@ class DataBox {
   static auto EqualTo(const DataBox &b1, const DataBox &b2) -> DataBox;
   static auto NotEqualTo(const DataBox &b1, const DataBox &b2) -> DataBox;
 
+  ///////////////////////////
+  // Hashing
+  ///////////////////////////
+  /**
+   * @return hash value of the box; boxes of different types hash differently.
+   */
+  static auto Hash(const DataBox &b) -> uint64_t;
+  /**
+   * @return true if two boxes have the same type and value(never throws).
+   */
+  static auto Identical(const DataBox &b1, const DataBox &b2) -> bool;
+
   ///////////////////////////
   // Type Casting 
   ///////////////////////////
@@ -81,4 +99,14 @@ class DataBox {
   void printTo(std::ostream &os) const;
 };
 
+/** Hash functor for unordered containers keyed on DataBox. */
+struct BoxHash {
+  auto operator()(const DataBox &box) const -> size_t { return static_cast<size_t>(DataBox::Hash(box)); }
+};
+
+/** Equality functor for unordered containers keyed on DataBox. */
+struct BoxEqual {
+  auto operator()(const DataBox &b1, const DataBox &b2) const -> bool { return DataBox::Identical(b1, b2); }
+};
+
 }  // namespace cql
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "zone_map.h"
+
+namespace cql {
+
+void ZoneMap::Fold(Zone *zone, size_t col, const DataBox &val) const {
+  if (val.getType() == TypeId::INVALID) {
+    ++zone->null_count_;
+    return;
+  }
+  if (val.getType() != schema_->getColumn(col).first) {
+    zone->mixed_ = true;
+    return;
+  }
+  if (zone->min_.getType() == TypeId::INVALID || DataBox::LessThan(val, zone->min_).getBoolValue()) {
+    zone->min_ = val;
+  }
+  if (zone->max_.getType() == TypeId::INVALID || DataBox::GreaterThan(val, zone->max_).getBoolValue()) {
+    zone->max_ = val;
+  }
+}
+
+void ZoneMap::Build(const Schema *schema, const std::vector<Tuple> &tuples, bool known) {
+  schema_ = schema;
+  num_cols_ = schema->getNumCols();
+  num_rows_ = tuples.size();
+  const size_t num_blocks = (num_rows_ + ZONE_ROWS - 1) / ZONE_ROWS;
+  zones_.assign(num_blocks * num_cols_, Zone());
+  live_.assign(num_blocks, 0);
+  known_.assign(num_cols_, false);
+  for (size_t row = 0; row < num_rows_; ++row) {
+    if (!tuples[row].isDeleted()) { ++live_[row / ZONE_ROWS]; }
+  }
+  if (known) {
+    for (size_t col = 0; col < num_cols_; ++col) { BuildColumn(tuples, col); }
+  }
+}
+
+void ZoneMap::BuildColumn(const std::vector<Tuple> &tuples, size_t col) {
+  for (size_t block = 0; block < live_.size(); ++block) {
+    zones_[block * num_cols_ + col] = Zone();
+  }
+  for (size_t row = 0; row < num_rows_; ++row) {
+    Fold(&zones_[row / ZONE_ROWS * num_cols_ + col], col, tuples[row].getColumnData(col));
+  }
+  known_[col] = true;
+}
+
+void ZoneMap::Append(const Tuple &tuple) {
+  if (num_rows_ % ZONE_ROWS == 0) {
+    zones_.resize(zones_.size() + num_cols_);
+    live_.push_back(0);
+  }
+  const size_t block = num_rows_++ / ZONE_ROWS;
+  ++live_[block];
+  for (size_t col = 0; col < num_cols_; ++col) {
+    if (known_[col]) { Fold(&zones_[block * num_cols_ + col], col, tuple.getColumnData(col)); }
+  }
+}
+
+void ZoneMap::Update(size_t row, size_t col, const DataBox &old_val, const DataBox &new_val) {
+  if (!known_[col]) { return; }
+  Zone &zone = zones_[row / ZONE_ROWS * num_cols_ + col];
+  if (old_val.getType() == TypeId::INVALID) { --zone.null_count_; }
+  Fold(&zone, col, new_val);
+}
+
+void ZoneMap::Delete(size_t row) {
+  --live_[row / ZONE_ROWS];
+}
+
+auto ZoneMap::MayMatch(size_t block, const std::vector<ColumnRange> &ranges) const -> bool {
+  if (live_[block] == 0) { return false; }
+  for (const auto &range : ranges) {
+    if (!known_[range.col_]) { continue; }
+    const Zone &zone = zones_[block * num_cols_ + range.col_];
+    if (zone.mixed_) { continue; }
+    // only NULLs, which no comparison accepts.
+    if (zone.min_.getType() == TypeId::INVALID) { return false; }
+    const DataBox &lo = range.lo_;
+    if (lo.getType() == zone.max_.getType()) {
+      if (DataBox::LessThan(zone.max_, lo).getBoolValue()) { return false; }
+      if (!range.lo_inclusive_ && DataBox::EqualTo(zone.max_, lo).getBoolValue()) { return false; }
+    }
+    const DataBox &hi = range.hi_;
+    if (hi.getType() == zone.min_.getType()) {
+      if (DataBox::GreaterThan(zone.min_, hi).getBoolValue()) { return false; }
+      if (!range.hi_inclusive_ && DataBox::EqualTo(zone.min_, hi).getBoolValue()) { return false; }
+    }
+  }
+  return true;
+}
+
+}  // namespace cql
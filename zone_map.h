@@ -0,0 +1,106 @@
+/*****************************************************
+ * File: zone_map.h
+ * Author: Fudanyrd (email: yangrundong7@gmail.com)
+ *
+ * Zone maps: rows of a table are grouped into blocks,
+ * and each block keeps the min, max and null count of
+ * its columns, so that a scan can skip the blocks a
+ * predicate rules out without reading their rows.
+ *****************************************************/
+#pragma once
+
+#include <vector>
+
+#include "schema.h"
+#include "tuple.h"
+#include "type.h"
+
+namespace cql {
+
+/** number of rows in a block of a zone map. */
+const size_t ZONE_ROWS = 4096;
+
+/** Statistics of a column in a block of rows. */
+struct Zone {
+  DataBox min_;              // smallest non-null value, NULL if there is none.
+  DataBox max_;              // largest non-null value, NULL if there is none.
+  size_t null_count_{0U};    // number of NULLs.
+  bool mixed_{false};        // a value is not of the type of the column, comparing it throws.
+};
+
+/**
+ * Values of a column a predicate may accept: from lo_ to hi_,
+ * a bound is absent if NULL. NULLs are never accepted.
+ */
+struct ColumnRange {
+  size_t col_{0U};
+  DataBox lo_;
+  bool lo_inclusive_{true};
+  DataBox hi_;
+  bool hi_inclusive_{true};
+};
+
+class ZoneMap {
+ private:
+  const Schema *schema_{nullptr};
+  size_t num_cols_{0U};
+  /** number of rows covered. */
+  size_t num_rows_{0U};
+  /** zone of column c in block b is zones_[b * num_cols_ + c]. */
+  std::vector<Zone> zones_;
+  /** number of rows not deleted in each block. */
+  std::vector<size_t> live_;
+  /** known_[c] is false if column c is not loaded yet(no statistics). */
+  std::vector<bool> known_;
+
+  /** @brief fold a value of column col into a zone. */
+  void Fold(Zone *zone, size_t col, const DataBox &val) const;
+
+ public:
+  ZoneMap() = default;
+
+  /**
+   * @brief cover the rows of a table.
+   * @param known: collect statistics of all columns; if false, no column is known
+   * until BuildColumn.
+   */
+  void Build(const Schema *schema, const std::vector<Tuple> &tuples, bool known = true);
+
+  /**
+   * @brief (re)collect statistics of a column.
+   */
+  void BuildColumn(const std::vector<Tuple> &tuples, size_t col);
+
+  /**
+   * @brief cover a row appended to the table.
+   */
+  void Append(const Tuple &tuple);
+
+  /**
+   * @brief a column of a row is updated from old_val to new_val.
+   * Bounds only widen, so they stay correct but may be loose.
+   */
+  void Update(size_t row, size_t col, const DataBox &old_val, const DataBox &new_val);
+
+  /**
+   * @brief a row is deleted.
+   */
+  void Delete(size_t row);
+
+  /**
+   * @return number of blocks.
+   */
+  auto getNumBlocks() const -> size_t { return live_.size(); }
+
+  /**
+   * @return statistics of a column in a block.
+   */
+  auto getZone(size_t block, size_t col) const -> const Zone & { return zones_[block * num_cols_ + col]; }
+
+  /**
+   * @return false if no row of the block can have its values within all the ranges.
+   */
+  auto MayMatch(size_t block, const std::vector<ColumnRange> &ranges) const -> bool;
+};
+
+}  // namespace cql
@@ -0,0 +1,48 @@
+#include <iostream>
+#include "table.h"
+
+using namespace std;  using namespace cql;
+
+/** @return the blocks of the table that may have rows in the range. */
+static auto matching(const Table &table, const ColumnRange &range) -> size_t {
+  size_t res = 0;
+  for (size_t block = 0; block < table.getZoneMap().getNumBlocks(); ++block) {
+    if (table.getZoneMap().MayMatch(block, {range})) { ++res; }
+  }
+  return res;
+}
+
+auto main(int argc, char **argv) -> int {
+  // 3 blocks of #id ascending, #tag NULL in the first block.
+  Table table("id:float,tag:char");
+  for (size_t i = 0; i < 3 * ZONE_ROWS; ++i) {
+    DataBox tag = i < ZONE_ROWS ? DataBox(TypeId::INVALID, "") : DataBox(TypeId::Char, "x");
+    table.insertTuple({DataBox(static_cast<double>(i)), tag});
+  }
+  cout << "blocks = " << table.getZoneMap().getNumBlocks() << endl;  // expect 3.
+  cout << "nulls of #tag in block 0 = " << table.getZoneMap().getZone(0, 1).null_count_ << endl;  // expect 4096.
+
+  ColumnRange range;
+  range.col_ = 0;
+  range.lo_ = DataBox(static_cast<double>(2 * ZONE_ROWS));
+  cout << "#id >= 8192: " << matching(table, range) << endl;  // expect 1.
+  range.lo_inclusive_ = false;
+  range.lo_ = DataBox(static_cast<double>(2 * ZONE_ROWS - 1));
+  cout << "#id > 8191: " << matching(table, range) << endl;  // expect 1.
+  range.lo_ = range.hi_ = DataBox(10.0);
+  range.lo_inclusive_ = true;
+  cout << "#id = 10: " << matching(table, range) << endl;  // expect 1.
+  range.col_ = 1;
+  range.lo_ = range.hi_ = DataBox(TypeId::Char, "x");
+  cout << "#tag = 'x': " << matching(table, range) << endl;  // expect 2.
+
+  // updates widen the bounds, deleting all rows of a block skips it.
+  table.updateTuple(DataBox(1e9), 0, 0);
+  range.col_ = 0;
+  range.lo_ = range.hi_ = DataBox(1e9);
+  cout << "#id = 1e9 after update: " << matching(table, range) << endl;  // expect 1.
+  for (size_t i = 0; i < ZONE_ROWS; ++i) { table.deleteTuple(i); }
+  cout << "#id = 1e9 after delete: " << matching(table, range) << endl;  // expect 0.
+
+  return 0;
+}